@@ -0,0 +1,285 @@
+/**
+ * 流式JSON写入器实现
+ * 功能: 无堆分配的JSON序列化
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "json_writer.h"
+
+/**
+ * 刷出缓冲区 (仅流式模式)
+ */
+static bool writer_flush(json_writer_t *w)
+{
+    if (w->flush == NULL || w->len == 0) {
+        return w->flush != NULL;
+    }
+    if (w->flush(w->flush_ctx, w->buf, w->len) != 0) {
+        w->error = true;
+        return false;
+    }
+    w->len = 0;
+    return true;
+}
+
+/**
+ * 写入原始字节
+ */
+static void writer_put(json_writer_t *w, const char *data, size_t len)
+{
+    while (len > 0 && !w->error) {
+        size_t room = w->capacity - w->len;
+        if (room == 0) {
+            // 固定缓冲区模式下空间不足即为错误
+            if (!writer_flush(w)) {
+                w->error = true;
+                return;
+            }
+            continue;
+        }
+        size_t n = len < room ? len : room;
+        memcpy(w->buf + w->len, data, n);
+        w->len += n;
+        w->total += n;
+        data += n;
+        len -= n;
+    }
+}
+
+static void writer_putc(json_writer_t *w, char c)
+{
+    writer_put(w, &c, 1);
+}
+
+/**
+ * 写入带转义的字符串 (含两侧引号)
+ */
+static void writer_put_escaped(json_writer_t *w, const char *str)
+{
+    static const char hex[] = "0123456789abcdef";
+
+    writer_putc(w, '"');
+    const char *run = str;
+    for (const char *p = str; *p != '\0'; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+
+        // 先写出之前无需转义的连续字节
+        writer_put(w, run, p - run);
+        run = p + 1;
+
+        char esc[6] = { '\\', 0 };
+        size_t esc_len = 2;
+        switch (c) {
+        case '"':  esc[1] = '"';  break;
+        case '\\': esc[1] = '\\'; break;
+        case '\b': esc[1] = 'b';  break;
+        case '\f': esc[1] = 'f';  break;
+        case '\n': esc[1] = 'n';  break;
+        case '\r': esc[1] = 'r';  break;
+        case '\t': esc[1] = 't';  break;
+        default:
+            esc[1] = 'u';
+            esc[2] = '0';
+            esc[3] = '0';
+            esc[4] = hex[c >> 4];
+            esc[5] = hex[c & 0x0F];
+            esc_len = 6;
+            break;
+        }
+        writer_put(w, esc, esc_len);
+    }
+    writer_put(w, run, strlen(run));
+    writer_putc(w, '"');
+}
+
+/**
+ * 写入值之前的分隔符和成员名
+ */
+static void writer_prefix(json_writer_t *w, const char *key)
+{
+    if (w->depth > 0) {
+        uint32_t bit = 1u << (w->depth - 1);
+        if (w->has_items & bit) {
+            writer_putc(w, ',');
+        }
+        w->has_items |= bit;
+    }
+    if (key != NULL) {
+        writer_put_escaped(w, key);
+        writer_putc(w, ':');
+    }
+}
+
+static void writer_open(json_writer_t *w, const char *key, char open)
+{
+    writer_prefix(w, key);
+    if (w->depth >= JSON_WRITER_MAX_DEPTH) {
+        w->error = true;
+        return;
+    }
+    w->depth++;
+    w->has_items &= ~(1u << (w->depth - 1));
+    writer_putc(w, open);
+}
+
+static void writer_close(json_writer_t *w, char close)
+{
+    if (w->depth == 0) {
+        w->error = true;
+        return;
+    }
+    w->depth--;
+    writer_putc(w, close);
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t capacity)
+{
+    json_writer_init_stream(w, buf, capacity, NULL, NULL);
+}
+
+void json_writer_init_stream(json_writer_t *w, char *buf, size_t capacity,
+                             json_writer_flush_fn flush, void *ctx)
+{
+    memset(w, 0, sizeof(*w));
+    w->buf = buf;
+    w->capacity = capacity;
+    w->flush = flush;
+    w->flush_ctx = ctx;
+    w->error = (buf == NULL || capacity == 0);
+}
+
+void json_writer_begin_object(json_writer_t *w, const char *key)
+{
+    writer_open(w, key, '{');
+}
+
+void json_writer_end_object(json_writer_t *w)
+{
+    writer_close(w, '}');
+}
+
+void json_writer_begin_array(json_writer_t *w, const char *key)
+{
+    writer_open(w, key, '[');
+}
+
+void json_writer_end_array(json_writer_t *w)
+{
+    writer_close(w, ']');
+}
+
+void json_writer_add_string(json_writer_t *w, const char *key, const char *value)
+{
+    if (value == NULL) {
+        json_writer_add_null(w, key);
+        return;
+    }
+    writer_prefix(w, key);
+    writer_put_escaped(w, value);
+}
+
+/**
+ * 无符号整数转十进制 (比snprintf快，热路径上大部分字段是整数)
+ * @return 写入num末尾的起始位置
+ */
+static char *format_uint(char *end, uint64_t value)
+{
+    char *p = end;
+    do {
+        *--p = (char)('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    return p;
+}
+
+void json_writer_add_int(json_writer_t *w, const char *key, int64_t value)
+{
+    char num[24];
+    char *end = num + sizeof(num);
+    uint64_t magnitude = value < 0 ? (uint64_t)0 - (uint64_t)value : (uint64_t)value;
+    char *p = format_uint(end, magnitude);
+    if (value < 0) {
+        *--p = '-';
+    }
+    writer_prefix(w, key);
+    writer_put(w, p, end - p);
+}
+
+void json_writer_add_uint(json_writer_t *w, const char *key, uint64_t value)
+{
+    char num[24];
+    char *end = num + sizeof(num);
+    char *p = format_uint(end, value);
+    writer_prefix(w, key);
+    writer_put(w, p, end - p);
+}
+
+void json_writer_add_double(json_writer_t *w, const char *key, double value)
+{
+    // JSON不支持NaN/Inf
+    if (value != value || value > 1e300 || value < -1e300) {
+        json_writer_add_null(w, key);
+        return;
+    }
+    char num[32];
+    int n = snprintf(num, sizeof(num), "%.6g", value);
+    writer_prefix(w, key);
+    writer_put(w, num, n);
+}
+
+void json_writer_add_bool(json_writer_t *w, const char *key, bool value)
+{
+    writer_prefix(w, key);
+    if (value) {
+        writer_put(w, "true", 4);
+    } else {
+        writer_put(w, "false", 5);
+    }
+}
+
+void json_writer_add_null(json_writer_t *w, const char *key)
+{
+    writer_prefix(w, key);
+    writer_put(w, "null", 4);
+}
+
+void json_writer_add_raw(json_writer_t *w, const char *key, const char *json, size_t len)
+{
+    writer_prefix(w, key);
+    writer_put(w, json, len);
+}
+
+int json_writer_finish(json_writer_t *w)
+{
+    if (w->depth != 0) {
+        w->error = true;
+    }
+    if (w->error) {
+        return -1;
+    }
+
+    if (w->flush != NULL) {
+        if (!writer_flush(w)) {
+            return -1;
+        }
+        return (int)w->total;
+    }
+
+    // 固定缓冲区模式需要为'\0'留出空间
+    if (w->len >= w->capacity) {
+        w->error = true;
+        return -1;
+    }
+    w->buf[w->len] = '\0';
+    return (int)w->len;
+}
+
+bool json_writer_has_error(const json_writer_t *w)
+{
+    return w->error;
+}
@@ -0,0 +1,98 @@
+/**
+ * 流式JSON写入器头文件
+ * 功能: 不构建DOM、不分配堆内存，直接把JSON写入固定缓冲区，
+ *       或在缓冲区写满时通过回调分块输出 (如 httpd_resp_send_chunk)
+ *
+ * 用法:
+ *   char buf[256];
+ *   json_writer_t w;
+ *   json_writer_init(&w, buf, sizeof(buf));
+ *   json_writer_begin_object(&w, NULL);
+ *   json_writer_add_int(&w, "code", 0);
+ *   json_writer_end_object(&w);
+ *   int len = json_writer_finish(&w);   // <0 表示溢出或输出失败
+ */
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 最大嵌套深度
+#define JSON_WRITER_MAX_DEPTH   16
+
+/**
+ * 分块输出回调
+ * @param ctx 用户上下文
+ * @param data 数据
+ * @param len 数据长度
+ * @return 0 成功，非0失败 (写入器进入错误状态)
+ */
+typedef int (*json_writer_flush_fn)(void *ctx, const char *data, size_t len);
+
+typedef struct {
+    char *buf;
+    size_t capacity;
+    size_t len;
+    size_t total;                   // 已输出的总字节数 (含已刷出的部分)
+    json_writer_flush_fn flush;     // NULL表示固定缓冲区模式
+    void *flush_ctx;
+    uint32_t has_items;             // 每层容器是否已有元素 (按位)
+    uint8_t depth;
+    bool error;
+} json_writer_t;
+
+/**
+ * 初始化为固定缓冲区模式，超出容量时进入错误状态
+ */
+void json_writer_init(json_writer_t *w, char *buf, size_t capacity);
+
+/**
+ * 初始化为流式模式，缓冲区写满时调用flush输出
+ */
+void json_writer_init_stream(json_writer_t *w, char *buf, size_t capacity,
+                             json_writer_flush_fn flush, void *ctx);
+
+// 容器: 位于对象内时key为成员名，位于数组内或根部时传NULL
+void json_writer_begin_object(json_writer_t *w, const char *key);
+void json_writer_end_object(json_writer_t *w);
+void json_writer_begin_array(json_writer_t *w, const char *key);
+void json_writer_end_array(json_writer_t *w);
+
+// 值: key规则同上
+void json_writer_add_string(json_writer_t *w, const char *key, const char *value);
+void json_writer_add_int(json_writer_t *w, const char *key, int64_t value);
+void json_writer_add_uint(json_writer_t *w, const char *key, uint64_t value);
+void json_writer_add_double(json_writer_t *w, const char *key, double value);
+void json_writer_add_bool(json_writer_t *w, const char *key, bool value);
+void json_writer_add_null(json_writer_t *w, const char *key);
+
+/**
+ * 写入已序列化的JSON片段 (调用者保证其合法)
+ */
+void json_writer_add_raw(json_writer_t *w, const char *key, const char *json, size_t len);
+
+/**
+ * 结束写入
+ * 固定缓冲区模式: 追加'\0'并返回JSON长度
+ * 流式模式: 刷出剩余数据并返回总字节数
+ * @return 长度，<0 表示溢出、嵌套不匹配或输出失败
+ */
+int json_writer_finish(json_writer_t *w);
+
+/**
+ * 是否发生错误
+ */
+bool json_writer_has_error(const json_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_WRITER_H
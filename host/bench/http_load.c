@@ -0,0 +1,457 @@
+/**
+ * HTTP负载基准测试 (主机侧)
+ * 功能: 模拟多个操作台对主机版固件(kvm_firmware_host)施加混合负载，按路由统计吞吐量与延迟分位数
+ *   - 仪表盘: 启动时加载静态资源，之后按固定间隔轮询 /api/status，可定期重新加载资源
+ *   - 切换者: 按固定间隔 POST /api/switch/N，在各通道间轮换
+ * 每个模拟客户端使用一条持久连接；连接被服务器关闭(如LRU清理)时记为断开并重连
+ *
+ * 用法:
+ *   ch32_sim &
+ *   KVM_HTTP_PORT=8080 kvm_firmware_host &
+ *   http_load [-p 端口] [-t 时长s] [-d 仪表盘数] [-s 切换者数] [-i 轮询间隔ms]
+ *             [-w 切换间隔ms] [-a 资源重载间隔ms] [-c 通道数] [-C]
+ *   -a 0  只在启动时加载一次静态资源 (默认)
+ *   -C    每个请求使用新连接 (不复用)
+ * 输出: JSON格式的每路由请求数、错误数、吞吐量与p50/p95/p99/max延迟，以及连接统计
+ */
+
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define RESP_BUF_SIZE       16384
+#define RECV_TIMEOUT_S      10
+
+typedef enum {
+    ROUTE_STATUS,
+    ROUTE_SWITCH,
+    ROUTE_INDEX,
+    ROUTE_STYLE,
+    ROUTE_SCRIPT,
+    ROUTE_FAVICON,
+    ROUTE_MAX
+} route_t;
+
+static const char *const ROUTE_NAMES[ROUTE_MAX] = {
+    "/api/status", "/api/switch/{n}", "/", "/style.css", "/script.js", "/favicon.ico"
+};
+
+// 每条路由的样本 (每个客户端线程各自一份，结束后合并)
+typedef struct {
+    int64_t *latency_us;
+    size_t count;
+    size_t capacity;
+    uint32_t errors;                // 非2xx/3xx应答
+    uint32_t dropped;               // 连接被关闭或超时，请求未完成
+} route_stats_t;
+
+typedef struct {
+    bool switcher;
+    int index;
+    pthread_t thread;
+    int fd;
+    route_stats_t routes[ROUTE_MAX];
+    uint32_t connects;
+    uint32_t connect_failures;
+} client_t;
+
+static struct {
+    struct sockaddr_in addr;
+    int duration_s;
+    int dashboards;
+    int switchers;
+    int poll_interval_ms;
+    int switch_interval_ms;
+    int asset_interval_ms;
+    int channels;
+    bool close_each;
+} s_cfg = {
+    .duration_s = 10,
+    .dashboards = 4,
+    .switchers = 1,
+    .poll_interval_ms = 1000,
+    .switch_interval_ms = 2000,
+    .asset_interval_ms = 0,
+    .channels = 2,
+};
+
+static int64_t s_deadline_us;
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+static void sleep_until(int64_t when_us)
+{
+    int64_t delta = when_us - now_us();
+    if (delta > 0) {
+        struct timespec ts = { .tv_sec = delta / 1000000, .tv_nsec = (delta % 1000000) * 1000 };
+        nanosleep(&ts, NULL);
+    }
+}
+
+static void stats_add(route_stats_t *stats, int64_t latency_us)
+{
+    if (stats->count == stats->capacity) {
+        stats->capacity = stats->capacity ? stats->capacity * 2 : 256;
+        stats->latency_us = realloc(stats->latency_us, stats->capacity * sizeof(int64_t));
+    }
+    stats->latency_us[stats->count++] = latency_us;
+}
+
+static void client_disconnect(client_t *client)
+{
+    if (client->fd >= 0) {
+        close(client->fd);
+        client->fd = -1;
+    }
+}
+
+static bool client_connect(client_t *client)
+{
+    if (client->fd >= 0) {
+        return true;
+    }
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        return false;
+    }
+    int one = 1;
+    struct timeval tv = { .tv_sec = RECV_TIMEOUT_S };
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+    if (connect(fd, (struct sockaddr *)&s_cfg.addr, sizeof(s_cfg.addr)) != 0) {
+        close(fd);
+        client->connect_failures++;
+        return false;
+    }
+    client->fd = fd;
+    client->connects++;
+    return true;
+}
+
+/**
+ * 读取一个完整的HTTP应答 (支持Content-Length与分块传输)
+ * @return HTTP状态码，连接失败返回-1
+ */
+static int read_response(int fd, bool *server_closes)
+{
+    static __thread char buf[RESP_BUF_SIZE];
+    size_t len = 0;
+    char *body = NULL;
+
+    while (body == NULL) {
+        if (len == sizeof(buf) - 1) {
+            return -1;
+        }
+        ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+        if (n <= 0) {
+            return -1;
+        }
+        len += n;
+        buf[len] = '\0';
+        body = strstr(buf, "\r\n\r\n");
+    }
+    *body = '\0';
+    body += 4;
+
+    int status = 0;
+    if (sscanf(buf, "HTTP/1.%*d %d", &status) != 1) {
+        return -1;
+    }
+    *server_closes = strcasestr(buf, "\r\nConnection: close") != NULL;
+    bool chunked = strcasestr(buf, "\r\nTransfer-Encoding: chunked") != NULL;
+    const char *cl = strcasestr(buf, "\r\nContent-Length:");
+    size_t have = len - (body - buf);
+
+    if (!chunked) {
+        size_t want = cl != NULL ? strtoul(cl + 17, NULL, 10) : 0;
+        char scratch[4096];
+        while (have < want) {
+            size_t chunk = want - have < sizeof(scratch) ? want - have : sizeof(scratch);
+            ssize_t n = recv(fd, scratch, chunk, 0);
+            if (n <= 0) {
+                return -1;
+            }
+            have += n;
+        }
+        return status;
+    }
+
+    // 分块传输: 把剩余数据移到缓冲区开头，逐块解析直到长度为0的块
+    memmove(buf, body, have);
+    len = have;
+    size_t pos = 0;
+    while (true) {
+        char *line_end;
+        while ((line_end = memmem(buf + pos, len - pos, "\r\n", 2)) == NULL) {
+            if (pos > 0) {
+                memmove(buf, buf + pos, len - pos);
+                len -= pos;
+                pos = 0;
+            }
+            ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+            if (n <= 0) {
+                return -1;
+            }
+            len += n;
+        }
+        size_t chunk = strtoul(buf + pos, NULL, 16);
+        size_t need = (line_end - buf) + 2 + chunk + 2;     // 块数据及其后的CRLF
+        while (len < need) {
+            if (need > sizeof(buf) - 1) {
+                // 块比缓冲区大: 丢弃已读部分继续读
+                need -= len;
+                len = 0;
+                pos = 0;
+                char scratch[4096];
+                while (need > 0) {
+                    ssize_t n = recv(fd, scratch, need < sizeof(scratch) ? need : sizeof(scratch), 0);
+                    if (n <= 0) {
+                        return -1;
+                    }
+                    need -= n;
+                }
+                break;
+            }
+            ssize_t n = recv(fd, buf + len, sizeof(buf) - 1 - len, 0);
+            if (n <= 0) {
+                return -1;
+            }
+            len += n;
+        }
+        if (chunk == 0) {
+            return status;
+        }
+        pos = need <= len ? need : len;
+    }
+}
+
+/**
+ * 发送一个请求并等待应答，记录延迟
+ */
+static void client_request(client_t *client, route_t route, const char *method, const char *path)
+{
+    route_stats_t *stats = &client->routes[route];
+    if (!client_connect(client)) {
+        stats->dropped++;
+        return;
+    }
+
+    char req[256];
+    int len = snprintf(req, sizeof(req),
+                       "%s %s HTTP/1.1\r\nHost: kvm\r\nAccept-Encoding: gzip\r\n"
+                       "Content-Length: 0\r\nConnection: %s\r\n\r\n",
+                       method, path, s_cfg.close_each ? "close" : "keep-alive");
+
+    int64_t start = now_us();
+    bool server_closes = false;
+    int status = send(client->fd, req, len, MSG_NOSIGNAL) == len ? read_response(client->fd, &server_closes) : -1;
+    int64_t latency = now_us() - start;
+
+    if (status < 0) {
+        // 连接被服务器关闭 (LRU清理/会话已满) 或超时
+        stats->dropped++;
+        client_disconnect(client);
+        return;
+    }
+    stats_add(stats, latency);
+    if (status >= 400) {
+        stats->errors++;
+    }
+    if (server_closes || s_cfg.close_each) {
+        client_disconnect(client);
+    }
+}
+
+static void dashboard_load_assets(client_t *client)
+{
+    client_request(client, ROUTE_INDEX, "GET", "/");
+    client_request(client, ROUTE_STYLE, "GET", "/style.css");
+    client_request(client, ROUTE_SCRIPT, "GET", "/script.js");
+    client_request(client, ROUTE_FAVICON, "GET", "/favicon.ico");
+}
+
+static void *client_thread(void *arg)
+{
+    client_t *client = (client_t *)arg;
+    client->fd = -1;
+
+    // 错开各客户端的起始时间，避免所有请求同时到达
+    int interval_ms = client->switcher ? s_cfg.switch_interval_ms : s_cfg.poll_interval_ms;
+    int clients = client->switcher ? s_cfg.switchers : s_cfg.dashboards;
+    int64_t next_us = now_us() + (int64_t)interval_ms * 1000 * client->index / clients;
+    int64_t next_assets_us = next_us;
+    int channel = client->index % s_cfg.channels;
+
+    while (true) {
+        sleep_until(next_us);
+        int64_t now = now_us();
+        if (now >= s_deadline_us) {
+            break;
+        }
+
+        if (client->switcher) {
+            char path[32];
+            channel = channel % s_cfg.channels + 1;
+            snprintf(path, sizeof(path), "/api/switch/%d", channel);
+            client_request(client, ROUTE_SWITCH, "POST", path);
+        } else {
+            if (now >= next_assets_us) {
+                dashboard_load_assets(client);
+                next_assets_us = s_cfg.asset_interval_ms > 0 ? now + (int64_t)s_cfg.asset_interval_ms * 1000
+                                                             : INT64_MAX;
+            }
+            client_request(client, ROUTE_STATUS, "GET", "/api/status");
+        }
+
+        // 固定速率: 落后时立即发下一个请求，不累积
+        next_us += (int64_t)interval_ms * 1000;
+        if (next_us < now_us()) {
+            next_us = now_us();
+        }
+    }
+
+    client_disconnect(client);
+    return NULL;
+}
+
+static int compare_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const int64_t *sorted, size_t count, double p)
+{
+    size_t index = (size_t)(p * (count - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+static void print_route(const char *name, const route_stats_t *stats, double elapsed_s, bool last)
+{
+    printf("\"%s\":{\"requests\":%zu,\"errors\":%u,\"dropped\":%u,\"rps\":%.1f",
+           name, stats->count, stats->errors, stats->dropped, stats->count / elapsed_s);
+    if (stats->count > 0) {
+        int64_t sum = 0;
+        for (size_t i = 0; i < stats->count; i++) {
+            sum += stats->latency_us[i];
+        }
+        printf(",\"latency_ms\":{\"mean\":%.3f,\"p50\":%.3f,\"p95\":%.3f,\"p99\":%.3f,\"max\":%.3f}",
+               sum / 1000.0 / stats->count,
+               percentile_ms(stats->latency_us, stats->count, 0.50),
+               percentile_ms(stats->latency_us, stats->count, 0.95),
+               percentile_ms(stats->latency_us, stats->count, 0.99),
+               stats->latency_us[stats->count - 1] / 1000.0);
+    }
+    printf("}%s", last ? "" : ",");
+}
+
+int main(int argc, char **argv)
+{
+    const char *port_env = getenv("KVM_HTTP_PORT");
+    int port = port_env != NULL ? atoi(port_env) : 8080;
+    int opt;
+    while ((opt = getopt(argc, argv, "p:t:d:s:i:w:a:c:Ch")) != -1) {
+        switch (opt) {
+        case 'p': port = atoi(optarg); break;
+        case 't': s_cfg.duration_s = atoi(optarg); break;
+        case 'd': s_cfg.dashboards = atoi(optarg); break;
+        case 's': s_cfg.switchers = atoi(optarg); break;
+        case 'i': s_cfg.poll_interval_ms = atoi(optarg); break;
+        case 'w': s_cfg.switch_interval_ms = atoi(optarg); break;
+        case 'a': s_cfg.asset_interval_ms = atoi(optarg); break;
+        case 'c': s_cfg.channels = atoi(optarg); break;
+        case 'C': s_cfg.close_each = true; break;
+        default:
+            fprintf(stderr, "用法: %s [-p 端口] [-t 时长s] [-d 仪表盘数] [-s 切换者数] [-i 轮询间隔ms] "
+                    "[-w 切换间隔ms] [-a 资源重载间隔ms] [-c 通道数] [-C]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (s_cfg.duration_s <= 0 || s_cfg.dashboards < 0 || s_cfg.switchers < 0 ||
+        s_cfg.dashboards + s_cfg.switchers == 0 || s_cfg.poll_interval_ms < 0 ||
+        s_cfg.switch_interval_ms < 0 || s_cfg.channels <= 0) {
+        fprintf(stderr, "参数无效\n");
+        return 1;
+    }
+
+    s_cfg.addr.sin_family = AF_INET;
+    s_cfg.addr.sin_port = htons(port);
+    s_cfg.addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+    int client_count = s_cfg.dashboards + s_cfg.switchers;
+    client_t *clients = calloc(client_count, sizeof(client_t));
+    int64_t start_us = now_us();
+    s_deadline_us = start_us + (int64_t)s_cfg.duration_s * 1000000;
+
+    for (int i = 0; i < client_count; i++) {
+        clients[i].switcher = i >= s_cfg.dashboards;
+        clients[i].index = clients[i].switcher ? i - s_cfg.dashboards : i;
+        pthread_create(&clients[i].thread, NULL, client_thread, &clients[i]);
+    }
+    for (int i = 0; i < client_count; i++) {
+        pthread_join(clients[i].thread, NULL);
+    }
+    double elapsed_s = (now_us() - start_us) / 1e6;
+
+    // 合并各客户端的样本
+    route_stats_t totals[ROUTE_MAX] = { 0 };
+    uint32_t connects = 0;
+    uint32_t connect_failures = 0;
+    size_t requests = 0;
+    uint32_t dropped = 0;
+    for (int i = 0; i < client_count; i++) {
+        connects += clients[i].connects;
+        connect_failures += clients[i].connect_failures;
+        for (int r = 0; r < ROUTE_MAX; r++) {
+            route_stats_t *src = &clients[i].routes[r];
+            for (size_t k = 0; k < src->count; k++) {
+                stats_add(&totals[r], src->latency_us[k]);
+            }
+            totals[r].errors += src->errors;
+            totals[r].dropped += src->dropped;
+            free(src->latency_us);
+        }
+    }
+    for (int r = 0; r < ROUTE_MAX; r++) {
+        qsort(totals[r].latency_us, totals[r].count, sizeof(int64_t), compare_int64);
+        requests += totals[r].count;
+        dropped += totals[r].dropped;
+    }
+
+    printf("{\"config\":{\"port\":%d,\"duration_s\":%d,\"dashboards\":%d,\"switchers\":%d,"
+           "\"poll_interval_ms\":%d,\"switch_interval_ms\":%d,\"asset_interval_ms\":%d,"
+           "\"channels\":%d,\"keep_alive\":%s},",
+           port, s_cfg.duration_s, s_cfg.dashboards, s_cfg.switchers, s_cfg.poll_interval_ms,
+           s_cfg.switch_interval_ms, s_cfg.asset_interval_ms, s_cfg.channels,
+           s_cfg.close_each ? "false" : "true");
+    printf("\"elapsed_s\":%.3f,\"requests\":%zu,\"rps\":%.1f,"
+           "\"connections\":{\"opened\":%u,\"failed\":%u,\"dropped_requests\":%u},\"routes\":{",
+           elapsed_s, requests, requests / elapsed_s, connects, connect_failures, dropped);
+    for (int r = 0; r < ROUTE_MAX; r++) {
+        print_route(ROUTE_NAMES[r], &totals[r], elapsed_s, r == ROUTE_MAX - 1);
+        free(totals[r].latency_us);
+    }
+    printf("}}\n");
+
+    free(clients);
+    return dropped == 0 && connect_failures == 0 ? 0 : 2;
+}
@@ -0,0 +1,259 @@
+/**
+ * 响应缓存基准测试 (主机侧)
+ * 功能: 对比 /api/status 几种实现的每秒请求数与堆分配次数
+ *   before: 每次请求构建cJSON树并cJSON_Print (旧实现)
+ *   writer: 每次请求用流式写入器直接写入固定缓冲区
+ *   cached: 按状态代数缓存写入器输出，命中时仅就地追加运行时间
+ *
+ * 用法: status_cache_bench [-n 请求数] [-c 每N次请求发生一次状态变化]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cJSON.h"
+#include "system_state.h"
+#include "response_cache.h"
+#include "json_writer.h"
+
+#define BENCH_CHANNELS  2
+
+// 模拟的系统状态
+static int s_current_channel = 1;
+static uint32_t s_total_switches = 0;
+static const char *s_channel_names[BENCH_CHANNELS] = { "电脑1", "电脑2" };
+
+// 分配计数 (通过cJSON_InitHooks挂接)
+static size_t s_alloc_count = 0;
+
+static void *counting_malloc(size_t size)
+{
+    s_alloc_count++;
+    return malloc(size);
+}
+
+// 防止编译器优化掉"发送"
+static volatile size_t s_sink = 0;
+
+static void fake_send(const char *data, size_t len)
+{
+    s_sink += len + (unsigned char)data[len / 2];
+}
+
+static double now_sec(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static cJSON *build_status_data(bool include_uptime, uint32_t uptime)
+{
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddNumberToObject(data, "current_channel", s_current_channel);
+
+    cJSON *wifi_obj = cJSON_CreateObject();
+    cJSON_AddBoolToObject(wifi_obj, "connected", true);
+    cJSON_AddStringToObject(wifi_obj, "ssid", "office-ap");
+    cJSON_AddStringToObject(wifi_obj, "ip", "192.168.1.50");
+    cJSON_AddNumberToObject(wifi_obj, "rssi", -52);
+    cJSON_AddItemToObject(data, "wifi_status", wifi_obj);
+
+    cJSON *comm_obj = cJSON_CreateObject();
+    cJSON_AddBoolToObject(comm_obj, "connected", true);
+    cJSON_AddNumberToObject(comm_obj, "tx_count", s_total_switches);
+    cJSON_AddNumberToObject(comm_obj, "rx_count", s_total_switches);
+    cJSON_AddNumberToObject(comm_obj, "error_count", 0);
+    cJSON_AddItemToObject(data, "comm_status", comm_obj);
+
+    cJSON_AddStringToObject(data, "ip_address", "192.168.1.50");
+
+    cJSON *stats = cJSON_CreateObject();
+    cJSON_AddNumberToObject(stats, "total_switches", s_total_switches);
+    cJSON_AddNumberToObject(stats, "error_count", 0);
+    cJSON_AddItemToObject(data, "stats", stats);
+
+    cJSON *channels = cJSON_CreateArray();
+    for (int i = 0; i < BENCH_CHANNELS; i++) {
+        cJSON *channel = cJSON_CreateObject();
+        cJSON_AddNumberToObject(channel, "channel", i + 1);
+        cJSON_AddBoolToObject(channel, "active", i + 1 == s_current_channel);
+        cJSON_AddBoolToObject(channel, "connected", true);
+        cJSON_AddStringToObject(channel, "name", s_channel_names[i]);
+        cJSON_AddItemToArray(channels, channel);
+    }
+    cJSON_AddItemToObject(data, "channels", channels);
+
+    if (include_uptime) {
+        cJSON_AddNumberToObject(data, "uptime", uptime);
+    }
+    return data;
+}
+
+static cJSON *build_response(bool include_uptime, uint32_t uptime)
+{
+    cJSON *json = cJSON_CreateObject();
+    cJSON_AddNumberToObject(json, "code", 0);
+    cJSON_AddStringToObject(json, "message", "success");
+    cJSON_AddItemToObject(json, "data", build_status_data(include_uptime, uptime));
+    return json;
+}
+
+// 流式写入器版本，字段与build_response一致
+static void write_response(json_writer_t *w, bool include_uptime, uint32_t uptime)
+{
+    json_writer_begin_object(w, NULL);
+    json_writer_add_int(w, "code", 0);
+    json_writer_add_string(w, "message", "success");
+    json_writer_begin_object(w, "data");
+    json_writer_add_int(w, "current_channel", s_current_channel);
+
+    json_writer_begin_object(w, "wifi_status");
+    json_writer_add_bool(w, "connected", true);
+    json_writer_add_string(w, "ssid", "office-ap");
+    json_writer_add_string(w, "ip", "192.168.1.50");
+    json_writer_add_int(w, "rssi", -52);
+    json_writer_end_object(w);
+
+    json_writer_begin_object(w, "comm_status");
+    json_writer_add_bool(w, "connected", true);
+    json_writer_add_uint(w, "tx_count", s_total_switches);
+    json_writer_add_uint(w, "rx_count", s_total_switches);
+    json_writer_add_uint(w, "error_count", 0);
+    json_writer_end_object(w);
+
+    json_writer_add_string(w, "ip_address", "192.168.1.50");
+
+    json_writer_begin_object(w, "stats");
+    json_writer_add_uint(w, "total_switches", s_total_switches);
+    json_writer_add_uint(w, "error_count", 0);
+    json_writer_end_object(w);
+
+    json_writer_begin_array(w, "channels");
+    for (int i = 0; i < BENCH_CHANNELS; i++) {
+        json_writer_begin_object(w, NULL);
+        json_writer_add_int(w, "channel", i + 1);
+        json_writer_add_bool(w, "active", i + 1 == s_current_channel);
+        json_writer_add_bool(w, "connected", true);
+        json_writer_add_string(w, "name", s_channel_names[i]);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+
+    if (include_uptime) {
+        json_writer_add_uint(w, "uptime", uptime);
+    }
+    json_writer_end_object(w);
+    json_writer_end_object(w);
+}
+
+// 模拟一次通道切换
+static void mutate_state(void)
+{
+    s_current_channel = s_current_channel == 1 ? 2 : 1;
+    s_total_switches++;
+    system_state_mark_changed();
+}
+
+// 旧实现: 每次请求构建并格式化打印
+static void request_before(uint32_t uptime)
+{
+    cJSON *json = build_response(true, uptime);
+    char *json_string = cJSON_Print(json);
+    fake_send(json_string, strlen(json_string));
+    cJSON_free(json_string);
+    cJSON_Delete(json);
+}
+
+// 流式写入器: 每次请求重新序列化，但不分配堆内存
+static void request_writer(uint32_t uptime)
+{
+    char buf[1024];
+    json_writer_t w;
+    json_writer_init(&w, buf, sizeof(buf));
+    write_response(&w, true, uptime);
+    int len = json_writer_finish(&w);
+    if (len > 0) {
+        fake_send(buf, len);
+    }
+}
+
+// 新实现: 按状态代数缓存
+static char s_cache_buf[1024];
+static response_cache_t s_cache = RESPONSE_CACHE_INIT(s_cache_buf);
+
+static void request_cached(uint32_t uptime)
+{
+    uint32_t generation = system_state_get_generation();
+    if (!response_cache_is_fresh(&s_cache, generation)) {
+        json_writer_t w;
+        json_writer_init(&w, s_cache.buf, s_cache.capacity - 32);
+        write_response(&w, false, 0);
+        int len = json_writer_finish(&w);
+        if (len > 0) {
+            response_cache_commit(&s_cache, generation, len);
+        }
+    }
+
+    size_t len = s_cache.len - 2;
+    len += snprintf(s_cache.buf + len, s_cache.capacity - len, ",\"uptime\":%lu}}", (unsigned long)uptime);
+    fake_send(s_cache.buf, len);
+}
+
+static void run(const char *name, void (*request)(uint32_t), long iterations, long change_every)
+{
+    s_alloc_count = 0;
+    double start = now_sec();
+    for (long i = 0; i < iterations; i++) {
+        if (change_every > 0 && i % change_every == 0) {
+            mutate_state();
+        }
+        request((uint32_t)(i / 1000));
+    }
+    double elapsed = now_sec() - start;
+
+    printf("  {\"impl\":\"%s\",\"requests\":%ld,\"seconds\":%.3f,\"req_per_sec\":%.0f,"
+           "\"allocs_per_req\":%.2f}",
+           name, iterations, elapsed, iterations / elapsed, (double)s_alloc_count / iterations);
+}
+
+int main(int argc, char **argv)
+{
+    long iterations = 200000;
+    long change_every = 100;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "n:c:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            iterations = atol(optarg);
+            break;
+        case 'c':
+            change_every = atol(optarg);
+            break;
+        default:
+            fprintf(stderr, "用法: %s [-n 请求数] [-c 每N次请求发生一次状态变化, 0表示不变化]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (iterations <= 0) {
+        fprintf(stderr, "请求数必须大于0\n");
+        return 1;
+    }
+
+    cJSON_Hooks hooks = { .malloc_fn = counting_malloc, .free_fn = free };
+    cJSON_InitHooks(&hooks);
+
+    printf("{\"bench\":\"status_cache\",\"change_every\":%ld,\"results\":[\n", change_every);
+    run("before", request_before, iterations, change_every);
+    printf(",\n");
+    run("writer", request_writer, iterations, change_every);
+    printf(",\n");
+    run("cached", request_cached, iterations, change_every);
+    printf("\n]}\n");
+    return 0;
+}
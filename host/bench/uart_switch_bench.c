@@ -0,0 +1,101 @@
+/**
+ * 通道切换延迟基准测试 (主机侧)
+ * 功能: 通过主机侧UART实现连接ch32_sim，测量kvm_controller_switch_channel的端到端延迟
+ *
+ * 用法:
+ *   ch32_sim -l 1 &
+ *   uart_switch_bench [-n 切换次数] [-b]
+ *   -b  先协商波特率 (uart_comm_negotiate_baud)
+ * 输出: JSON格式的延迟分位数、吞吐量与UART统计
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "esp_timer.h"
+#include "kvm_controller.h"
+#include "uart_comm.h"
+
+static int compare_int64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile_ms(const int64_t *sorted, int count, double p)
+{
+    int index = (int)(p * (count - 1) + 0.5);
+    return sorted[index] / 1000.0;
+}
+
+int main(int argc, char **argv)
+{
+    int iterations = 200;
+    bool negotiate = false;
+    int opt;
+    while ((opt = getopt(argc, argv, "n:bh")) != -1) {
+        switch (opt) {
+        case 'n': iterations = atoi(optarg); break;
+        case 'b': negotiate = true; break;
+        default:
+            fprintf(stderr, "用法: %s [-n 切换次数] [-b]\n", argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (iterations <= 0) {
+        return 1;
+    }
+
+    ESP_ERROR_CHECK(uart_comm_init());
+    if (negotiate) {
+        uart_comm_negotiate_baud();
+    }
+    ESP_ERROR_CHECK(kvm_controller_init());
+
+    int64_t *latency_us = calloc(iterations, sizeof(int64_t));
+    int ok = 0;
+    int failed = 0;
+    int64_t total_start = esp_timer_get_time();
+
+    for (int i = 0; i < iterations; i++) {
+        // 交替切换，保证每次都会发送指令
+        int channel = kvm_controller_get_current_channel() == 1 ? 2 : 1;
+        int64_t start = esp_timer_get_time();
+        esp_err_t ret = kvm_controller_switch_channel(channel);
+        latency_us[i] = esp_timer_get_time() - start;
+        if (ret == ESP_OK) {
+            ok++;
+        } else {
+            failed++;
+        }
+    }
+
+    double total_s = (esp_timer_get_time() - total_start) / 1e6;
+    qsort(latency_us, iterations, sizeof(int64_t), compare_int64);
+    int64_t sum = 0;
+    for (int i = 0; i < iterations; i++) {
+        sum += latency_us[i];
+    }
+
+    uart_comm_status_t status;
+    uart_comm_get_status_snapshot(&status);
+    printf("{\"iterations\":%d,\"ok\":%d,\"failed\":%d,\"switches_per_sec\":%.1f,"
+           "\"latency_ms\":{\"mean\":%.3f,\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,\"max\":%.3f},"
+           "\"uart\":{\"baud_rate\":%u,\"tx\":%u,\"rx\":%u,\"errors\":%u,\"timeouts\":%u,"
+           "\"retransmits\":%u,\"srtt_ms\":%u,\"rto_ms\":%u}}\n",
+           iterations, ok, failed, iterations / total_s,
+           sum / 1000.0 / iterations,
+           percentile_ms(latency_us, iterations, 0.50),
+           percentile_ms(latency_us, iterations, 0.90),
+           percentile_ms(latency_us, iterations, 0.99),
+           latency_us[iterations - 1] / 1000.0,
+           (unsigned)status.baud_rate, (unsigned)status.tx_count, (unsigned)status.rx_count,
+           (unsigned)status.error_count, (unsigned)status.timeout_count,
+           (unsigned)status.retransmit_count, (unsigned)status.srtt_ms, (unsigned)status.rto_ms);
+
+    free(latency_us);
+    return failed == 0 ? 0 : 2;
+}
@@ -0,0 +1,411 @@
+/**
+ * CH32V003模拟器 (主机侧)
+ * 功能: 在伪终端上模拟CH32V003的21字节帧协议，用于无硬件的功能与延迟测试
+ *   - 切换(0x00)/查询(0x01)/改名(0x02)/波特率(0x03)指令，应答回显序号和指令
+ *   - 可配置处理延迟与抖动，按当前波特率模拟线路传输时间
+ *   - 故障注入: 失败应答、校验和错误、丢帧
+ *
+ * 用法: ch32_sim [-p 链接路径] [-l 延迟ms] [-j 抖动ms] [-e 失败率] [-c 校验错误率]
+ *                [-d 丢帧率] [-s 随机种子] [-L] [-N] [-B] [-W] [-v]
+ *   -L  旧固件模式: 忽略序号和指令字节，所有帧按切换处理，应答不回显序号和指令
+ *   -N  不应答 (只执行切换，与最初不读取应答的协议一致)
+ *   -B  不支持波特率切换 (SET_BAUD返回失败)
+ *   -W  不模拟线路传输时间，也不检查两端波特率是否一致
+ * 固件侧连接: KVM_UART_DEVICE=<链接路径> (默认/tmp/ch32_sim)
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+// 与main/include/uart_comm.h中的帧格式一致
+#define FRAME_SIZE          21
+#define FRAME_HEAD          0xBB
+#define FRAME_TAIL          0x66
+#define FRAME_STATUS_OK     0x00
+#define FRAME_STATUS_FAIL   0x01
+#define FRAME_SEQ_IDX       4
+#define FRAME_CMD_IDX       5
+#define FRAME_PAYLOAD_IDX   6
+#define FRAME_PAYLOAD_MAX   13
+#define FRAME_CHECKSUM_IDX  19
+
+#define CMD_SWITCH          0x00
+#define CMD_QUERY           0x01
+#define CMD_RENAME          0x02
+#define CMD_SET_BAUD        0x03
+
+#define DEFAULT_BAUD        9600
+#define BAUD_REVERT_MS      500     // 新速率下无有效帧时回退
+#define CHANNEL_COUNT_MAX   64      // 应与固件的KVM_CHANNEL_COUNT一致 (-n)
+
+typedef struct {
+    const char *link_path;
+    int channels;
+    int latency_ms;
+    int jitter_ms;
+    double fail_rate;
+    double corrupt_rate;
+    double drop_rate;
+    bool legacy;
+    bool silent;
+    bool no_baud;
+    bool wire_time;
+    bool verbose;
+} sim_config_t;
+
+typedef struct {
+    uint64_t rx_frames;
+    uint64_t rx_bad_frames;
+    uint64_t tx_frames;
+    uint64_t dropped;
+    uint64_t failed;
+    uint64_t corrupted;
+    uint64_t switches;
+    uint64_t baud_changes;
+} sim_stats_t;
+
+static sim_config_t s_config = {
+    .link_path = "/tmp/ch32_sim",
+    .channels = 2,
+    .latency_ms = 1,
+    .wire_time = true,
+};
+static sim_stats_t s_stats;
+static volatile sig_atomic_t s_running = 1;
+
+// 模拟的设备状态
+static int s_channel = 1;
+static char s_names[CHANNEL_COUNT_MAX][FRAME_PAYLOAD_MAX + 1];
+static uint32_t s_baud = DEFAULT_BAUD;
+static uint32_t s_prev_baud = DEFAULT_BAUD;
+static int64_t s_baud_deadline_ms = 0;     // 非0时表示新速率尚未被确认
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static void sleep_us(int64_t us)
+{
+    if (us <= 0) {
+        return;
+    }
+    struct timespec ts = { .tv_sec = us / 1000000, .tv_nsec = (us % 1000000) * 1000 };
+    while (nanosleep(&ts, &ts) != 0 && errno == EINTR && s_running) {
+    }
+}
+
+/**
+ * 检查对端(固件侧)在伪终端上设置的波特率是否与模拟器一致
+ * 伪终端两端共享termios，不一致时真实线路上只能收到乱码
+ */
+static bool baud_matches(int fd)
+{
+    struct termios tio;
+    if (!s_config.wire_time || tcgetattr(fd, &tio) != 0) {
+        return true;
+    }
+    speed_t expected;
+    switch (s_baud) {
+    case 9600:      expected = B9600; break;
+    case 115200:    expected = B115200; break;
+    case 460800:    expected = B460800; break;
+    case 921600:    expected = B921600; break;
+    default:        return true;
+    }
+    return cfgetospeed(&tio) == expected;
+}
+
+static bool chance(double rate)
+{
+    return rate > 0 && (double)rand() / RAND_MAX < rate;
+}
+
+/**
+ * 校验和: 除数据长度字节外，第0-18字节的异或
+ */
+static uint8_t frame_checksum(const uint8_t *frame)
+{
+    uint8_t checksum = 0;
+    for (int i = 0; i < FRAME_CHECKSUM_IDX; i++) {
+        if (i != 2) {
+            checksum ^= frame[i];
+        }
+    }
+    return checksum;
+}
+
+/**
+ * 按当前波特率计算传输n字节的时间 (8N1，每字节10位)
+ */
+static int64_t wire_time_us(size_t bytes)
+{
+    return s_config.wire_time ? (int64_t)bytes * 10 * 1000000 / s_baud : 0;
+}
+
+static void send_reply(int fd, const uint8_t *request, uint8_t status, uint8_t channel)
+{
+    uint8_t reply[FRAME_SIZE] = {0};
+    reply[0] = FRAME_HEAD;
+    reply[1] = status;
+    reply[2] = 0x01;
+    reply[3] = channel;
+    reply[FRAME_SEQ_IDX] = s_config.legacy ? 0 : request[FRAME_SEQ_IDX];
+    reply[FRAME_CMD_IDX] = s_config.legacy ? 0 : request[FRAME_CMD_IDX];
+    reply[FRAME_CHECKSUM_IDX] = frame_checksum(reply);
+    reply[FRAME_SIZE - 1] = FRAME_TAIL;
+
+    if (chance(s_config.corrupt_rate)) {
+        reply[FRAME_CHECKSUM_IDX] ^= 0x5A;
+        s_stats.corrupted++;
+    }
+
+    if (s_config.silent) {
+        return;
+    }
+    sleep_us(wire_time_us(FRAME_SIZE));
+    if (write(fd, reply, FRAME_SIZE) == FRAME_SIZE) {
+        s_stats.tx_frames++;
+    }
+}
+
+/**
+ * 处理一帧校验通过的指令
+ */
+static void handle_frame(int fd, const uint8_t *frame)
+{
+    s_stats.rx_frames++;
+
+    // 新速率下收到有效帧，确认速率切换
+    s_baud_deadline_ms = 0;
+
+    int delay_ms = s_config.latency_ms;
+    if (s_config.jitter_ms > 0) {
+        delay_ms += rand() % (s_config.jitter_ms + 1);
+    }
+    sleep_us(wire_time_us(FRAME_SIZE) + (int64_t)delay_ms * 1000);
+
+    if (chance(s_config.drop_rate)) {
+        s_stats.dropped++;
+        if (s_config.verbose) {
+            fprintf(stderr, "[sim] 丢弃 seq=%d\n", frame[FRAME_SEQ_IDX]);
+        }
+        return;
+    }
+
+    uint8_t cmd = s_config.legacy ? CMD_SWITCH : frame[FRAME_CMD_IDX];
+    int channel = frame[3];
+    bool fail = chance(s_config.fail_rate);
+    if (fail) {
+        s_stats.failed++;
+        send_reply(fd, frame, FRAME_STATUS_FAIL, 0);
+        return;
+    }
+
+    switch (cmd) {
+    case CMD_SWITCH:
+        if (channel < 1 || channel > s_config.channels) {
+            send_reply(fd, frame, FRAME_STATUS_FAIL, 0);
+            return;
+        }
+        s_channel = channel;
+        s_stats.switches++;
+        send_reply(fd, frame, FRAME_STATUS_OK, s_channel);
+        break;
+
+    case CMD_QUERY:
+        send_reply(fd, frame, FRAME_STATUS_OK, s_channel);
+        break;
+
+    case CMD_RENAME:
+        if (channel < 1 || channel > s_config.channels) {
+            send_reply(fd, frame, FRAME_STATUS_FAIL, 0);
+            return;
+        }
+        memcpy(s_names[channel - 1], &frame[FRAME_PAYLOAD_IDX], FRAME_PAYLOAD_MAX);
+        s_names[channel - 1][FRAME_PAYLOAD_MAX] = '\0';
+        send_reply(fd, frame, FRAME_STATUS_OK, channel);
+        break;
+
+    case CMD_SET_BAUD: {
+        uint32_t baud = frame[FRAME_PAYLOAD_IDX] | (frame[FRAME_PAYLOAD_IDX + 1] << 8) |
+                        (frame[FRAME_PAYLOAD_IDX + 2] << 16) | ((uint32_t)frame[FRAME_PAYLOAD_IDX + 3] << 24);
+        if (s_config.no_baud || baud < DEFAULT_BAUD) {
+            send_reply(fd, frame, FRAME_STATUS_FAIL, 0);
+            return;
+        }
+        // 以旧速率应答后切换
+        send_reply(fd, frame, FRAME_STATUS_OK, 0);
+        s_prev_baud = s_baud;
+        s_baud = baud;
+        s_baud_deadline_ms = now_ms() + BAUD_REVERT_MS;
+        s_stats.baud_changes++;
+        break;
+    }
+
+    default:
+        send_reply(fd, frame, FRAME_STATUS_FAIL, 0);
+        break;
+    }
+
+    if (s_config.verbose) {
+        fprintf(stderr, "[sim] cmd=0x%02X ch=%d seq=%d -> 通道%d 波特率%u\n",
+                cmd, channel, frame[FRAME_SEQ_IDX], s_channel, s_baud);
+    }
+}
+
+static void print_stats(void)
+{
+    printf("{\"rx_frames\":%llu,\"rx_bad_frames\":%llu,\"tx_frames\":%llu,\"dropped\":%llu,"
+           "\"failed\":%llu,\"corrupted\":%llu,\"switches\":%llu,\"baud_changes\":%llu,"
+           "\"channel\":%d,\"baud\":%u}\n",
+           (unsigned long long)s_stats.rx_frames, (unsigned long long)s_stats.rx_bad_frames,
+           (unsigned long long)s_stats.tx_frames, (unsigned long long)s_stats.dropped,
+           (unsigned long long)s_stats.failed, (unsigned long long)s_stats.corrupted,
+           (unsigned long long)s_stats.switches, (unsigned long long)s_stats.baud_changes,
+           s_channel, s_baud);
+    fflush(stdout);
+}
+
+static void on_signal(int sig)
+{
+    s_running = 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "用法: %s [-p 链接路径] [-n 通道数] [-l 延迟ms] [-j 抖动ms] [-e 失败率] [-c 校验错误率]\n"
+            "          [-d 丢帧率] [-s 随机种子] [-L] [-N] [-B] [-W] [-v]\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned int seed = (unsigned int)time(NULL);
+    int opt;
+    while ((opt = getopt(argc, argv, "p:n:l:j:e:c:d:s:LNBWvh")) != -1) {
+        switch (opt) {
+        case 'p': s_config.link_path = optarg; break;
+        case 'n': s_config.channels = atoi(optarg); break;
+        case 'l': s_config.latency_ms = atoi(optarg); break;
+        case 'j': s_config.jitter_ms = atoi(optarg); break;
+        case 'e': s_config.fail_rate = atof(optarg); break;
+        case 'c': s_config.corrupt_rate = atof(optarg); break;
+        case 'd': s_config.drop_rate = atof(optarg); break;
+        case 's': seed = (unsigned int)strtoul(optarg, NULL, 10); break;
+        case 'L': s_config.legacy = true; break;
+        case 'N': s_config.silent = true; break;
+        case 'B': s_config.no_baud = true; break;
+        case 'W': s_config.wire_time = false; break;
+        case 'v': s_config.verbose = true; break;
+        default:
+            usage(argv[0]);
+            return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (s_config.channels < 1 || s_config.channels > CHANNEL_COUNT_MAX) {
+        fprintf(stderr, "通道数应为1~%d\n", CHANNEL_COUNT_MAX);
+        return 1;
+    }
+    srand(seed);
+
+    int master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0) {
+        perror("posix_openpt");
+        return 1;
+    }
+    const char *slave_path = ptsname(master);
+
+    // 保持从端打开，固件侧断开重连时主端不会读到EIO；同时设为原始模式
+    int slave = open(slave_path, O_RDWR | O_NOCTTY);
+    struct termios tio;
+    if (slave >= 0 && tcgetattr(slave, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+    }
+
+    unlink(s_config.link_path);
+    if (symlink(slave_path, s_config.link_path) != 0) {
+        perror("symlink");
+        return 1;
+    }
+    fprintf(stderr, "[sim] CH32V003模拟器就绪: %s -> %s (种子 %u)\n", s_config.link_path, slave_path, seed);
+
+    struct sigaction sa = { .sa_handler = on_signal };
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+
+    uint8_t frame[FRAME_SIZE];
+    size_t frame_len = 0;
+    uint8_t buf[256];
+
+    while (s_running) {
+        struct pollfd pfd = { .fd = master, .events = POLLIN };
+        int rc = poll(&pfd, 1, 50);
+
+        // 新速率未被确认时回退到原速率
+        if (s_baud_deadline_ms != 0 && now_ms() >= s_baud_deadline_ms) {
+            if (s_config.verbose) {
+                fprintf(stderr, "[sim] 波特率%u未确认，回退到%u\n", s_baud, s_prev_baud);
+            }
+            s_baud = s_prev_baud;
+            s_baud_deadline_ms = 0;
+        }
+        if (rc <= 0) {
+            continue;
+        }
+
+        ssize_t n = read(master, buf, sizeof(buf));
+        if (n <= 0) {
+            continue;
+        }
+        if (!baud_matches(master)) {
+            // 波特率不一致: 整段数据视为乱码
+            s_stats.rx_bad_frames++;
+            frame_len = 0;
+            continue;
+        }
+
+        for (ssize_t i = 0; i < n; i++) {
+            if (frame_len == 0 && buf[i] != FRAME_HEAD) {
+                continue;
+            }
+            frame[frame_len++] = buf[i];
+            if (frame_len < FRAME_SIZE) {
+                continue;
+            }
+
+            if (frame[FRAME_SIZE - 1] == FRAME_TAIL && frame[FRAME_CHECKSUM_IDX] == frame_checksum(frame)) {
+                handle_frame(master, frame);
+                frame_len = 0;
+                continue;
+            }
+
+            // 校验失败，从下一个起始字节重新同步
+            s_stats.rx_bad_frames++;
+            size_t next = 1;
+            while (next < FRAME_SIZE && frame[next] != FRAME_HEAD) {
+                next++;
+            }
+            frame_len = FRAME_SIZE - next;
+            memmove(frame, frame + next, frame_len);
+        }
+    }
+
+    unlink(s_config.link_path);
+    print_stats();
+    return 0;
+}
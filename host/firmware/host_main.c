@@ -0,0 +1,52 @@
+/**
+ * 主机侧固件入口
+ * 与IDF的main任务一样在单独的任务中运行app_main，主线程等待SIGINT/SIGTERM后
+ * 停止Web服务器并正常退出，便于valgrind/heaptrack输出完整报告
+ *
+ * 用法:
+ *   ch32_sim -p /tmp/ch32_sim &
+ *   KVM_HTTP_PORT=8080 kvm_firmware_host
+ *   curl http://127.0.0.1:8080/api/status
+ */
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+
+#include "web_server.h"
+
+static const char *TAG = "HOST_MAIN";
+
+void app_main(void);
+
+static void main_task(void *arg)
+{
+    app_main();
+    vTaskDelete(NULL);
+}
+
+int main(void)
+{
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    // 之后创建的线程继承该屏蔽字，信号只由主线程的sigwait接收
+    pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+    if (xTaskCreate(main_task, "main", 3584, NULL, 1, NULL) != pdPASS) {
+        fprintf(stderr, "创建main任务失败\n");
+        return 1;
+    }
+
+    int sig = 0;
+    sigwait(&signals, &sig);
+    ESP_LOGI(TAG, "收到信号%d，停止Web服务器并退出", sig);
+    web_server_stop();
+    return 0;
+}
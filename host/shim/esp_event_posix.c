@@ -0,0 +1,330 @@
+/**
+ * 主机侧esp_event实现
+ * 事件数据在投递时复制，分发任务按投递顺序调用匹配的处理器
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_event.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+#define EVENT_DISPATCH_MAX_HANDLERS     32
+
+typedef struct event_handler_node {
+    struct event_handler_node *next;
+    esp_event_base_t base;
+    int32_t id;
+    esp_event_handler_t handler;
+    void *arg;
+} event_handler_node_t;
+
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    void *data;
+    bool stop;                      // 删除事件循环时让分发任务退出
+} event_item_t;
+
+typedef struct {
+    QueueHandle_t queue;
+    pthread_mutex_t lock;
+    event_handler_node_t *handlers;
+    SemaphoreHandle_t task_exited;  // 无分发任务时为NULL
+} event_loop_t;
+
+static const char *TAG = "HOST_EVENT";
+static event_loop_t *s_default_loop = NULL;
+
+static bool handler_matches(const event_handler_node_t *node, esp_event_base_t base, int32_t id)
+{
+    if (node->base != ESP_EVENT_ANY_BASE && node->base != base) {
+        return false;
+    }
+    return node->id == ESP_EVENT_ANY_ID || node->id == id;
+}
+
+/**
+ * 分发一个事件 (处理器在锁外调用，允许处理器注册/注销或再次投递)
+ */
+static void event_dispatch(event_loop_t *loop, const event_item_t *item)
+{
+    event_handler_node_t matched[EVENT_DISPATCH_MAX_HANDLERS];
+    int count = 0;
+
+    pthread_mutex_lock(&loop->lock);
+    for (event_handler_node_t *node = loop->handlers; node != NULL; node = node->next) {
+        if (handler_matches(node, item->base, item->id) && count < EVENT_DISPATCH_MAX_HANDLERS) {
+            matched[count++] = *node;
+        }
+    }
+    pthread_mutex_unlock(&loop->lock);
+
+    for (int i = 0; i < count; i++) {
+        matched[i].handler(matched[i].arg, item->base, item->id, item->data);
+    }
+}
+
+static void event_loop_task(void *arg)
+{
+    event_loop_t *loop = (event_loop_t *)arg;
+    event_item_t item;
+
+    while (xQueueReceive(loop->queue, &item, portMAX_DELAY) == pdTRUE) {
+        if (item.stop) {
+            break;
+        }
+        event_dispatch(loop, &item);
+        free(item.data);
+    }
+    xSemaphoreGive(loop->task_exited);
+    vTaskDelete(NULL);
+}
+
+esp_err_t esp_event_loop_create(const esp_event_loop_args_t *args, esp_event_loop_handle_t *out_loop)
+{
+    if (args == NULL || out_loop == NULL || args->queue_size <= 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    event_loop_t *loop = calloc(1, sizeof(event_loop_t));
+    if (loop == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    loop->queue = xQueueCreate(args->queue_size, sizeof(event_item_t));
+    pthread_mutex_init(&loop->lock, NULL);
+    if (loop->queue == NULL) {
+        free(loop);
+        return ESP_ERR_NO_MEM;
+    }
+
+    if (args->task_name != NULL) {
+        loop->task_exited = xSemaphoreCreateBinary();
+        if (xTaskCreatePinnedToCore(event_loop_task, args->task_name, args->task_stack_size, loop,
+                                    args->task_priority, NULL, args->task_core_id) != pdPASS) {
+            vSemaphoreDelete(loop->task_exited);
+            vQueueDelete(loop->queue);
+            free(loop);
+            return ESP_FAIL;
+        }
+    }
+
+    *out_loop = loop;
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_delete(esp_event_loop_handle_t handle)
+{
+    event_loop_t *loop = (event_loop_t *)handle;
+    if (loop == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (loop->task_exited != NULL) {
+        event_item_t stop = { .stop = true };
+        xQueueSend(loop->queue, &stop, portMAX_DELAY);
+        xSemaphoreTake(loop->task_exited, portMAX_DELAY);
+        vSemaphoreDelete(loop->task_exited);
+    }
+
+    event_item_t item;
+    while (xQueueReceive(loop->queue, &item, 0) == pdTRUE) {
+        free(item.data);
+    }
+    while (loop->handlers != NULL) {
+        event_handler_node_t *next = loop->handlers->next;
+        free(loop->handlers);
+        loop->handlers = next;
+    }
+    vQueueDelete(loop->queue);
+    pthread_mutex_destroy(&loop->lock);
+    free(loop);
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_run(esp_event_loop_handle_t handle, TickType_t ticks)
+{
+    event_loop_t *loop = (event_loop_t *)handle;
+    if (loop == NULL || loop->task_exited != NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    event_item_t item;
+    while (true) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        TickType_t wait = ticks == portMAX_DELAY ? portMAX_DELAY : (elapsed < ticks ? ticks - elapsed : 0);
+        if (xQueueReceive(loop->queue, &item, wait) != pdTRUE) {
+            break;
+        }
+        event_dispatch(loop, &item);
+        free(item.data);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_handler_instance_register_with(esp_event_loop_handle_t handle, esp_event_base_t base,
+                                                   int32_t id, esp_event_handler_t handler, void *arg,
+                                                   esp_event_handler_instance_t *instance)
+{
+    event_loop_t *loop = (event_loop_t *)handle;
+    if (loop == NULL || handler == NULL || (base == ESP_EVENT_ANY_BASE && id != ESP_EVENT_ANY_ID)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    event_handler_node_t *node = calloc(1, sizeof(event_handler_node_t));
+    if (node == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    node->base = base;
+    node->id = id;
+    node->handler = handler;
+    node->arg = arg;
+
+    // 追加到链表尾部，保持注册顺序即调用顺序
+    pthread_mutex_lock(&loop->lock);
+    event_handler_node_t **link = &loop->handlers;
+    while (*link != NULL) {
+        link = &(*link)->next;
+    }
+    *link = node;
+    pthread_mutex_unlock(&loop->lock);
+
+    if (instance != NULL) {
+        *instance = node;
+    }
+    return ESP_OK;
+}
+
+/**
+ * 注销处理器，instance为NULL时按(base, id, handler)匹配
+ */
+static esp_err_t event_handler_remove(event_loop_t *loop, esp_event_base_t base, int32_t id,
+                                      esp_event_handler_t handler, event_handler_node_t *instance)
+{
+    if (loop == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    pthread_mutex_lock(&loop->lock);
+    for (event_handler_node_t **link = &loop->handlers; *link != NULL; link = &(*link)->next) {
+        event_handler_node_t *node = *link;
+        bool match = instance != NULL ? node == instance
+                                      : node->base == base && node->id == id && node->handler == handler;
+        if (match) {
+            *link = node->next;
+            free(node);
+            ret = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&loop->lock);
+    return ret;
+}
+
+esp_err_t esp_event_handler_instance_unregister_with(esp_event_loop_handle_t loop, esp_event_base_t base,
+                                                     int32_t id, esp_event_handler_instance_t instance)
+{
+    if (instance == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return event_handler_remove((event_loop_t *)loop, base, id, NULL, (event_handler_node_t *)instance);
+}
+
+esp_err_t esp_event_handler_register_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id,
+                                          esp_event_handler_t handler, void *arg)
+{
+    return esp_event_handler_instance_register_with(loop, base, id, handler, arg, NULL);
+}
+
+esp_err_t esp_event_handler_unregister_with(esp_event_loop_handle_t loop, esp_event_base_t base, int32_t id,
+                                            esp_event_handler_t handler)
+{
+    return event_handler_remove((event_loop_t *)loop, base, id, handler, NULL);
+}
+
+esp_err_t esp_event_post_to(esp_event_loop_handle_t handle, esp_event_base_t base, int32_t id,
+                            const void *data, size_t size, TickType_t ticks)
+{
+    event_loop_t *loop = (event_loop_t *)handle;
+    if (loop == NULL || base == ESP_EVENT_ANY_BASE || id == ESP_EVENT_ANY_ID) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    event_item_t item = { .base = base, .id = id };
+    if (data != NULL && size > 0) {
+        item.data = malloc(size);
+        if (item.data == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        memcpy(item.data, data, size);
+    }
+
+    if (xQueueSend(loop->queue, &item, ticks) != pdTRUE) {
+        free(item.data);
+        ESP_LOGW(TAG, "事件队列已满，丢弃事件 %s:%d", base, (int)id);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_event_loop_create_default(void)
+{
+    if (s_default_loop != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_event_loop_args_t args = {
+        .queue_size = 32,
+        .task_name = "sys_evt",
+        .task_priority = 20,
+        .task_stack_size = 2816,
+        .task_core_id = 0
+    };
+    esp_event_loop_handle_t loop = NULL;
+    esp_err_t ret = esp_event_loop_create(&args, &loop);
+    s_default_loop = (event_loop_t *)loop;
+    return ret;
+}
+
+esp_err_t esp_event_loop_delete_default(void)
+{
+    if (s_default_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = esp_event_loop_delete(s_default_loop);
+    s_default_loop = NULL;
+    return ret;
+}
+
+esp_err_t esp_event_handler_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler, void *arg)
+{
+    return esp_event_handler_register_with(s_default_loop, base, id, handler, arg);
+}
+
+esp_err_t esp_event_handler_unregister(esp_event_base_t base, int32_t id, esp_event_handler_t handler)
+{
+    return esp_event_handler_unregister_with(s_default_loop, base, id, handler);
+}
+
+esp_err_t esp_event_handler_instance_register(esp_event_base_t base, int32_t id, esp_event_handler_t handler,
+                                              void *arg, esp_event_handler_instance_t *instance)
+{
+    return esp_event_handler_instance_register_with(s_default_loop, base, id, handler, arg, instance);
+}
+
+esp_err_t esp_event_handler_instance_unregister(esp_event_base_t base, int32_t id,
+                                                esp_event_handler_instance_t instance)
+{
+    return esp_event_handler_instance_unregister_with(s_default_loop, base, id, instance);
+}
+
+esp_err_t esp_event_post(esp_event_base_t base, int32_t id, const void *data, size_t size, TickType_t ticks)
+{
+    return esp_event_post_to(s_default_loop, base, id, data, size, ticks);
+}
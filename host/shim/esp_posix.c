@@ -0,0 +1,141 @@
+/**
+ * 主机侧ESP-IDF兼容层实现: 错误码、日志、时间、随机数、GPIO、MAC地址
+ */
+
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "esp_err.h"
+#include "esp_mac.h"
+#include "esp_random.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "driver/gpio.h"
+
+static pthread_mutex_t s_log_lock = PTHREAD_MUTEX_INITIALIZER;
+static int s_log_level = -1;
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                    return "ESP_OK";
+    case ESP_FAIL:                  return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:            return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:       return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:     return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:      return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:         return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:     return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:           return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_RESPONSE:  return "ESP_ERR_INVALID_RESPONSE";
+    default:                        return "UNKNOWN ERROR";
+    }
+}
+
+int64_t esp_timer_get_time(void)
+{
+    static int64_t s_start_us = 0;
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+    if (s_start_us == 0) {
+        s_start_us = now - 1;
+    }
+    return now - s_start_us;
+}
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    s_log_level = level;
+}
+
+vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
+{
+    // 主机上始终输出到stderr
+    return vprintf;
+}
+
+void esp_log_write(esp_log_level_t level, const char *tag, const char *format, ...)
+{
+    static const char letters[] = "-EWIDV";
+
+    if (s_log_level < 0) {
+        const char *env = getenv("KVM_LOG_LEVEL");
+        s_log_level = env != NULL ? atoi(env) : ESP_LOG_INFO;
+    }
+    if ((int)level > s_log_level) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    pthread_mutex_lock(&s_log_lock);
+    fprintf(stderr, "%c (%lld) %s: ", letters[level], (long long)(esp_timer_get_time() / 1000), tag);
+    vfprintf(stderr, format, args);
+    fputc('\n', stderr);
+    pthread_mutex_unlock(&s_log_lock);
+    va_end(args);
+}
+
+void esp_restart(void)
+{
+    esp_log_write(ESP_LOG_WARN, "HOST", "esp_restart() 调用，进程退出");
+    exit(0);
+}
+
+uint32_t esp_get_free_heap_size(void)
+{
+    return 256 * 1024;
+}
+
+uint32_t esp_get_minimum_free_heap_size(void)
+{
+    return 256 * 1024;
+}
+
+uint32_t esp_random(void)
+{
+    // random()只有31位
+    return ((uint32_t)random() << 16) ^ (uint32_t)random();
+}
+
+// 虚拟GPIO的输出电平
+#define HOST_GPIO_MAX   64
+static uint8_t s_gpio_levels[HOST_GPIO_MAX];
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return config != NULL ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level)
+{
+    if (gpio_num < 0 || gpio_num >= HOST_GPIO_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_gpio_levels[gpio_num] = level != 0;
+    esp_log_write(ESP_LOG_VERBOSE, "HOST_GPIO", "GPIO%d = %u", gpio_num, (unsigned)(level != 0));
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num)
+{
+    return gpio_num >= 0 && gpio_num < HOST_GPIO_MAX ? s_gpio_levels[gpio_num] : 0;
+}
+
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type)
+{
+    if (mac == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // 本地管理地址 (02:...)，最后一字节区分接口
+    const uint8_t base[6] = { 0x02, 0x4b, 0x56, 0x4d, 0x00, 0x00 };
+    memcpy(mac, base, sizeof(base));
+    mac[5] = (uint8_t)type;
+    return ESP_OK;
+}
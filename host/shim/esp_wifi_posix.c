@@ -0,0 +1,603 @@
+/**
+ * 主机侧Wi-Fi与网络接口实现
+ * 没有射频: STA连接成功后分配127.0.0.1 (虚拟AP的BSSID为02:00:00:00:00:01，信道6)，
+ * 扫描返回固定的邻近网络列表，
+ * 事件通过默认事件循环异步投递，顺序与真实驱动一致
+ */
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "esp_wifi.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+
+ESP_EVENT_DEFINE_BASE(WIFI_EVENT);
+ESP_EVENT_DEFINE_BASE(IP_EVENT);
+
+#define HOST_WIFI_CONNECT_MS_DEFAULT    200     // 全信道扫描+关联，指定BSSID和信道时为1/4
+#define HOST_WIFI_DHCP_MS_DEFAULT       100
+#define HOST_WIFI_SCAN_CHANNELS         13
+#define HOST_WIFI_SCAN_DWELL_MS_DEFAULT 120     // 未指定时每个信道的主动扫描时间
+#define HOST_WIFI_RSSI                  -55
+#define HOST_WIFI_SCAN_MAX              8
+#define HOST_WIFI_CHANNEL               6
+
+static const uint8_t HOST_WIFI_BSSID[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+
+struct esp_netif_obj {
+    bool is_ap;
+    bool dhcpc_stopped;                 // 使用static_ip，连接后不经过DHCP
+    esp_netif_ip_info_t ip_info;
+    esp_netif_ip_info_t static_ip;
+};
+
+// 延迟投递的事件
+typedef struct {
+    esp_event_base_t base;
+    int32_t id;
+    int delay_ms;
+    size_t size;
+    uint8_t data[];
+} wifi_deferred_event_t;
+
+static const char *TAG = "HOST_WIFI";
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static bool s_inited = false;
+static bool s_started = false;
+static bool s_sta_connected = false;
+static wifi_mode_t s_mode = WIFI_MODE_NULL;
+static wifi_config_t s_sta_config;
+static wifi_config_t s_ap_config;
+static esp_netif_t s_sta_netif;
+static esp_netif_t s_ap_netif = { .is_ap = true };
+static wifi_ap_record_t s_scan_records[HOST_WIFI_SCAN_MAX];
+static uint16_t s_scan_count = 0;
+static int64_t s_scan_end_us = 0;       // 正在进行的扫描的结束时间
+
+static uint32_t ip4(uint8_t a, uint8_t b, uint8_t c, uint8_t d)
+{
+    // esp_ip4_addr_t按网络字节序保存
+    uint8_t bytes[4] = { a, b, c, d };
+    uint32_t addr;
+    memcpy(&addr, bytes, sizeof(addr));
+    return addr;
+}
+
+static int env_int(const char *name, int fallback)
+{
+    const char *value = getenv(name);
+    return value != NULL ? atoi(value) : fallback;
+}
+
+static void *wifi_deferred_thread(void *arg)
+{
+    wifi_deferred_event_t *event = (wifi_deferred_event_t *)arg;
+    if (event->delay_ms > 0) {
+        usleep((useconds_t)event->delay_ms * 1000);
+    }
+    esp_event_post(event->base, event->id, event->size > 0 ? event->data : NULL, event->size, portMAX_DELAY);
+    free(event);
+    return NULL;
+}
+
+/**
+ * 延迟delay_ms后投递事件，模拟驱动的异步完成
+ */
+static void wifi_post_later(esp_event_base_t base, int32_t id, const void *data, size_t size, int delay_ms)
+{
+    wifi_deferred_event_t *event = malloc(sizeof(wifi_deferred_event_t) + size);
+    if (event == NULL) {
+        return;
+    }
+    event->base = base;
+    event->id = id;
+    event->delay_ms = delay_ms;
+    event->size = size;
+    if (size > 0) {
+        memcpy(event->data, data, size);
+    }
+
+    pthread_t thread;
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    if (pthread_create(&thread, &attr, wifi_deferred_thread, event) != 0) {
+        free(event);
+    }
+    pthread_attr_destroy(&attr);
+}
+
+/**
+ * 目标网络是否可用: KVM_WIFI_SSID限定可连接的SSID；
+ * 设置KVM_WIFI_AP_FILE时该文件存在才可用 (删除文件模拟AP掉线，重新创建模拟AP恢复)
+ */
+static bool sta_target_available(const char *ssid)
+{
+    const char *available = getenv("KVM_WIFI_SSID");
+    const char *ap_file = getenv("KVM_WIFI_AP_FILE");
+    return ssid[0] != '\0' && (available == NULL || strcmp(available, ssid) == 0) &&
+           (ap_file == NULL || access(ap_file, F_OK) == 0);
+}
+
+/**
+ * 链路监视线程: 已连接时AP文件被删除则产生断开事件 (信标超时)
+ */
+static void *wifi_link_monitor_thread(void *arg)
+{
+    const char *ap_file = (const char *)arg;
+    while (true) {
+        usleep(100 * 1000);
+        pthread_mutex_lock(&s_lock);
+        bool lost = s_sta_connected && access(ap_file, F_OK) != 0;
+        if (lost) {
+            s_sta_connected = false;
+            s_sta_netif.ip_info.ip.addr = 0;
+        }
+        pthread_mutex_unlock(&s_lock);
+        if (lost) {
+            wifi_event_sta_disconnected_t event = { .reason = WIFI_REASON_BEACON_TIMEOUT };
+            wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event, sizeof(event), 0);
+        }
+    }
+    return NULL;
+}
+
+/* ---------------- esp_netif ---------------- */
+
+esp_err_t esp_netif_init(void)
+{
+    return ESP_OK;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_sta(void)
+{
+    return &s_sta_netif;
+}
+
+esp_netif_t *esp_netif_create_default_wifi_ap(void)
+{
+    s_ap_netif.ip_info.ip.addr = ip4(192, 168, 4, 1);
+    s_ap_netif.ip_info.gw.addr = ip4(192, 168, 4, 1);
+    s_ap_netif.ip_info.netmask.addr = ip4(255, 255, 255, 0);
+    return &s_ap_netif;
+}
+
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info)
+{
+    if (netif == NULL || ip_info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    *ip_info = netif->ip_info;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info)
+{
+    if (netif == NULL || ip_info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    bool stopped = netif->dhcpc_stopped;
+    if (stopped) {
+        netif->static_ip = *ip_info;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return stopped ? ESP_OK : ESP_ERR_INVALID_STATE;
+}
+
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *netif)
+{
+    if (netif == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    netif->dhcpc_stopped = false;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *netif)
+{
+    if (netif == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    netif->dhcpc_stopped = true;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+/* ---------------- esp_wifi ---------------- */
+
+esp_err_t esp_wifi_init(const wifi_init_config_t *config)
+{
+    if (config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_inited = true;
+
+    static bool monitor_started = false;
+    const char *ap_file = getenv("KVM_WIFI_AP_FILE");
+    if (ap_file != NULL && !monitor_started) {
+        pthread_t thread;
+        monitor_started = pthread_create(&thread, NULL, wifi_link_monitor_thread, (void *)ap_file) == 0;
+        if (monitor_started) {
+            pthread_detach(thread);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_deinit(void)
+{
+    s_inited = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_mode(wifi_mode_t mode)
+{
+    if (!s_inited) {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    if (mode >= WIFI_MODE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    wifi_mode_t old_mode = s_mode;
+    bool started = s_started;
+    bool was_connected = s_sta_connected;
+    bool had_sta = old_mode == WIFI_MODE_STA || old_mode == WIFI_MODE_APSTA;
+    bool had_ap = old_mode == WIFI_MODE_AP || old_mode == WIFI_MODE_APSTA;
+    bool has_sta = mode == WIFI_MODE_STA || mode == WIFI_MODE_APSTA;
+    bool has_ap = mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA;
+    s_mode = mode;
+    if (started && had_sta && !has_sta) {
+        s_sta_connected = false;
+        s_sta_netif.ip_info.ip.addr = 0;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    // 与驱动一致，运行中切换模式时启动或停止相应的接口
+    if (!started) {
+        return ESP_OK;
+    }
+    if (had_sta && !has_sta) {
+        if (was_connected) {
+            wifi_event_sta_disconnected_t event = { .reason = WIFI_REASON_ASSOC_LEAVE };
+            wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event, sizeof(event), 0);
+        }
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_STOP, NULL, 0, 0);
+    } else if (!had_sta && has_sta) {
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, 0);
+    }
+    if (had_ap && !has_ap) {
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_AP_STOP, NULL, 0, 0);
+    } else if (!had_ap && has_ap) {
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_AP_START, NULL, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_mode(wifi_mode_t *mode)
+{
+    if (mode == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *mode = s_mode;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    if (!s_inited) {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    if (conf == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    if (interface == WIFI_IF_STA) {
+        s_sta_config = *conf;
+    } else {
+        s_ap_config = *conf;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_get_config(wifi_interface_t interface, wifi_config_t *conf)
+{
+    if (conf == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    *conf = interface == WIFI_IF_STA ? s_sta_config : s_ap_config;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_storage(wifi_storage_t storage)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_set_ps(wifi_ps_type_t type)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_start(void)
+{
+    if (!s_inited) {
+        return ESP_ERR_WIFI_NOT_INIT;
+    }
+    pthread_mutex_lock(&s_lock);
+    bool was_started = s_started;
+    wifi_mode_t mode = s_mode;
+    s_started = true;
+    pthread_mutex_unlock(&s_lock);
+
+    // 与驱动一致，重复start不再产生事件
+    if (!was_started) {
+        if (mode == WIFI_MODE_STA || mode == WIFI_MODE_APSTA) {
+            wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_START, NULL, 0, 0);
+        }
+        if (mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA) {
+            wifi_post_later(WIFI_EVENT, WIFI_EVENT_AP_START, NULL, 0, 0);
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_stop(void)
+{
+    pthread_mutex_lock(&s_lock);
+    bool was_started = s_started;
+    bool was_connected = s_sta_connected;
+    wifi_mode_t mode = s_mode;
+    s_started = false;
+    s_sta_connected = false;
+    s_sta_netif.ip_info.ip.addr = 0;
+    pthread_mutex_unlock(&s_lock);
+
+    if (!was_started) {
+        return ESP_OK;
+    }
+    if (was_connected) {
+        wifi_event_sta_disconnected_t event = { .reason = WIFI_REASON_ASSOC_LEAVE };
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event, sizeof(event), 0);
+    }
+    if (mode == WIFI_MODE_STA || mode == WIFI_MODE_APSTA) {
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_STOP, NULL, 0, 0);
+    }
+    if (mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA) {
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_AP_STOP, NULL, 0, 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_connect(void)
+{
+    pthread_mutex_lock(&s_lock);
+    bool started = s_started;
+    bool sta_mode = s_mode == WIFI_MODE_STA || s_mode == WIFI_MODE_APSTA;
+    char ssid[33] = { 0 };
+    memcpy(ssid, s_sta_config.sta.ssid, sizeof(s_sta_config.sta.ssid));
+    bool directed = s_sta_config.sta.bssid_set;
+    bool bssid_match = memcmp(s_sta_config.sta.bssid, HOST_WIFI_BSSID, sizeof(HOST_WIFI_BSSID)) == 0 &&
+                       (s_sta_config.sta.channel == 0 || s_sta_config.sta.channel == HOST_WIFI_CHANNEL);
+    bool dhcp = !s_sta_netif.dhcpc_stopped;
+    pthread_mutex_unlock(&s_lock);
+
+    if (!started) {
+        return ESP_ERR_WIFI_NOT_STARTED;
+    }
+    if (!sta_mode) {
+        return ESP_ERR_WIFI_MODE;
+    }
+
+    // 指定BSSID和信道时只在该信道上探测，省去全信道扫描
+    int delay_ms = env_int("KVM_WIFI_CONNECT_MS", HOST_WIFI_CONNECT_MS_DEFAULT);
+    if (directed) {
+        delay_ms /= 4;
+    }
+    if (!sta_target_available(ssid) || (directed && !bssid_match)) {
+        wifi_event_sta_disconnected_t event = { .reason = WIFI_REASON_NO_AP_FOUND, .rssi = -127 };
+        memcpy(event.ssid, ssid, sizeof(event.ssid));
+        event.ssid_len = (uint8_t)strlen(ssid);
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event, sizeof(event), delay_ms);
+        return ESP_OK;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    s_sta_connected = true;
+    if (dhcp) {
+        s_sta_netif.ip_info.ip.addr = ip4(127, 0, 0, 1);
+        s_sta_netif.ip_info.gw.addr = ip4(127, 0, 0, 1);
+        s_sta_netif.ip_info.netmask.addr = ip4(255, 0, 0, 0);
+    } else {
+        s_sta_netif.ip_info = s_sta_netif.static_ip;
+    }
+    pthread_mutex_unlock(&s_lock);
+
+    wifi_event_sta_connected_t connected = {
+        .channel = HOST_WIFI_CHANNEL,
+        .authmode = WIFI_AUTH_WPA2_PSK
+    };
+    memcpy(connected.bssid, HOST_WIFI_BSSID, sizeof(connected.bssid));
+    memcpy(connected.ssid, ssid, sizeof(connected.ssid));
+    connected.ssid_len = (uint8_t)strlen(ssid);
+    wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_CONNECTED, &connected, sizeof(connected), delay_ms);
+
+    // 静态地址在关联后立即可用，否则等待DHCP
+    ip_event_got_ip_t got_ip = {
+        .esp_netif = &s_sta_netif,
+        .ip_info = s_sta_netif.ip_info,
+        .ip_changed = true
+    };
+    int dhcp_ms = dhcp ? env_int("KVM_WIFI_DHCP_MS", HOST_WIFI_DHCP_MS_DEFAULT) : 1;
+    wifi_post_later(IP_EVENT, IP_EVENT_STA_GOT_IP, &got_ip, sizeof(got_ip), delay_ms + dhcp_ms);
+    ESP_LOGD(TAG, "虚拟STA连接 %s", ssid);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_disconnect(void)
+{
+    pthread_mutex_lock(&s_lock);
+    bool was_connected = s_sta_connected;
+    s_sta_connected = false;
+    s_sta_netif.ip_info.ip.addr = 0;
+    pthread_mutex_unlock(&s_lock);
+
+    if (was_connected) {
+        wifi_event_sta_disconnected_t event = { .reason = WIFI_REASON_ASSOC_LEAVE };
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &event, sizeof(event), 0);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_ap_info(wifi_ap_record_t *ap_info)
+{
+    if (ap_info == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    bool connected = s_sta_connected;
+    memset(ap_info, 0, sizeof(*ap_info));
+    memcpy(ap_info->ssid, s_sta_config.sta.ssid, sizeof(s_sta_config.sta.ssid));
+    pthread_mutex_unlock(&s_lock);
+
+    if (!connected) {
+        return ESP_ERR_WIFI_NOT_CONNECT;
+    }
+    memcpy(ap_info->bssid, HOST_WIFI_BSSID, sizeof(HOST_WIFI_BSSID));
+    ap_info->primary = HOST_WIFI_CHANNEL;
+    // 在基准值附近抖动，覆盖RSSI阈值判断
+    ap_info->rssi = (int8_t)(env_int("KVM_WIFI_RSSI", HOST_WIFI_RSSI) + rand() % 5 - 2);
+    ap_info->authmode = WIFI_AUTH_WPA2_PSK;
+    ap_info->phy_11b = 1;
+    ap_info->phy_11g = 1;
+    ap_info->phy_11n = 1;
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_sta_get_rssi(int *rssi)
+{
+    wifi_ap_record_t info;
+    esp_err_t ret = esp_wifi_sta_get_ap_info(&info);
+    if (ret == ESP_OK && rssi != NULL) {
+        *rssi = info.rssi;
+    }
+    return ret;
+}
+
+esp_err_t esp_wifi_scan_start(const wifi_scan_config_t *config, bool block)
+{
+    if (!s_started) {
+        return ESP_ERR_WIFI_NOT_STARTED;
+    }
+
+    // 扫描耗时: 各信道驻留时间之和，KVM_WIFI_SCAN_MS可覆盖
+    int channels = config != NULL && config->channel != 0 ? 1 : HOST_WIFI_SCAN_CHANNELS;
+    int dwell_ms = config != NULL && config->scan_time.active.max != 0 ?
+                   (int)config->scan_time.active.max : HOST_WIFI_SCAN_DWELL_MS_DEFAULT;
+    int home_ms = config != NULL ? config->home_chan_dwell_time : 0;
+    int scan_ms = env_int("KVM_WIFI_SCAN_MS", channels * (dwell_ms + home_ms));
+
+    static const struct {
+        const char *ssid;
+        int8_t rssi;
+        uint8_t channel;
+        wifi_auth_mode_t authmode;
+    } neighbours[] = {
+        { "HomeNet-5F", -48, 1, WIFI_AUTH_WPA2_PSK },
+        { "Office-Guest", -63, 6, WIFI_AUTH_OPEN },
+        { "Lab-IoT", -71, 11, WIFI_AUTH_WPA_WPA2_PSK },
+        { "CMCC-8A2F", -80, 3, WIFI_AUTH_WPA2_WPA3_PSK },
+    };
+
+    pthread_mutex_lock(&s_lock);
+    // 与驱动一致，上一次扫描未完成时拒绝新的扫描
+    int64_t now_us = esp_timer_get_time();
+    if (now_us < s_scan_end_us) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_WIFI_STATE;
+    }
+    s_scan_end_us = now_us + (int64_t)scan_ms * 1000;
+    s_scan_count = 0;
+    const char *configured = getenv("KVM_WIFI_SSID");
+    if (configured == NULL) {
+        configured = (const char *)s_sta_config.sta.ssid;
+    }
+    if (configured[0] != '\0') {
+        wifi_ap_record_t *rec = &s_scan_records[s_scan_count++];
+        memset(rec, 0, sizeof(*rec));
+        strncpy((char *)rec->ssid, configured, sizeof(rec->ssid) - 1);
+        memcpy(rec->bssid, HOST_WIFI_BSSID, sizeof(HOST_WIFI_BSSID));
+        rec->primary = HOST_WIFI_CHANNEL;
+        rec->rssi = HOST_WIFI_RSSI;
+        rec->authmode = WIFI_AUTH_WPA2_PSK;
+    }
+    for (size_t i = 0; i < sizeof(neighbours) / sizeof(neighbours[0]) && s_scan_count < HOST_WIFI_SCAN_MAX; i++) {
+        wifi_ap_record_t *rec = &s_scan_records[s_scan_count++];
+        memset(rec, 0, sizeof(*rec));
+        strncpy((char *)rec->ssid, neighbours[i].ssid, sizeof(rec->ssid) - 1);
+        rec->bssid[0] = 0x02;
+        rec->bssid[5] = (uint8_t)(0x10 + i);
+        rec->primary = neighbours[i].channel;
+        rec->rssi = neighbours[i].rssi;
+        rec->authmode = neighbours[i].authmode;
+    }
+    wifi_event_sta_scan_done_t done = { .status = 0, .number = (uint8_t)s_scan_count };
+    pthread_mutex_unlock(&s_lock);
+
+    ESP_LOGD(TAG, "虚拟扫描 %d个信道，%d ms", channels, scan_ms);
+    if (block) {
+        usleep((useconds_t)scan_ms * 1000);
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &done, sizeof(done), 0);
+    } else {
+        wifi_post_later(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &done, sizeof(done), scan_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_stop(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_num(uint16_t *number)
+{
+    if (number == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&s_lock);
+    *number = s_scan_count;
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t esp_wifi_scan_get_ap_records(uint16_t *number, wifi_ap_record_t *ap_records)
+{
+    if (number == NULL || ap_records == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // 与驱动一致，读取后释放扫描结果
+    pthread_mutex_lock(&s_lock);
+    uint16_t count = *number < s_scan_count ? *number : s_scan_count;
+    memcpy(ap_records, s_scan_records, count * sizeof(wifi_ap_record_t));
+    s_scan_count = 0;
+    pthread_mutex_unlock(&s_lock);
+    *number = count;
+    return ESP_OK;
+}
@@ -0,0 +1,1518 @@
+/**
+ * 主机侧esp_http_server实现
+ * 单个服务器线程用select处理监听socket、工作队列管道和所有会话，URI处理器在该线程中执行，
+ * 与IDF的httpd任务模型一致；异步请求期间会话不参与select，完成后由管道唤醒服务器继续处理
+ */
+
+#include <arpa/inet.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "esp_http_server.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#define SESS_BUF_SIZE           (HTTPD_MAX_REQ_HDR_LEN + HTTPD_MAX_URI_LEN + 2048)
+#define RESP_HDR_BUF_SIZE       1024
+#define MAX_RESP_HEADERS        16
+#define WS_GUID                 "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+
+typedef struct httpd_data httpd_data_t;
+
+// 会话 (一个客户端连接)
+typedef struct {
+    httpd_data_t *server;
+    int fd;
+    int64_t last_active_us;         // LRU清理依据
+    httpd_send_func_t send_fn;      // httpd_sess_set_send_override设置，NULL时直接写socket
+
+    // 以下状态由服务器线程和异步请求完成者共享，修改时持有server->lock
+    bool async_busy;                // 异步请求处理中，服务器暂不读取该会话
+    bool close_pending;             // 需要在服务器线程中关闭
+    bool pending;                   // 缓冲区中可能还有完整的请求待处理
+
+    // WebSocket
+    bool ws;                        // 已完成握手
+    httpd_uri_t ws_uri;             // 握手时匹配的处理器
+
+    // 接收缓冲区: 当前请求的未读正文 + 后续流水线数据
+    char buf[SESS_BUF_SIZE];
+    size_t len;
+    size_t body_left;               // 当前请求尚未读取的正文字节数
+} httpd_sess_t;
+
+// 请求的私有数据 (httpd_req_t.aux)
+typedef struct {
+    httpd_sess_t *sess;
+    char headers[HTTPD_MAX_REQ_HDR_LEN + 1];   // "Name: value\r\n"...
+    bool http10;
+    bool keep_alive;
+    bool async_started;             // 处理器调用了httpd_req_async_handler_begin
+
+    const char *status;
+    const char *content_type;
+    struct {
+        const char *field;
+        const char *value;
+    } resp_hdrs[MAX_RESP_HEADERS];
+    size_t resp_hdr_count;
+    bool chunked_started;
+
+    // 当前WebSocket帧 (仅WebSocket请求)
+    bool ws_frame_valid;
+    httpd_ws_frame_t ws_frame;
+} httpd_req_aux_t;
+
+typedef struct {
+    httpd_work_fn_t fn;             // NULL表示仅唤醒服务器
+    void *arg;
+} httpd_work_t;
+
+struct httpd_data {
+    httpd_config_t config;
+    int listen_fd;
+    int ctrl_fds[2];                // 工作队列管道
+    pthread_t thread;
+    volatile bool stop;
+    pthread_mutex_t lock;
+
+    httpd_uri_t *handlers;
+    size_t handler_count;
+    httpd_sess_t **sessions;
+
+    httpd_req_t req;                // 服务器线程复用的请求对象
+    httpd_req_aux_t aux;
+};
+
+static const char *TAG = "HOST_HTTPD";
+
+/* ---------------- SHA-1 / Base64 (WebSocket握手) ---------------- */
+
+#define ROL32(x, n)     (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_block(uint32_t h[5], const uint8_t *p)
+{
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t)p[i * 4] << 24 | (uint32_t)p[i * 4 + 1] << 16 | (uint32_t)p[i * 4 + 2] << 8 | p[i * 4 + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = ROL32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t t = ROL32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = ROL32(b, 30);
+        b = a;
+        a = t;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+    h[4] += e;
+}
+
+static void sha1(const uint8_t *data, size_t len, uint8_t out[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+    uint8_t block[64];
+    size_t i = 0;
+
+    for (; i + 64 <= len; i += 64) {
+        sha1_block(h, data + i);
+    }
+
+    size_t rest = len - i;
+    memset(block, 0, sizeof(block));
+    memcpy(block, data + i, rest);
+    block[rest] = 0x80;
+    if (rest >= 56) {
+        sha1_block(h, block);
+        memset(block, 0, sizeof(block));
+    }
+    uint64_t bits = (uint64_t)len * 8;
+    for (int j = 0; j < 8; j++) {
+        block[63 - j] = (uint8_t)(bits >> (j * 8));
+    }
+    sha1_block(h, block);
+
+    for (int j = 0; j < 5; j++) {
+        out[j * 4] = (uint8_t)(h[j] >> 24);
+        out[j * 4 + 1] = (uint8_t)(h[j] >> 16);
+        out[j * 4 + 2] = (uint8_t)(h[j] >> 8);
+        out[j * 4 + 3] = (uint8_t)h[j];
+    }
+}
+
+static void base64_encode(const uint8_t *src, size_t len, char *out)
+{
+    static const char table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    size_t i = 0;
+    for (; i + 2 < len; i += 3) {
+        *out++ = table[src[i] >> 2];
+        *out++ = table[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+        *out++ = table[((src[i + 1] & 0x0f) << 2) | (src[i + 2] >> 6)];
+        *out++ = table[src[i + 2] & 0x3f];
+    }
+    if (i < len) {
+        *out++ = table[src[i] >> 2];
+        if (i + 1 < len) {
+            *out++ = table[((src[i] & 0x03) << 4) | (src[i + 1] >> 4)];
+            *out++ = table[(src[i + 1] & 0x0f) << 2];
+        } else {
+            *out++ = table[(src[i] & 0x03) << 4];
+            *out++ = '=';
+        }
+        *out++ = '=';
+    }
+    *out = '\0';
+}
+
+/* ---------------- socket与会话 ---------------- */
+
+/**
+ * 发送全部数据 (多段)，失败返回false
+ */
+static bool sock_send_iov(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        struct msghdr msg = { .msg_iov = iov, .msg_iovlen = iovcnt };
+        ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        while (iovcnt > 0 && (size_t)n >= iov->iov_len) {
+            n -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (char *)iov->iov_base + n;
+            iov->iov_len -= n;
+        }
+    }
+    return true;
+}
+
+/**
+ * 通过会话发送多段数据，设置了发送覆盖函数时逐段调用 (与IDF的httpd_send一致)
+ */
+static bool sess_send_iov(httpd_sess_t *sess, struct iovec *iov, int iovcnt)
+{
+    if (sess->send_fn == NULL) {
+        return sock_send_iov(sess->fd, iov, iovcnt);
+    }
+    for (int i = 0; i < iovcnt; i++) {
+        const char *p = iov[i].iov_base;
+        size_t left = iov[i].iov_len;
+        while (left > 0) {
+            int n = sess->send_fn(sess->server, sess->fd, p, left, MSG_NOSIGNAL);
+            if (n < 0) {
+                return false;
+            }
+            p += n;
+            left -= n;
+        }
+    }
+    return true;
+}
+
+static bool sess_send(httpd_sess_t *sess, const void *data, size_t len)
+{
+    struct iovec iov = { .iov_base = (void *)data, .iov_len = len };
+    return sess_send_iov(sess, &iov, 1);
+}
+
+static void server_wake(httpd_data_t *hd)
+{
+    httpd_work_t work = { 0 };
+    ssize_t n = write(hd->ctrl_fds[1], &work, sizeof(work));
+    (void)n;
+}
+
+static httpd_sess_t *sess_find(httpd_data_t *hd, int fd)
+{
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->sessions[i] != NULL && hd->sessions[i]->fd == fd) {
+            return hd->sessions[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 关闭会话 (仅在服务器线程中调用)
+ */
+static void sess_close(httpd_data_t *hd, httpd_sess_t *sess)
+{
+    pthread_mutex_lock(&hd->lock);
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->sessions[i] == sess) {
+            hd->sessions[i] = NULL;
+        }
+    }
+    pthread_mutex_unlock(&hd->lock);
+
+    ESP_LOGD(TAG, "关闭会话 fd=%d", sess->fd);
+    if (hd->config.close_fn != NULL) {
+        hd->config.close_fn(hd, sess->fd);
+    } else {
+        close(sess->fd);
+    }
+    free(sess);
+}
+
+/**
+ * 从缓冲区/socket读取当前请求的正文
+ */
+static int sess_recv_body(httpd_sess_t *sess, char *buf, size_t len)
+{
+    if (sess->body_left == 0) {
+        return 0;
+    }
+    if (len > sess->body_left) {
+        len = sess->body_left;
+    }
+
+    if (sess->len > 0) {
+        size_t n = len < sess->len ? len : sess->len;
+        if (buf != NULL) {
+            memcpy(buf, sess->buf, n);
+        }
+        memmove(sess->buf, sess->buf + n, sess->len - n);
+        sess->len -= n;
+        sess->body_left -= n;
+        return (int)n;
+    }
+
+    char scratch[512];
+    if (buf == NULL) {
+        buf = scratch;
+        len = len < sizeof(scratch) ? len : sizeof(scratch);
+    }
+    ssize_t n = recv(sess->fd, buf, len, 0);
+    if (n < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+    if (n == 0) {
+        return HTTPD_SOCK_ERR_FAIL;
+    }
+    sess->body_left -= n;
+    return (int)n;
+}
+
+/**
+ * 丢弃处理器未读取的正文，使下一个请求从正确位置开始
+ */
+static bool sess_discard_body(httpd_sess_t *sess)
+{
+    while (sess->body_left > 0) {
+        if (sess_recv_body(sess, NULL, sess->body_left) <= 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 请求结束: 丢弃剩余正文，按连接语义决定是否关闭
+ * 由服务器线程或异步请求完成者调用
+ */
+static void sess_finish_request(httpd_sess_t *sess, bool keep_alive)
+{
+    bool ok = sess_discard_body(sess);
+
+    pthread_mutex_lock(&sess->server->lock);
+    sess->async_busy = false;
+    sess->pending = true;
+    if (!ok || !keep_alive) {
+        sess->close_pending = true;
+    }
+    pthread_mutex_unlock(&sess->server->lock);
+}
+
+/* ---------------- 响应 ---------------- */
+
+static httpd_req_aux_t *req_aux(httpd_req_t *r)
+{
+    return r != NULL ? (httpd_req_aux_t *)r->aux : NULL;
+}
+
+/**
+ * 生成响应头，body_len < 0 表示分块传输
+ */
+static int format_resp_headers(httpd_req_aux_t *aux, char *buf, size_t size, ssize_t body_len)
+{
+    int len = snprintf(buf, size, "HTTP/1.1 %s\r\nContent-Type: %s\r\n",
+                       aux->status, aux->content_type);
+    if (body_len >= 0) {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "Content-Length: %zd\r\n", body_len);
+    } else {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "Transfer-Encoding: chunked\r\n");
+    }
+    for (size_t i = 0; i < aux->resp_hdr_count; i++) {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "%s: %s\r\n",
+                        aux->resp_hdrs[i].field, aux->resp_hdrs[i].value);
+    }
+    if (!aux->keep_alive) {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "Connection: close\r\n");
+    } else if (aux->http10) {
+        len += snprintf(buf + len, len < (int)size ? size - len : 0, "Connection: keep-alive\r\n");
+    }
+    len += snprintf(buf + len, len < (int)size ? size - len : 0, "\r\n");
+    return len < (int)size ? len : -1;
+}
+
+esp_err_t httpd_resp_set_status(httpd_req_t *r, const char *status)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || status == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    aux->status = status;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || type == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    aux->content_type = type;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_set_hdr(httpd_req_t *r, const char *field, const char *value)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || field == NULL || value == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_data_t *hd = (httpd_data_t *)r->handle;
+    if (aux->resp_hdr_count >= hd->config.max_resp_headers || aux->resp_hdr_count >= MAX_RESP_HEADERS) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    aux->resp_hdrs[aux->resp_hdr_count].field = field;
+    aux->resp_hdrs[aux->resp_hdr_count].value = value;
+    aux->resp_hdr_count++;
+    return ESP_OK;
+}
+
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || aux->sess == NULL) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+    if (buf == NULL) {
+        buf_len = 0;
+    } else if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = strlen(buf);
+    }
+
+    char hdr[RESP_HDR_BUF_SIZE];
+    int hdr_len = format_resp_headers(aux, hdr, sizeof(hdr), buf_len);
+    if (hdr_len < 0) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+
+    struct iovec iov[2] = {
+        { .iov_base = hdr, .iov_len = hdr_len },
+        { .iov_base = (void *)buf, .iov_len = buf_len },
+    };
+    return sess_send_iov(aux->sess, iov, buf_len > 0 ? 2 : 1) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+}
+
+esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, ssize_t buf_len)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || aux->sess == NULL) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+    if (buf == NULL) {
+        buf_len = 0;
+    } else if (buf_len == HTTPD_RESP_USE_STRLEN) {
+        buf_len = strlen(buf);
+    }
+
+    char hdr[RESP_HDR_BUF_SIZE];
+    int hdr_len = 0;
+    if (!aux->chunked_started) {
+        hdr_len = format_resp_headers(aux, hdr, sizeof(hdr), -1);
+        if (hdr_len < 0) {
+            return ESP_ERR_HTTPD_RESP_HDR;
+        }
+        aux->chunked_started = true;
+    }
+
+    // 长度为0的块表示响应结束
+    char size_line[16];
+    int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", buf_len);
+    struct iovec iov[4] = {
+        { .iov_base = hdr, .iov_len = hdr_len },
+        { .iov_base = size_line, .iov_len = size_len },
+        { .iov_base = (void *)buf, .iov_len = buf_len },
+        { .iov_base = "\r\n", .iov_len = 2 },
+    };
+    return sess_send_iov(aux->sess, iov, 4) ? ESP_OK : ESP_ERR_HTTPD_RESP_SEND;
+}
+
+esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_code_t error, const char *msg)
+{
+    static const struct {
+        const char *status;
+        const char *msg;
+    } errors[HTTPD_ERR_CODE_MAX] = {
+        [HTTPD_500_INTERNAL_SERVER_ERROR]   = { "500 Internal Server Error", "Server has encountered an unexpected error" },
+        [HTTPD_501_METHOD_NOT_IMPLEMENTED]  = { "501 Method Not Implemented", "Server does not support this method" },
+        [HTTPD_505_VERSION_NOT_SUPPORTED]   = { "505 Version Not Supported", "HTTP version not supported by server" },
+        [HTTPD_400_BAD_REQUEST]             = { "400 Bad Request", "Bad request syntax" },
+        [HTTPD_401_UNAUTHORIZED]            = { "401 Unauthorized", "No permission -- see authorization schemes" },
+        [HTTPD_403_FORBIDDEN]               = { "403 Forbidden", "Request forbidden -- authorization will not help" },
+        [HTTPD_404_NOT_FOUND]               = { "404 Not Found", "Nothing matches the given URI" },
+        [HTTPD_405_METHOD_NOT_ALLOWED]      = { "405 Method Not Allowed", "Specified method is invalid for this resource" },
+        [HTTPD_408_REQ_TIMEOUT]             = { "408 Request Timeout", "Server closed this connection" },
+        [HTTPD_411_LENGTH_REQUIRED]         = { "411 Length Required", "Client must specify Content-Length" },
+        [HTTPD_414_URI_TOO_LONG]            = { "414 URI Too Long", "URI is too long" },
+        [HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE] = { "431 Request Header Fields Too Large", "Header fields are too long" },
+    };
+    if (error < 0 || error >= HTTPD_ERR_CODE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_resp_set_status(req, errors[error].status);
+    httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
+    return httpd_resp_send(req, msg != NULL ? msg : errors[error].msg, HTTPD_RESP_USE_STRLEN);
+}
+
+/* ---------------- 请求 ---------------- */
+
+int httpd_req_to_sockfd(httpd_req_t *r)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    return aux != NULL && aux->sess != NULL ? aux->sess->fd : -1;
+}
+
+int httpd_req_recv(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || aux->sess == NULL || buf == NULL) {
+        return HTTPD_SOCK_ERR_INVALID;
+    }
+    return sess_recv_body(aux->sess, buf, buf_len);
+}
+
+/**
+ * 在请求头中查找字段，返回值的起始位置
+ */
+static const char *find_header(httpd_req_aux_t *aux, const char *field, size_t *value_len)
+{
+    size_t field_len = strlen(field);
+    const char *line = aux->headers;
+
+    while (*line != '\0') {
+        const char *end = strstr(line, "\r\n");
+        if (end == NULL) {
+            end = line + strlen(line);
+        }
+        if ((size_t)(end - line) > field_len && line[field_len] == ':' &&
+            strncasecmp(line, field, field_len) == 0) {
+            const char *value = line + field_len + 1;
+            while (value < end && (*value == ' ' || *value == '\t')) {
+                value++;
+            }
+            const char *value_end = end;
+            while (value_end > value && (value_end[-1] == ' ' || value_end[-1] == '\t')) {
+                value_end--;
+            }
+            *value_len = value_end - value;
+            return value;
+        }
+        line = *end != '\0' ? end + 2 : end;
+    }
+    return NULL;
+}
+
+size_t httpd_req_get_hdr_value_len(httpd_req_t *r, const char *field)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    size_t len = 0;
+    if (aux == NULL || field == NULL || find_header(aux, field, &len) == NULL) {
+        return 0;
+    }
+    return len;
+}
+
+esp_err_t httpd_req_get_hdr_value_str(httpd_req_t *r, const char *field, char *val, size_t val_size)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || field == NULL || val == NULL || val_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t len = 0;
+    const char *value = find_header(aux, field, &len);
+    if (value == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    size_t n = len < val_size - 1 ? len : val_size - 1;
+    memcpy(val, value, n);
+    val[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+size_t httpd_req_get_url_query_len(httpd_req_t *r)
+{
+    const char *query = r != NULL ? strchr(r->uri, '?') : NULL;
+    return query != NULL ? strlen(query + 1) : 0;
+}
+
+esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
+{
+    if (r == NULL || buf == NULL || buf_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const char *query = strchr(r->uri, '?');
+    if (query == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    query++;
+    size_t len = strlen(query);
+    size_t n = len < buf_len - 1 ? len : buf_len - 1;
+    memcpy(buf, query, n);
+    buf[n] = '\0';
+    return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+}
+
+esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size)
+{
+    if (qry == NULL || key == NULL || val == NULL || val_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    size_t key_len = strlen(key);
+    const char *p = qry;
+
+    while (*p != '\0') {
+        const char *end = strchr(p, '&');
+        if (end == NULL) {
+            end = p + strlen(p);
+        }
+        const char *eq = memchr(p, '=', end - p);
+        if (eq != NULL && (size_t)(eq - p) == key_len && strncmp(p, key, key_len) == 0) {
+            size_t len = end - eq - 1;
+            size_t n = len < val_size - 1 ? len : val_size - 1;
+            memcpy(val, eq + 1, n);
+            val[n] = '\0';
+            return n < len ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        p = *end != '\0' ? end + 1 : end;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t httpd_req_async_handler_begin(httpd_req_t *r, httpd_req_t **out)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || aux->sess == NULL || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_req_t *copy = malloc(sizeof(httpd_req_t) + sizeof(httpd_req_aux_t));
+    if (copy == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    httpd_req_aux_t *copy_aux = (httpd_req_aux_t *)(copy + 1);
+    memcpy(copy, r, sizeof(httpd_req_t));
+    memcpy(copy_aux, aux, sizeof(httpd_req_aux_t));
+    copy->aux = copy_aux;
+
+    // 会话交给异步请求，服务器在完成前不再读取
+    aux->async_started = true;
+    pthread_mutex_lock(&aux->sess->server->lock);
+    aux->sess->async_busy = true;
+    pthread_mutex_unlock(&aux->sess->server->lock);
+
+    *out = copy;
+    return ESP_OK;
+}
+
+esp_err_t httpd_req_async_handler_complete(httpd_req_t *r)
+{
+    httpd_req_aux_t *aux = req_aux(r);
+    if (aux == NULL || aux->sess == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_data_t *hd = aux->sess->server;
+    sess_finish_request(aux->sess, aux->keep_alive);
+    free(r);
+    server_wake(hd);
+    return ESP_OK;
+}
+
+/* ---------------- URI匹配 ---------------- */
+
+bool httpd_uri_match_wildcard(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+    size_t tpl_len = strlen(uri_template);
+    bool asterisk = tpl_len > 0 && uri_template[tpl_len - 1] == '*';
+    if (asterisk) {
+        tpl_len--;
+    }
+    bool quest = tpl_len > 0 && uri_template[tpl_len - 1] == '?';
+    if (quest) {
+        tpl_len--;
+    }
+
+    // "/path/?" 匹配 "/path" 与 "/path/"，"/path/*" 匹配以 "/path/" 开头的URI
+    if (match_upto < tpl_len) {
+        return quest && match_upto == tpl_len - 1 && strncmp(uri_template, uri_to_match, match_upto) == 0;
+    }
+    if (strncmp(uri_template, uri_to_match, tpl_len) != 0) {
+        return false;
+    }
+    return asterisk || match_upto == tpl_len;
+}
+
+static bool uri_matches(httpd_data_t *hd, const char *reference, const char *uri, size_t len)
+{
+    if (hd->config.uri_match_fn != NULL) {
+        return hd->config.uri_match_fn(reference, uri, len);
+    }
+    return strlen(reference) == len && strncmp(reference, uri, len) == 0;
+}
+
+/**
+ * 查找URI处理器，没有匹配时通过err返回404或405
+ */
+static bool find_uri_handler(httpd_data_t *hd, const char *uri, int method, httpd_uri_t *out,
+                             httpd_err_code_t *err)
+{
+    const char *query = strchr(uri, '?');
+    size_t len = query != NULL ? (size_t)(query - uri) : strlen(uri);
+    bool found = false;
+
+    *err = HTTPD_404_NOT_FOUND;
+    pthread_mutex_lock(&hd->lock);
+    for (size_t i = 0; i < hd->handler_count; i++) {
+        if (!uri_matches(hd, hd->handlers[i].uri, uri, len)) {
+            continue;
+        }
+        if ((int)hd->handlers[i].method == method || (int)hd->handlers[i].method == HTTP_ANY) {
+            *out = hd->handlers[i];
+            found = true;
+            break;
+        }
+        *err = HTTPD_405_METHOD_NOT_ALLOWED;
+    }
+    pthread_mutex_unlock(&hd->lock);
+    return found;
+}
+
+esp_err_t httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t *uri_handler)
+{
+    httpd_data_t *hd = (httpd_data_t *)handle;
+    if (hd == NULL || uri_handler == NULL || uri_handler->uri == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_OK;
+    pthread_mutex_lock(&hd->lock);
+    for (size_t i = 0; i < hd->handler_count; i++) {
+        if (hd->handlers[i].method == uri_handler->method && strcmp(hd->handlers[i].uri, uri_handler->uri) == 0) {
+            ret = ESP_ERR_HTTPD_HANDLER_EXISTS;
+            break;
+        }
+    }
+    if (ret == ESP_OK && hd->handler_count >= hd->config.max_uri_handlers) {
+        ret = ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+    if (ret == ESP_OK) {
+        // 与IDF一样复制URI字符串，调用者可以使用临时缓冲区
+        hd->handlers[hd->handler_count] = *uri_handler;
+        hd->handlers[hd->handler_count].uri = strdup(uri_handler->uri);
+        hd->handler_count++;
+    }
+    pthread_mutex_unlock(&hd->lock);
+
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "注册URI处理器失败 %s: %s", uri_handler->uri,
+                 ret == ESP_ERR_HTTPD_HANDLERS_FULL ? "处理器已满" : "处理器已存在");
+    }
+    return ret;
+}
+
+esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle, const char *uri, httpd_method_t method)
+{
+    httpd_data_t *hd = (httpd_data_t *)handle;
+    if (hd == NULL || uri == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    pthread_mutex_lock(&hd->lock);
+    for (size_t i = 0; i < hd->handler_count; i++) {
+        if (hd->handlers[i].method == method && strcmp(hd->handlers[i].uri, uri) == 0) {
+            free((void *)hd->handlers[i].uri);
+            hd->handlers[i] = hd->handlers[--hd->handler_count];
+            ret = ESP_OK;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&hd->lock);
+    return ret;
+}
+
+/* ---------------- WebSocket ---------------- */
+
+static esp_err_t ws_send(int fd, httpd_ws_frame_t *frame)
+{
+    if (frame == NULL || (frame->len > 0 && frame->payload == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint8_t hdr[10];
+    size_t hdr_len = 2;
+    hdr[0] = (frame->final || !frame->fragmented ? 0x80 : 0x00) | (frame->type & 0x0f);
+    if (frame->len < 126) {
+        hdr[1] = (uint8_t)frame->len;
+    } else if (frame->len <= 0xffff) {
+        hdr[1] = 126;
+        hdr[2] = (uint8_t)(frame->len >> 8);
+        hdr[3] = (uint8_t)frame->len;
+        hdr_len = 4;
+    } else {
+        hdr[1] = 127;
+        for (int i = 0; i < 8; i++) {
+            hdr[2 + i] = (uint8_t)((uint64_t)frame->len >> (56 - i * 8));
+        }
+        hdr_len = 10;
+    }
+
+    struct iovec iov[2] = {
+        { .iov_base = hdr, .iov_len = hdr_len },
+        { .iov_base = frame->payload, .iov_len = frame->len },
+    };
+    return sock_send_iov(fd, iov, frame->len > 0 ? 2 : 1) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_ws_recv_frame(httpd_req_t *req, httpd_ws_frame_t *pkt, size_t max_len)
+{
+    httpd_req_aux_t *aux = req_aux(req);
+    if (aux == NULL || pkt == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!aux->ws_frame_valid) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    pkt->final = aux->ws_frame.final;
+    pkt->fragmented = aux->ws_frame.fragmented;
+    pkt->type = aux->ws_frame.type;
+    pkt->len = aux->ws_frame.len;
+    if (max_len == 0) {
+        return ESP_OK;
+    }
+    if (pkt->payload == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (aux->ws_frame.len > max_len) {
+        ESP_LOGW(TAG, "WebSocket消息过长: %zu > %zu", aux->ws_frame.len, max_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(pkt->payload, aux->ws_frame.payload, aux->ws_frame.len);
+    return ESP_OK;
+}
+
+esp_err_t httpd_ws_send_frame(httpd_req_t *req, httpd_ws_frame_t *pkt)
+{
+    httpd_req_aux_t *aux = req_aux(req);
+    if (aux == NULL || aux->sess == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ws_send(aux->sess->fd, pkt);
+}
+
+esp_err_t httpd_ws_send_frame_async(httpd_handle_t hd, int fd, httpd_ws_frame_t *frame)
+{
+    httpd_data_t *server = (httpd_data_t *)hd;
+    if (server == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&server->lock);
+    httpd_sess_t *sess = sess_find(server, fd);
+    bool ws = sess != NULL && sess->ws;
+    pthread_mutex_unlock(&server->lock);
+    return ws ? ws_send(fd, frame) : ESP_FAIL;
+}
+
+httpd_ws_client_info_t httpd_ws_get_fd_info(httpd_handle_t hd, int fd)
+{
+    httpd_data_t *server = (httpd_data_t *)hd;
+    if (server == NULL) {
+        return HTTPD_WS_CLIENT_INVALID;
+    }
+    pthread_mutex_lock(&server->lock);
+    httpd_sess_t *sess = sess_find(server, fd);
+    httpd_ws_client_info_t info = sess == NULL ? HTTPD_WS_CLIENT_INVALID :
+                                  sess->ws ? HTTPD_WS_CLIENT_WEBSOCKET : HTTPD_WS_CLIENT_HTTP;
+    pthread_mutex_unlock(&server->lock);
+    return info;
+}
+
+/**
+ * 握手: 回复101并把会话切换为WebSocket
+ */
+static bool ws_handshake(httpd_data_t *hd, httpd_sess_t *sess)
+{
+    char key[64];
+    if (httpd_req_get_hdr_value_str(&hd->req, "Sec-WebSocket-Key", key, sizeof(key)) != ESP_OK) {
+        httpd_resp_send_err(&hd->req, HTTPD_400_BAD_REQUEST, "Missing Sec-WebSocket-Key");
+        return false;
+    }
+
+    char material[sizeof(key) + sizeof(WS_GUID)];
+    uint8_t digest[20];
+    char accept[32];
+    int material_len = snprintf(material, sizeof(material), "%s%s", key, WS_GUID);
+    sha1((const uint8_t *)material, material_len, digest);
+    base64_encode(digest, sizeof(digest), accept);
+
+    char resp[256];
+    int len = snprintf(resp, sizeof(resp),
+                       "HTTP/1.1 101 Switching Protocols\r\n"
+                       "Upgrade: websocket\r\n"
+                       "Connection: Upgrade\r\n"
+                       "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+    if (!sess_send(sess, resp, len)) {
+        return false;
+    }
+
+    pthread_mutex_lock(&hd->lock);
+    sess->ws = true;
+    pthread_mutex_unlock(&hd->lock);
+    ESP_LOGD(TAG, "WebSocket握手完成 fd=%d", sess->fd);
+    return true;
+}
+
+/**
+ * 解析并处理缓冲区中的一个WebSocket帧
+ * @return 1 已处理一帧，0 数据不完整，-1 需要关闭会话
+ */
+static int ws_process_frame(httpd_data_t *hd, httpd_sess_t *sess)
+{
+    uint8_t *p = (uint8_t *)sess->buf;
+    if (sess->len < 2) {
+        return 0;
+    }
+
+    bool final = (p[0] & 0x80) != 0;
+    httpd_ws_type_t type = (httpd_ws_type_t)(p[0] & 0x0f);
+    bool masked = (p[1] & 0x80) != 0;
+    uint64_t payload_len = p[1] & 0x7f;
+    size_t hdr_len = 2;
+
+    if (payload_len == 126) {
+        if (sess->len < 4) {
+            return 0;
+        }
+        payload_len = (uint64_t)p[2] << 8 | p[3];
+        hdr_len = 4;
+    } else if (payload_len == 127) {
+        if (sess->len < 10) {
+            return 0;
+        }
+        payload_len = 0;
+        for (int i = 0; i < 8; i++) {
+            payload_len = payload_len << 8 | p[2 + i];
+        }
+        hdr_len = 10;
+    }
+    if (masked) {
+        hdr_len += 4;
+    }
+    if (hdr_len + payload_len > sizeof(sess->buf)) {
+        ESP_LOGW(TAG, "WebSocket帧过大 (%llu字节)，关闭连接 fd=%d", (unsigned long long)payload_len, sess->fd);
+        return -1;
+    }
+    size_t total = hdr_len + (size_t)payload_len;
+    if (sess->len < total) {
+        return 0;
+    }
+
+    uint8_t *payload = p + hdr_len;
+    if (masked) {
+        const uint8_t *mask = p + hdr_len - 4;
+        for (size_t i = 0; i < payload_len; i++) {
+            payload[i] ^= mask[i % 4];
+        }
+    }
+
+    int result = 1;
+    httpd_ws_frame_t frame = {
+        .final = final,
+        .fragmented = !final || type == HTTPD_WS_TYPE_CONTINUE,
+        .type = type,
+        .payload = payload,
+        .len = (size_t)payload_len
+    };
+
+    bool control = type == HTTPD_WS_TYPE_CLOSE || type == HTTPD_WS_TYPE_PING || type == HTTPD_WS_TYPE_PONG;
+    if (control && !sess->ws_uri.handle_ws_control_frames) {
+        // 控制帧由服务器自动应答
+        if (type == HTTPD_WS_TYPE_PING) {
+            frame.type = HTTPD_WS_TYPE_PONG;
+            ws_send(sess->fd, &frame);
+        } else if (type == HTTPD_WS_TYPE_CLOSE) {
+            frame.len = frame.len >= 2 ? 2 : 0;
+            ws_send(sess->fd, &frame);
+            result = -1;
+        }
+    } else {
+        httpd_req_t *req = &hd->req;
+        httpd_req_aux_t *aux = &hd->aux;
+        memset(req, 0, sizeof(*req));
+        memset(aux, 0, sizeof(*aux));
+        req->handle = hd;
+        req->aux = aux;
+        req->user_ctx = sess->ws_uri.user_ctx;
+        snprintf((char *)req->uri, sizeof(req->uri), "%s", sess->ws_uri.uri);
+        aux->sess = sess;
+        aux->keep_alive = true;
+        aux->status = HTTPD_200;
+        aux->content_type = HTTPD_TYPE_TEXT;
+        aux->ws_frame_valid = true;
+        aux->ws_frame = frame;
+
+        if (sess->ws_uri.handler(req) != ESP_OK || type == HTTPD_WS_TYPE_CLOSE) {
+            result = -1;
+        }
+    }
+
+    memmove(sess->buf, sess->buf + total, sess->len - total);
+    sess->len -= total;
+    return result;
+}
+
+/* ---------------- HTTP请求解析 ---------------- */
+
+static int parse_method(const char *s, size_t len)
+{
+    static const struct {
+        const char *name;
+        int method;
+    } methods[] = {
+        { "GET", HTTP_GET }, { "POST", HTTP_POST }, { "PUT", HTTP_PUT },
+        { "DELETE", HTTP_DELETE }, { "HEAD", HTTP_HEAD }, { "OPTIONS", HTTP_OPTIONS },
+        { "PATCH", HTTP_PATCH }, { "TRACE", HTTP_TRACE }, { "CONNECT", HTTP_CONNECT },
+    };
+    for (size_t i = 0; i < sizeof(methods) / sizeof(methods[0]); i++) {
+        if (strlen(methods[i].name) == len && strncmp(methods[i].name, s, len) == 0) {
+            return methods[i].method;
+        }
+    }
+    return -1;
+}
+
+static bool header_has_token(httpd_req_t *req, const char *field, const char *token)
+{
+    char value[128];
+    if (httpd_req_get_hdr_value_str(req, field, value, sizeof(value)) == ESP_ERR_NOT_FOUND) {
+        return false;
+    }
+    for (char *p = value; *p != '\0'; p++) {
+        *p = (char)tolower((unsigned char)*p);
+    }
+    return strstr(value, token) != NULL;
+}
+
+/**
+ * 解析缓冲区中的一个HTTP请求并调用处理器
+ * @return 1 已处理一个请求，0 数据不完整，-1 需要关闭会话
+ */
+static int http_process_request(httpd_data_t *hd, httpd_sess_t *sess)
+{
+    httpd_req_t *req = &hd->req;
+    httpd_req_aux_t *aux = &hd->aux;
+
+    memset(req, 0, sizeof(*req));
+    memset(aux, 0, sizeof(*aux));
+    req->handle = hd;
+    req->aux = aux;
+    aux->sess = sess;
+    aux->status = HTTPD_200;
+    aux->content_type = HTTPD_TYPE_TEXT;
+    aux->keep_alive = false;
+
+    char *end = memmem(sess->buf, sess->len, "\r\n\r\n", 4);
+    if (end == NULL) {
+        if (sess->len >= sizeof(sess->buf)) {
+            httpd_resp_send_err(req, HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE, NULL);
+            return -1;
+        }
+        return 0;
+    }
+    size_t hdr_total = end - sess->buf + 4;
+    *end = '\0';
+
+    // 请求行: METHOD SP URI SP VERSION
+    char *line_end = strstr(sess->buf, "\r\n");
+    char *headers = line_end != NULL ? line_end + 2 : end;
+    if (line_end != NULL) {
+        *line_end = '\0';
+    }
+    char *method_end = strchr(sess->buf, ' ');
+    char *uri = method_end != NULL ? method_end + 1 : NULL;
+    char *uri_end = uri != NULL ? strchr(uri, ' ') : NULL;
+    if (uri_end == NULL || strncmp(uri_end + 1, "HTTP/1.", 7) != 0) {
+        httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, NULL);
+        return -1;
+    }
+    aux->http10 = uri_end[8] == '0';
+    req->method = parse_method(sess->buf, method_end - sess->buf);
+    if (req->method < 0) {
+        httpd_resp_send_err(req, HTTPD_501_METHOD_NOT_IMPLEMENTED, NULL);
+        return -1;
+    }
+    if ((size_t)(uri_end - uri) > HTTPD_MAX_URI_LEN) {
+        httpd_resp_send_err(req, HTTPD_414_URI_TOO_LONG, NULL);
+        return -1;
+    }
+    memcpy((char *)req->uri, uri, uri_end - uri);
+
+    size_t headers_len = line_end != NULL ? (size_t)(end - headers) : 0;
+    if (headers_len > HTTPD_MAX_REQ_HDR_LEN - 2) {
+        httpd_resp_send_err(req, HTTPD_431_REQ_HDR_FIELDS_TOO_LARGE, NULL);
+        return -1;
+    }
+    memcpy(aux->headers, headers, headers_len);
+    if (headers_len > 0) {
+        memcpy(aux->headers + headers_len, "\r\n", 3);
+    }
+
+    // 请求头已复制，从缓冲区移除，剩余数据是正文和后续请求
+    memmove(sess->buf, sess->buf + hdr_total, sess->len - hdr_total);
+    sess->len -= hdr_total;
+
+    char value[32];
+    if (httpd_req_get_hdr_value_str(req, "Content-Length", value, sizeof(value)) == ESP_OK) {
+        req->content_len = strtoul(value, NULL, 10);
+    }
+    sess->body_left = req->content_len;
+    aux->keep_alive = aux->http10 ? header_has_token(req, "Connection", "keep-alive")
+                                  : !header_has_token(req, "Connection", "close");
+
+    httpd_uri_t handler;
+    httpd_err_code_t err;
+    if (!find_uri_handler(hd, req->uri, req->method, &handler, &err)) {
+        ESP_LOGD(TAG, "未找到处理器: %s", req->uri);
+        httpd_resp_send_err(req, err, NULL);
+        return sess_discard_body(sess) && aux->keep_alive ? 1 : -1;
+    }
+    req->user_ctx = handler.user_ctx;
+
+    esp_err_t ret;
+    if (handler.is_websocket) {
+        if (req->method != HTTP_GET || !header_has_token(req, "Upgrade", "websocket")) {
+            httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "WebSocket upgrade required");
+            return -1;
+        }
+        if (!ws_handshake(hd, sess)) {
+            return -1;
+        }
+        sess->ws_uri = handler;
+        // IDF在握手完成后以GET方法调用一次处理器
+        ret = handler.handler(req);
+        return ret == ESP_OK ? 1 : -1;
+    }
+
+    ret = handler.handler(req);
+    if (aux->async_started) {
+        // 会话由异步请求接管，完成时再结束请求
+        return 1;
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGD(TAG, "处理器返回错误，关闭连接: %s", req->uri);
+        return -1;
+    }
+    sess_finish_request(sess, aux->keep_alive);
+    return 1;
+}
+
+/**
+ * 处理会话中已收到的数据，必要时关闭会话
+ */
+static void sess_process(httpd_data_t *hd, httpd_sess_t *sess, bool readable)
+{
+    if (readable) {
+        ssize_t n = recv(sess->fd, sess->buf + sess->len, sizeof(sess->buf) - sess->len, 0);
+        if (n <= 0) {
+            sess_close(hd, sess);
+            return;
+        }
+        sess->len += n;
+    }
+    sess->last_active_us = esp_timer_get_time();
+
+    while (true) {
+        pthread_mutex_lock(&hd->lock);
+        bool busy = sess->async_busy;
+        bool closing = sess->close_pending;
+        sess->pending = false;
+        pthread_mutex_unlock(&hd->lock);
+        if (closing && !busy) {
+            sess_close(hd, sess);
+            return;
+        }
+        if (busy || sess->len == 0) {
+            return;
+        }
+
+        int result = sess->ws ? ws_process_frame(hd, sess) : http_process_request(hd, sess);
+        if (result < 0) {
+            sess_close(hd, sess);
+            return;
+        }
+        if (result == 0) {
+            return;
+        }
+    }
+}
+
+/**
+ * 查找空闲会话槽位，已满且启用LRU清理时关闭最久未活动的会话
+ */
+static int sess_alloc_slot(httpd_data_t *hd)
+{
+    httpd_sess_t *lru = NULL;
+
+    pthread_mutex_lock(&hd->lock);
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        httpd_sess_t *s = hd->sessions[i];
+        if (s == NULL) {
+            pthread_mutex_unlock(&hd->lock);
+            return i;
+        }
+        if (!s->async_busy && (lru == NULL || s->last_active_us < lru->last_active_us)) {
+            lru = s;
+        }
+    }
+    pthread_mutex_unlock(&hd->lock);
+
+    if (!hd->config.lru_purge_enable || lru == NULL) {
+        return -1;
+    }
+    ESP_LOGD(TAG, "会话已满，关闭最久未活动的连接 fd=%d", lru->fd);
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        if (hd->sessions[i] == lru) {
+            sess_close(hd, lru);
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void server_accept(httpd_data_t *hd)
+{
+    int fd = accept4(hd->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+    if (fd < 0) {
+        return;
+    }
+
+    int slot = sess_alloc_slot(hd);
+    if (slot < 0) {
+        ESP_LOGW(TAG, "会话已满，拒绝连接");
+        close(fd);
+        return;
+    }
+
+    int one = 1;
+    struct timeval recv_tv = { .tv_sec = hd->config.recv_wait_timeout };
+    struct timeval send_tv = { .tv_sec = hd->config.send_wait_timeout };
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recv_tv, sizeof(recv_tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_tv, sizeof(send_tv));
+
+    if (hd->config.open_fn != NULL && hd->config.open_fn(hd, fd) != ESP_OK) {
+        close(fd);
+        return;
+    }
+
+    httpd_sess_t *sess = calloc(1, sizeof(httpd_sess_t));
+    if (sess == NULL) {
+        close(fd);
+        return;
+    }
+    sess->server = hd;
+    sess->fd = fd;
+    sess->last_active_us = esp_timer_get_time();
+
+    pthread_mutex_lock(&hd->lock);
+    hd->sessions[slot] = sess;
+    pthread_mutex_unlock(&hd->lock);
+    ESP_LOGD(TAG, "新会话 fd=%d", fd);
+}
+
+/**
+ * 执行管道中排队的工作函数
+ */
+static void server_run_work(httpd_data_t *hd)
+{
+    httpd_work_t work;
+    while (read(hd->ctrl_fds[0], &work, sizeof(work)) == sizeof(work)) {
+        if (work.fn != NULL) {
+            work.fn(work.arg);
+        }
+    }
+}
+
+static void *server_task(void *arg)
+{
+    httpd_data_t *hd = (httpd_data_t *)arg;
+    httpd_sess_t *ready[hd->config.max_open_sockets];
+
+    while (!hd->stop) {
+        fd_set fds;
+        FD_ZERO(&fds);
+        FD_SET(hd->listen_fd, &fds);
+        FD_SET(hd->ctrl_fds[0], &fds);
+        int max_fd = hd->listen_fd > hd->ctrl_fds[0] ? hd->listen_fd : hd->ctrl_fds[0];
+
+        pthread_mutex_lock(&hd->lock);
+        for (int i = 0; i < hd->config.max_open_sockets; i++) {
+            httpd_sess_t *sess = hd->sessions[i];
+            if (sess != NULL && !sess->async_busy) {
+                FD_SET(sess->fd, &fds);
+                max_fd = sess->fd > max_fd ? sess->fd : max_fd;
+            }
+        }
+        pthread_mutex_unlock(&hd->lock);
+
+        if (select(max_fd + 1, &fds, NULL, NULL, NULL) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            ESP_LOGE(TAG, "select失败: %s", strerror(errno));
+            break;
+        }
+
+        if (FD_ISSET(hd->ctrl_fds[0], &fds)) {
+            server_run_work(hd);
+        }
+
+        // 工作函数可能关闭会话，先取快照再逐个处理
+        int count = 0;
+        pthread_mutex_lock(&hd->lock);
+        for (int i = 0; i < hd->config.max_open_sockets; i++) {
+            httpd_sess_t *sess = hd->sessions[i];
+            if (sess != NULL && !sess->async_busy &&
+                (FD_ISSET(sess->fd, &fds) || sess->pending || sess->close_pending)) {
+                ready[count++] = sess;
+            }
+        }
+        pthread_mutex_unlock(&hd->lock);
+        for (int i = 0; i < count; i++) {
+            sess_process(hd, ready[i], FD_ISSET(ready[i]->fd, &fds));
+        }
+
+        if (FD_ISSET(hd->listen_fd, &fds)) {
+            server_accept(hd);
+        }
+    }
+    return NULL;
+}
+
+/* ---------------- 服务器生命周期 ---------------- */
+
+esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *arg)
+{
+    httpd_data_t *hd = (httpd_data_t *)handle;
+    if (hd == NULL || work == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    httpd_work_t item = { .fn = work, .arg = arg };
+    return write(hd->ctrl_fds[1], &item, sizeof(item)) == sizeof(item) ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t httpd_sess_trigger_close(httpd_handle_t handle, int sockfd)
+{
+    httpd_data_t *hd = (httpd_data_t *)handle;
+    if (hd == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&hd->lock);
+    httpd_sess_t *sess = sess_find(hd, sockfd);
+    if (sess != NULL) {
+        sess->close_pending = true;
+    }
+    pthread_mutex_unlock(&hd->lock);
+    if (sess == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    server_wake(hd);
+    return ESP_OK;
+}
+
+esp_err_t httpd_sess_set_send_override(httpd_handle_t handle, int sockfd, httpd_send_func_t send_func)
+{
+    httpd_data_t *hd = (httpd_data_t *)handle;
+    if (hd == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&hd->lock);
+    httpd_sess_t *sess = sess_find(hd, sockfd);
+    if (sess != NULL) {
+        sess->send_fn = send_func;
+    }
+    pthread_mutex_unlock(&hd->lock);
+    return sess != NULL ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+void *httpd_get_global_user_ctx(httpd_handle_t handle)
+{
+    httpd_data_t *hd = (httpd_data_t *)handle;
+    return hd != NULL ? hd->config.global_user_ctx : NULL;
+}
+
+esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
+{
+    if (handle == NULL || config == NULL || config->max_open_sockets == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    httpd_data_t *hd = calloc(1, sizeof(httpd_data_t));
+    if (hd == NULL) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    hd->config = *config;
+    hd->handlers = calloc(config->max_uri_handlers, sizeof(httpd_uri_t));
+    hd->sessions = calloc(config->max_open_sockets, sizeof(httpd_sess_t *));
+    pthread_mutex_init(&hd->lock, NULL);
+    if (hd->handlers == NULL || hd->sessions == NULL || pipe2(hd->ctrl_fds, O_CLOEXEC | O_NONBLOCK) != 0) {
+        free(hd->handlers);
+        free(hd->sessions);
+        free(hd);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    // 写端阻塞，工作队列满时httpd_queue_work等待而不是丢弃
+    fcntl(hd->ctrl_fds[1], F_SETFL, 0);
+
+    // 80端口需要特权，主机上改用KVM_HTTP_PORT指定的端口
+    const char *port_env = getenv("KVM_HTTP_PORT");
+    uint16_t port = port_env != NULL ? (uint16_t)atoi(port_env) : HOST_HTTPD_DEFAULT_PORT;
+
+    int one = 1;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    hd->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (hd->listen_fd < 0 ||
+        setsockopt(hd->listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)) != 0 ||
+        bind(hd->listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(hd->listen_fd, config->backlog_conn) != 0) {
+        ESP_LOGE(TAG, "监听127.0.0.1:%d失败: %s", port, strerror(errno));
+        if (hd->listen_fd >= 0) {
+            close(hd->listen_fd);
+        }
+        close(hd->ctrl_fds[0]);
+        close(hd->ctrl_fds[1]);
+        free(hd->handlers);
+        free(hd->sessions);
+        free(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
+
+    if (pthread_create(&hd->thread, NULL, server_task, hd) != 0) {
+        close(hd->listen_fd);
+        close(hd->ctrl_fds[0]);
+        close(hd->ctrl_fds[1]);
+        free(hd->handlers);
+        free(hd->sessions);
+        free(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
+    pthread_setname_np(hd->thread, "httpd");
+
+    ESP_LOGI(TAG, "HTTP服务器监听 127.0.0.1:%d", port);
+    *handle = hd;
+    return ESP_OK;
+}
+
+esp_err_t httpd_stop(httpd_handle_t handle)
+{
+    httpd_data_t *hd = (httpd_data_t *)handle;
+    if (hd == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    hd->stop = true;
+    server_wake(hd);
+    pthread_join(hd->thread, NULL);
+
+    // 仍被异步请求持有的会话不能释放，服务器对象也随之保留
+    bool async_pending = false;
+    for (int i = 0; i < hd->config.max_open_sockets; i++) {
+        httpd_sess_t *sess = hd->sessions[i];
+        if (sess == NULL) {
+            continue;
+        }
+        if (sess->async_busy) {
+            async_pending = true;
+        } else {
+            sess_close(hd, sess);
+        }
+    }
+    close(hd->listen_fd);
+    if (async_pending) {
+        ESP_LOGW(TAG, "仍有未完成的异步请求，保留服务器资源");
+        return ESP_OK;
+    }
+
+    close(hd->ctrl_fds[0]);
+    close(hd->ctrl_fds[1]);
+    for (size_t i = 0; i < hd->handler_count; i++) {
+        free((void *)hd->handlers[i].uri);
+    }
+    if (hd->config.global_user_ctx_free_fn != NULL) {
+        hd->config.global_user_ctx_free_fn(hd->config.global_user_ctx);
+    }
+    pthread_mutex_destroy(&hd->lock);
+    free(hd->handlers);
+    free(hd->sessions);
+    free(hd);
+    return ESP_OK;
+}
@@ -0,0 +1,34 @@
+/**
+ * 主机侧ESP-IDF兼容层: MAC地址
+ */
+
+#ifndef HOST_SHIM_ESP_MAC_H
+#define HOST_SHIM_ESP_MAC_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    ESP_MAC_WIFI_STA,
+    ESP_MAC_WIFI_SOFTAP,
+    ESP_MAC_BT,
+    ESP_MAC_ETH
+} esp_mac_type_t;
+
+#define MACSTR              "%02x:%02x:%02x:%02x:%02x:%02x"
+#define MAC2STR(a)          (a)[0], (a)[1], (a)[2], (a)[3], (a)[4], (a)[5]
+
+/**
+ * 读取MAC地址，主机上返回固定的本地管理地址
+ */
+esp_err_t esp_read_mac(uint8_t *mac, esp_mac_type_t type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_ESP_MAC_H
@@ -0,0 +1,67 @@
+/**
+ * 主机侧ESP-IDF兼容层: 网络接口
+ * 只有占位的netif对象，虚拟Wi-Fi连接成功时由虚拟DHCP分配127.0.0.1，停止DHCP客户端时使用静态地址
+ */
+
+#ifndef HOST_SHIM_ESP_NETIF_H
+#define HOST_SHIM_ESP_NETIF_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct esp_netif_obj esp_netif_t;
+
+typedef struct {
+    uint32_t addr;                  // 网络字节序
+} esp_ip4_addr_t;
+
+typedef struct {
+    esp_ip4_addr_t ip;
+    esp_ip4_addr_t netmask;
+    esp_ip4_addr_t gw;
+} esp_netif_ip_info_t;
+
+#define esp_ip4_addr_get_byte(ipaddr, idx)  (((const uint8_t *)(&(ipaddr)->addr))[idx])
+#define IPSTR                   "%d.%d.%d.%d"
+#define IP2STR(ipaddr)          esp_ip4_addr_get_byte(ipaddr, 0), \
+                                esp_ip4_addr_get_byte(ipaddr, 1), \
+                                esp_ip4_addr_get_byte(ipaddr, 2), \
+                                esp_ip4_addr_get_byte(ipaddr, 3)
+
+ESP_EVENT_DECLARE_BASE(IP_EVENT);
+
+typedef enum {
+    IP_EVENT_STA_GOT_IP,
+    IP_EVENT_STA_LOST_IP,
+    IP_EVENT_AP_STAIPASSIGNED
+} ip_event_t;
+
+typedef struct {
+    esp_netif_t *esp_netif;
+    esp_netif_ip_info_t ip_info;
+    bool ip_changed;
+} ip_event_got_ip_t;
+
+esp_err_t esp_netif_init(void);
+esp_netif_t *esp_netif_create_default_wifi_sta(void);
+esp_netif_t *esp_netif_create_default_wifi_ap(void);
+esp_err_t esp_netif_get_ip_info(esp_netif_t *netif, esp_netif_ip_info_t *ip_info);
+
+/**
+ * 设置静态地址 (须先停止DHCP客户端)，STA连接后直接以该地址产生IP_EVENT_STA_GOT_IP
+ */
+esp_err_t esp_netif_set_ip_info(esp_netif_t *netif, const esp_netif_ip_info_t *ip_info);
+esp_err_t esp_netif_dhcpc_start(esp_netif_t *netif);
+esp_err_t esp_netif_dhcpc_stop(esp_netif_t *netif);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_ESP_NETIF_H
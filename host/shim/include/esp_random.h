@@ -0,0 +1,23 @@
+/**
+ * 主机侧ESP-IDF兼容层: 随机数
+ */
+
+#ifndef HOST_SHIM_ESP_RANDOM_H
+#define HOST_SHIM_ESP_RANDOM_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 32位随机数 (主机上使用random()，不用于加密)
+ */
+uint32_t esp_random(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_ESP_RANDOM_H
@@ -0,0 +1,30 @@
+/**
+ * 主机侧ESP-IDF兼容层: 系统接口
+ */
+
+#ifndef HOST_SHIM_ESP_SYSTEM_H
+#define HOST_SHIM_ESP_SYSTEM_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 主机上退出进程
+ */
+void esp_restart(void) __attribute__((noreturn));
+
+/**
+ * 主机上没有堆统计，返回固定值
+ */
+uint32_t esp_get_free_heap_size(void);
+uint32_t esp_get_minimum_free_heap_size(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_ESP_SYSTEM_H
@@ -0,0 +1,23 @@
+/**
+ * 主机侧ESP-IDF兼容层: 高精度时间
+ */
+
+#ifndef HOST_SHIM_ESP_TIMER_H
+#define HOST_SHIM_ESP_TIMER_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * 进程启动后的微秒数 (CLOCK_MONOTONIC)
+ */
+int64_t esp_timer_get_time(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_ESP_TIMER_H
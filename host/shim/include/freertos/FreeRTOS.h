@@ -0,0 +1,46 @@
+/**
+ * 主机侧FreeRTOS兼容层
+ * 任务映射为pthread，信号量/队列用互斥锁+条件变量实现，1 tick = 1 ms
+ * 只实现本工程用到的接口
+ */
+
+#ifndef HOST_SHIM_FREERTOS_H
+#define HOST_SHIM_FREERTOS_H
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned int UBaseType_t;
+
+#define pdFALSE                 0
+#define pdTRUE                  1
+#define pdPASS                  pdTRUE
+#define pdFAIL                  pdFALSE
+#define portMAX_DELAY           ((TickType_t)0xffffffffUL)
+#define configTICK_RATE_HZ      1000
+#define portTICK_PERIOD_MS      (1000 / configTICK_RATE_HZ)
+#define portNUM_PROCESSORS      2
+#define tskNO_AFFINITY          0x7FFFFFFF
+#define pdMS_TO_TICKS(ms)       ((TickType_t)(ms))
+
+// 临界区: 主机上线程不会因关中断而不可抢占，用互斥锁保证写者互斥即可
+typedef pthread_mutex_t portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED    PTHREAD_MUTEX_INITIALIZER
+#define portENTER_CRITICAL(mux)         pthread_mutex_lock(mux)
+#define portEXIT_CRITICAL(mux)          pthread_mutex_unlock(mux)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_FREERTOS_H
@@ -0,0 +1,30 @@
+/**
+ * 主机侧FreeRTOS兼容层: 队列
+ */
+
+#ifndef HOST_SHIM_FREERTOS_QUEUE_H
+#define HOST_SHIM_FREERTOS_QUEUE_H
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct host_queue *QueueHandle_t;
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size);
+void vQueueDelete(QueueHandle_t queue);
+BaseType_t xQueueSend(QueueHandle_t queue, const void *item, TickType_t ticks);
+BaseType_t xQueueReceive(QueueHandle_t queue, void *item, TickType_t ticks);
+BaseType_t xQueueReset(QueueHandle_t queue);
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t queue);
+
+#define xQueueSendToBack(q, item, ticks)    xQueueSend(q, item, ticks)
+#define xQueueSendFromISR(q, item, woken)   xQueueSend(q, item, 0)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_FREERTOS_QUEUE_H
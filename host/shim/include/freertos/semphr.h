@@ -0,0 +1,30 @@
+/**
+ * 主机侧FreeRTOS兼容层: 信号量
+ * 与FreeRTOS相同，信号量是元素大小为0的队列；互斥锁不支持优先级继承和递归
+ */
+
+#ifndef HOST_SHIM_FREERTOS_SEMPHR_H
+#define HOST_SHIM_FREERTOS_SEMPHR_H
+
+#include "FreeRTOS.h"
+#include "queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef QueueHandle_t SemaphoreHandle_t;
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count);
+
+#define xSemaphoreCreateBinary()        xSemaphoreCreateCounting(1, 0)
+#define xSemaphoreCreateMutex()         xSemaphoreCreateCounting(1, 1)
+#define xSemaphoreTake(sem, ticks)      xQueueReceive(sem, NULL, ticks)
+#define xSemaphoreGive(sem)             xQueueSend(sem, NULL, 0)
+#define vSemaphoreDelete(sem)           vQueueDelete(sem)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_FREERTOS_SEMPHR_H
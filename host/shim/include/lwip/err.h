@@ -0,0 +1,12 @@
+/**
+ * 主机侧lwIP兼容层: 固件只包含该头文件，不使用其中的接口
+ */
+
+#ifndef HOST_SHIM_LWIP_ERR_H
+#define HOST_SHIM_LWIP_ERR_H
+
+typedef signed char err_t;
+
+#define ERR_OK  0
+
+#endif // HOST_SHIM_LWIP_ERR_H
@@ -0,0 +1,10 @@
+/**
+ * 主机侧lwIP兼容层: 固件只包含该头文件，不使用其中的接口
+ */
+
+#ifndef HOST_SHIM_LWIP_SYS_H
+#define HOST_SHIM_LWIP_SYS_H
+
+#include "lwip/err.h"
+
+#endif // HOST_SHIM_LWIP_SYS_H
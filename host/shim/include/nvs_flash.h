@@ -0,0 +1,21 @@
+/**
+ * 主机侧ESP-IDF兼容层: NVS分区初始化 (数据保存在内存中)
+ */
+
+#ifndef HOST_SHIM_NVS_FLASH_H
+#define HOST_SHIM_NVS_FLASH_H
+
+#include "nvs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOST_SHIM_NVS_FLASH_H
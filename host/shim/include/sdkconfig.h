@@ -0,0 +1,16 @@
+/**
+ * 主机侧ESP-IDF兼容层: 固件用到的Kconfig选项
+ */
+
+#ifndef HOST_SHIM_SDKCONFIG_H
+#define HOST_SHIM_SDKCONFIG_H
+
+#define CONFIG_HTTPD_WS_SUPPORT         1
+#define CONFIG_HTTPD_MAX_REQ_HDR_LEN    1024
+#define CONFIG_HTTPD_MAX_URI_LEN        512
+#define CONFIG_FREERTOS_HZ              1000
+#ifndef CONFIG_KVM_CHANNEL_COUNT
+#define CONFIG_KVM_CHANNEL_COUNT        2       // 由CMake的KVM_CHANNEL_COUNT选项覆盖
+#endif
+
+#endif // HOST_SHIM_SDKCONFIG_H
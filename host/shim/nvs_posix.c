@@ -0,0 +1,293 @@
+/**
+ * 主机侧NVS实现
+ * 按(命名空间, 键)保存在内存链表中；设置KVM_NVS_FILE时，
+ * nvs_flash_init从该文件加载、nvs_commit写回，模拟断电重启后保留的数据
+ */
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#define NVS_NAME_MAX    16
+#define NVS_MAX_HANDLES 32
+
+typedef enum {
+    NVS_TYPE_U32,
+    NVS_TYPE_STR,
+    NVS_TYPE_BLOB
+} nvs_entry_type_t;
+
+typedef struct nvs_entry {
+    struct nvs_entry *next;
+    char ns[NVS_NAME_MAX];
+    char key[NVS_NAME_MAX];
+    nvs_entry_type_t type;
+    size_t length;
+    uint8_t data[];
+} nvs_entry_t;
+
+static pthread_mutex_t s_lock = PTHREAD_MUTEX_INITIALIZER;
+static nvs_entry_t *s_entries = NULL;
+static char s_handles[NVS_MAX_HANDLES][NVS_NAME_MAX];
+static bool s_handle_used[NVS_MAX_HANDLES];
+
+// 文件中每个条目的头部，其后为length字节的数据
+typedef struct {
+    char ns[NVS_NAME_MAX];
+    char key[NVS_NAME_MAX];
+    uint32_t type;
+    uint32_t length;
+} nvs_file_record_t;
+
+static nvs_entry_t **find_entry(const char *ns, const char *key)
+{
+    nvs_entry_t **link = &s_entries;
+    while (*link != NULL) {
+        if (strcmp((*link)->ns, ns) == 0 && strcmp((*link)->key, key) == 0) {
+            break;
+        }
+        link = &(*link)->next;
+    }
+    return link;
+}
+
+static const char *handle_ns(nvs_handle_t handle)
+{
+    if (handle == 0 || handle > NVS_MAX_HANDLES || !s_handle_used[handle - 1]) {
+        return NULL;
+    }
+    return s_handles[handle - 1];
+}
+
+static esp_err_t set_value(nvs_handle_t handle, const char *key, nvs_entry_type_t type,
+                           const void *value, size_t length)
+{
+    if (key == NULL || strlen(key) >= NVS_NAME_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    const char *ns = handle_ns(handle);
+    if (ns == NULL) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_entry_t **link = find_entry(ns, key);
+    nvs_entry_t *old = *link;
+    nvs_entry_t *entry = malloc(sizeof(nvs_entry_t) + length);
+    if (entry == NULL) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    snprintf(entry->ns, sizeof(entry->ns), "%s", ns);
+    snprintf(entry->key, sizeof(entry->key), "%s", key);
+    entry->type = type;
+    entry->length = length;
+    memcpy(entry->data, value, length);
+    entry->next = old != NULL ? old->next : NULL;
+    *link = entry;
+    free(old);
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+static esp_err_t get_value(nvs_handle_t handle, const char *key, nvs_entry_type_t type,
+                           void *out, size_t *length)
+{
+    pthread_mutex_lock(&s_lock);
+    const char *ns = handle_ns(handle);
+    if (ns == NULL || key == NULL) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    nvs_entry_t *entry = *find_entry(ns, key);
+    esp_err_t ret = ESP_OK;
+    if (entry == NULL || entry->type != type) {
+        ret = ESP_ERR_NVS_NOT_FOUND;
+    } else if (out == NULL) {
+        *length = entry->length;        // 与IDF相同: out为NULL时只返回长度
+    } else if (*length < entry->length) {
+        ret = ESP_ERR_NVS_INVALID_LENGTH;
+    } else {
+        memcpy(out, entry->data, entry->length);
+        *length = entry->length;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    if (name == NULL || strlen(name) >= NVS_NAME_MAX || out_handle == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    pthread_mutex_lock(&s_lock);
+    for (int i = 0; i < NVS_MAX_HANDLES; i++) {
+        if (!s_handle_used[i]) {
+            s_handle_used[i] = true;
+            snprintf(s_handles[i], NVS_NAME_MAX, "%s", name);
+            *out_handle = i + 1;
+            pthread_mutex_unlock(&s_lock);
+            return ESP_OK;
+        }
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&s_lock);
+    if (handle_ns(handle) != NULL) {
+        s_handle_used[handle - 1] = false;
+    }
+    pthread_mutex_unlock(&s_lock);
+}
+
+/**
+ * 把全部条目写入KVM_NVS_FILE (先写临时文件再改名，避免中途退出留下不完整的文件)
+ */
+static esp_err_t nvs_file_save(void)
+{
+    const char *path = getenv("KVM_NVS_FILE");
+    if (path == NULL) {
+        return ESP_OK;
+    }
+    char tmp[256];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *file = fopen(tmp, "wb");
+    if (file == NULL) {
+        return ESP_FAIL;
+    }
+    bool ok = true;
+    for (const nvs_entry_t *entry = s_entries; entry != NULL && ok; entry = entry->next) {
+        nvs_file_record_t record = { .type = entry->type, .length = (uint32_t)entry->length };
+        memcpy(record.ns, entry->ns, sizeof(record.ns));
+        memcpy(record.key, entry->key, sizeof(record.key));
+        ok = fwrite(&record, sizeof(record), 1, file) == 1 &&
+             (entry->length == 0 || fwrite(entry->data, entry->length, 1, file) == 1);
+    }
+    ok = fclose(file) == 0 && ok;
+    return ok && rename(tmp, path) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+/**
+ * 从KVM_NVS_FILE加载条目 (文件不存在时为空)
+ */
+static void nvs_file_load(void)
+{
+    const char *path = getenv("KVM_NVS_FILE");
+    FILE *file = path != NULL ? fopen(path, "rb") : NULL;
+    if (file == NULL) {
+        return;
+    }
+    nvs_file_record_t record;
+    while (fread(&record, sizeof(record), 1, file) == 1) {
+        nvs_entry_t *entry = malloc(sizeof(nvs_entry_t) + record.length);
+        if (entry == NULL) {
+            break;
+        }
+        if (record.length > 0 && fread(entry->data, record.length, 1, file) != 1) {
+            free(entry);
+            break;
+        }
+        snprintf(entry->ns, sizeof(entry->ns), "%.*s", NVS_NAME_MAX - 1, record.ns);
+        snprintf(entry->key, sizeof(entry->key), "%.*s", NVS_NAME_MAX - 1, record.key);
+        entry->type = (nvs_entry_type_t)record.type;
+        entry->length = record.length;
+        entry->next = s_entries;
+        s_entries = entry;
+    }
+    fclose(file);
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    pthread_mutex_lock(&s_lock);
+    esp_err_t ret = handle_ns(handle) != NULL ? nvs_file_save() : ESP_ERR_INVALID_ARG;
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return get_value(handle, key, NVS_TYPE_U32, out_value, &length);
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return set_value(handle, key, NVS_TYPE_U32, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_str(nvs_handle_t handle, const char *key, char *out_value, size_t *length)
+{
+    return get_value(handle, key, NVS_TYPE_STR, out_value, length);
+}
+
+esp_err_t nvs_set_str(nvs_handle_t handle, const char *key, const char *value)
+{
+    return set_value(handle, key, NVS_TYPE_STR, value, strlen(value) + 1);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    return get_value(handle, key, NVS_TYPE_BLOB, out_value, length);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    return set_value(handle, key, NVS_TYPE_BLOB, value, length);
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    pthread_mutex_lock(&s_lock);
+    const char *ns = handle_ns(handle);
+    if (ns == NULL || key == NULL) {
+        pthread_mutex_unlock(&s_lock);
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs_entry_t **link = find_entry(ns, key);
+    nvs_entry_t *entry = *link;
+    if (entry != NULL) {
+        *link = entry->next;
+        free(entry);
+    }
+    pthread_mutex_unlock(&s_lock);
+    return entry != NULL ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_flash_init(void)
+{
+    static bool s_loaded = false;
+
+    pthread_mutex_lock(&s_lock);
+    if (!s_loaded) {
+        nvs_file_load();
+        s_loaded = true;
+    }
+    pthread_mutex_unlock(&s_lock);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    pthread_mutex_lock(&s_lock);
+    while (s_entries != NULL) {
+        nvs_entry_t *next = s_entries->next;
+        free(s_entries);
+        s_entries = next;
+    }
+    esp_err_t ret = nvs_file_save();
+    pthread_mutex_unlock(&s_lock);
+    return ret;
+}
@@ -0,0 +1,407 @@
+/**
+ * 主机侧UART实现
+ * UART0通过termios打开KVM_UART_DEVICE指定的串口/伪终端，其余端口输出到stderr
+ * 接收线程模拟IDF驱动的环形缓冲区、事件队列和模式检测
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "driver/uart.h"
+#include "esp_log.h"
+
+#define PATTERN_QUEUE_MAX   32
+
+typedef struct {
+    bool installed;
+    int fd;                         // -1表示没有设备 (写入stderr)
+    uint32_t baud_rate;
+    QueueHandle_t event_queue;
+    pthread_t reader;
+    pthread_mutex_t lock;
+    pthread_cond_t readable;
+
+    // 接收环形缓冲区，用累计字节数表示读写位置
+    uint8_t *rx_buf;
+    size_t rx_size;
+    uint64_t rx_written;
+    uint64_t rx_read;
+
+    // 模式检测
+    bool pattern_enabled;
+    uint8_t pattern_chr;
+    uint64_t pattern_pos[PATTERN_QUEUE_MAX];
+    int pattern_head;
+    int pattern_count;
+    int pattern_limit;
+} host_uart_t;
+
+static const char *TAG = "HOST_UART";
+static host_uart_t s_uarts[UART_NUM_MAX];
+
+static host_uart_t *get_uart(uart_port_t port)
+{
+    if (port < 0 || port >= UART_NUM_MAX || !s_uarts[port].installed) {
+        return NULL;
+    }
+    return &s_uarts[port];
+}
+
+static speed_t baud_to_speed(uint32_t baud)
+{
+    switch (baud) {
+    case 9600:      return B9600;
+    case 19200:     return B19200;
+    case 38400:     return B38400;
+    case 57600:     return B57600;
+    case 115200:    return B115200;
+    case 230400:    return B230400;
+#ifdef B460800
+    case 460800:    return B460800;
+#endif
+#ifdef B921600
+    case 921600:    return B921600;
+#endif
+    default:        return B115200;
+    }
+}
+
+static void post_event(host_uart_t *uart, uart_event_type_t type, size_t size)
+{
+    if (uart->event_queue != NULL) {
+        uart_event_t event = { .type = type, .size = size };
+        xQueueSend(uart->event_queue, &event, 0);
+    }
+}
+
+/**
+ * 接收线程: 读取设备数据写入环形缓冲区并投递事件
+ */
+static void *uart_reader_thread(void *arg)
+{
+    host_uart_t *uart = (host_uart_t *)arg;
+    uint8_t buf[256];
+
+    while (uart->installed) {
+        struct pollfd pfd = { .fd = uart->fd, .events = POLLIN };
+        if (poll(&pfd, 1, 100) <= 0) {
+            continue;
+        }
+        ssize_t n = read(uart->fd, buf, sizeof(buf));
+        if (n <= 0) {
+            if (n < 0 && errno != EAGAIN && errno != EINTR) {
+                // 伪终端对端关闭时返回EIO，稍后重试
+                usleep(100000);
+            }
+            continue;
+        }
+
+        size_t pending_data = 0;
+        bool overflow = false;
+        pthread_mutex_lock(&uart->lock);
+        for (ssize_t i = 0; i < n; i++) {
+            if (uart->rx_written - uart->rx_read >= uart->rx_size) {
+                overflow = true;
+                break;
+            }
+            uart->rx_buf[uart->rx_written % uart->rx_size] = buf[i];
+            pending_data++;
+            if (uart->pattern_enabled && buf[i] == uart->pattern_chr) {
+                if (uart->pattern_count < uart->pattern_limit) {
+                    int tail = (uart->pattern_head + uart->pattern_count) % PATTERN_QUEUE_MAX;
+                    uart->pattern_pos[tail] = uart->rx_written;
+                    uart->pattern_count++;
+                }
+                uart->rx_written++;
+                pthread_mutex_unlock(&uart->lock);
+                post_event(uart, UART_PATTERN_DET, pending_data);
+                pending_data = 0;
+                pthread_mutex_lock(&uart->lock);
+                continue;
+            }
+            uart->rx_written++;
+        }
+        pthread_cond_broadcast(&uart->readable);
+        pthread_mutex_unlock(&uart->lock);
+
+        if (pending_data > 0) {
+            post_event(uart, UART_DATA, pending_data);
+        }
+        if (overflow) {
+            post_event(uart, UART_BUFFER_FULL, 0);
+        }
+    }
+    return NULL;
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config)
+{
+    if (port < 0 || port >= UART_NUM_MAX || config == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_uarts[port].baud_rate = config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts)
+{
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size,
+                              int queue_size, QueueHandle_t *uart_queue, int intr_alloc_flags)
+{
+    if (port < 0 || port >= UART_NUM_MAX || s_uarts[port].installed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    host_uart_t *uart = &s_uarts[port];
+    uart->fd = -1;
+
+    if (port == UART_NUM_0) {
+        const char *device = getenv("KVM_UART_DEVICE");
+        if (device == NULL) {
+            device = HOST_UART_DEFAULT_DEVICE;
+        }
+        uart->fd = open(device, O_RDWR | O_NOCTTY);
+        if (uart->fd < 0) {
+            ESP_LOGE(TAG, "打开串口设备 %s 失败: %s", device, strerror(errno));
+            return ESP_FAIL;
+        }
+
+        struct termios tio;
+        if (tcgetattr(uart->fd, &tio) == 0) {
+            cfmakeraw(&tio);
+            cfsetispeed(&tio, baud_to_speed(uart->baud_rate));
+            cfsetospeed(&tio, baud_to_speed(uart->baud_rate));
+            tcsetattr(uart->fd, TCSANOW, &tio);
+        }
+        ESP_LOGI(TAG, "UART%d -> %s", port, device);
+    }
+
+    uart->rx_size = rx_buffer_size > 0 ? rx_buffer_size : 256;
+    uart->rx_buf = calloc(1, uart->rx_size);
+    uart->pattern_limit = PATTERN_QUEUE_MAX;
+    pthread_mutex_init(&uart->lock, NULL);
+    pthread_cond_init(&uart->readable, NULL);
+    if (queue_size > 0 && uart_queue != NULL) {
+        uart->event_queue = xQueueCreate(queue_size, sizeof(uart_event_t));
+        *uart_queue = uart->event_queue;
+    }
+    uart->installed = true;
+
+    if (uart->fd >= 0) {
+        pthread_create(&uart->reader, NULL, uart_reader_thread, uart);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t port)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart->installed = false;
+    if (uart->fd >= 0) {
+        pthread_join(uart->reader, NULL);
+        close(uart->fd);
+    }
+    free(uart->rx_buf);
+    memset(uart, 0, sizeof(*uart));
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t port, const void *src, size_t size)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return -1;
+    }
+    if (uart->fd < 0) {
+        return fwrite(src, 1, size, stderr);
+    }
+
+    size_t written = 0;
+    while (written < size) {
+        ssize_t n = write(uart->fd, (const uint8_t *)src + written, size - written);
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            return -1;
+        }
+        written += n;
+    }
+    return (int)written;
+}
+
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t length, TickType_t ticks_to_wait)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return -1;
+    }
+
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += ticks_to_wait / 1000;
+    deadline.tv_nsec += (long)(ticks_to_wait % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&uart->lock);
+    while (uart->rx_written == uart->rx_read && ticks_to_wait != 0) {
+        int rc = ticks_to_wait == portMAX_DELAY ?
+                 pthread_cond_wait(&uart->readable, &uart->lock) :
+                 pthread_cond_timedwait(&uart->readable, &uart->lock, &deadline);
+        if (rc == ETIMEDOUT) {
+            break;
+        }
+    }
+    uint32_t count = 0;
+    while (count < length && uart->rx_read < uart->rx_written) {
+        ((uint8_t *)buf)[count++] = uart->rx_buf[uart->rx_read % uart->rx_size];
+        uart->rx_read++;
+    }
+    pthread_mutex_unlock(&uart->lock);
+    return (int)count;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks_to_wait)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (uart->fd >= 0) {
+        tcdrain(uart->fd);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t port)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&uart->lock);
+    uart->rx_read = uart->rx_written;
+    uart->pattern_count = 0;
+    pthread_mutex_unlock(&uart->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_flush(uart_port_t port)
+{
+    return uart_flush_input(port);
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t *size)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL || size == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&uart->lock);
+    *size = uart->rx_written - uart->rx_read;
+    pthread_mutex_unlock(&uart->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_set_baudrate(uart_port_t port, uint32_t baudrate)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart->baud_rate = baudrate;
+
+    // 伪终端忽略波特率，真实串口按新速率配置
+    struct termios tio;
+    if (uart->fd >= 0 && tcgetattr(uart->fd, &tio) == 0) {
+        cfsetispeed(&tio, baud_to_speed(baudrate));
+        cfsetospeed(&tio, baud_to_speed(baudrate));
+        tcsetattr(uart->fd, TCSADRAIN, &tio);
+    }
+    return ESP_OK;
+}
+
+esp_err_t uart_get_baudrate(uart_port_t port, uint32_t *baudrate)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL || baudrate == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *baudrate = uart->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t port, char pattern_chr, uint8_t chr_num,
+                                            int chr_tout, int post_idle, int pre_idle)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL || chr_num != 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    pthread_mutex_lock(&uart->lock);
+    uart->pattern_chr = (uint8_t)pattern_chr;
+    uart->pattern_enabled = true;
+    pthread_mutex_unlock(&uart->lock);
+    return ESP_OK;
+}
+
+esp_err_t uart_disable_pattern_det_intr(uart_port_t port)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uart->pattern_enabled = false;
+    return ESP_OK;
+}
+
+int uart_pattern_pop_pos(uart_port_t port)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return -1;
+    }
+
+    // 返回相对当前读位置的偏移，已被读走的位置直接丢弃
+    int pos = -1;
+    pthread_mutex_lock(&uart->lock);
+    while (uart->pattern_count > 0) {
+        uint64_t abs_pos = uart->pattern_pos[uart->pattern_head];
+        uart->pattern_head = (uart->pattern_head + 1) % PATTERN_QUEUE_MAX;
+        uart->pattern_count--;
+        if (abs_pos >= uart->rx_read) {
+            pos = (int)(abs_pos - uart->rx_read);
+            break;
+        }
+    }
+    pthread_mutex_unlock(&uart->lock);
+    return pos;
+}
+
+esp_err_t uart_pattern_queue_reset(uart_port_t port, int queue_length)
+{
+    host_uart_t *uart = get_uart(port);
+    if (uart == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    pthread_mutex_lock(&uart->lock);
+    uart->pattern_count = 0;
+    uart->pattern_head = 0;
+    uart->pattern_limit = queue_length < PATTERN_QUEUE_MAX ? queue_length : PATTERN_QUEUE_MAX;
+    pthread_mutex_unlock(&uart->lock);
+    return ESP_OK;
+}
@@ -0,0 +1,315 @@
+/**
+ * API路由表实现
+ * 功能: 在单个URI处理器中按排序的路由表分发/api/请求，并提取路径参数
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+
+#include "api_router.h"
+#include "http_metrics.h"
+
+static const char *TAG = "API_ROUTER";
+
+// 路由表项 (handler/user_ctx为http_metrics包装后的处理器)
+typedef struct {
+    const char *pattern;
+    bool catch_all;                     // 以"*"结尾
+    httpd_uri_t uri;
+} router_entry_t;
+
+// 路径参数: 值在req->uri中的位置
+typedef struct {
+    const char *name;
+    size_t name_len;
+    size_t offset;
+    size_t len;
+} router_param_t;
+
+typedef struct {
+    const httpd_req_t *req;             // 参数所属的请求，处理器返回后清空
+    int count;
+    router_param_t params[API_ROUTER_MAX_PARAMS];
+} router_match_t;
+
+// [0, s_literal_count) 为按(路径, 方法)排序的固定路由，其后为参数路由 (按注册顺序)
+// 只在服务器启动前修改，之后仅由httpd任务读取
+static router_entry_t s_routes[API_ROUTER_MAX_ROUTES];
+static size_t s_literal_count = 0;
+static size_t s_route_count = 0;
+
+// 当前请求的路径参数 (仅在httpd任务中访问)
+static router_match_t s_match;
+
+static bool pattern_is_literal(const char *pattern)
+{
+    return strchr(pattern, '{') == NULL && strchr(pattern, '*') == NULL;
+}
+
+static int route_compare(const void *a, const void *b)
+{
+    const router_entry_t *ra = (const router_entry_t *)a;
+    const router_entry_t *rb = (const router_entry_t *)b;
+    int cmp = strcmp(ra->pattern, rb->pattern);
+    if (cmp != 0) {
+        return cmp;
+    }
+    return (int)ra->uri.method - (int)rb->uri.method;
+}
+
+/**
+ * 检查路由模式: 以"/"开头，"{"与"}"成对且不嵌套，"*"只能在结尾
+ */
+static bool pattern_is_valid(const char *pattern)
+{
+    if (pattern == NULL || pattern[0] != '/') {
+        return false;
+    }
+    int params = 0;
+    for (const char *p = pattern; *p != '\0'; p++) {
+        if (*p == '{') {
+            const char *close = strchr(p, '}');
+            if (close == NULL || close == p + 1 || memchr(p + 1, '{', close - p - 1) != NULL ||
+                ++params > API_ROUTER_MAX_PARAMS) {
+                return false;
+            }
+            p = close;
+        } else if (*p == '}' || (*p == '*' && p[1] != '\0')) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * 建立路由表
+ */
+esp_err_t api_router_init(const api_route_t *routes, size_t count)
+{
+    if (count > API_ROUTER_MAX_ROUTES) {
+        ESP_LOGE(TAG, "路由过多: %u (最多%d)", (unsigned)count, API_ROUTER_MAX_ROUTES);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    size_t literal_count = 0;
+    for (size_t i = 0; i < count; i++) {
+        if (!pattern_is_valid(routes[i].pattern)) {
+            ESP_LOGE(TAG, "无效的路由模式: %s", routes[i].pattern);
+            return ESP_ERR_INVALID_ARG;
+        }
+        literal_count += pattern_is_literal(routes[i].pattern) ? 1 : 0;
+    }
+
+    // 固定路由在前，参数路由保持注册顺序放在后面
+    size_t literal = 0;
+    size_t next_param = literal_count;
+    for (size_t i = 0; i < count; i++) {
+        router_entry_t *entry = pattern_is_literal(routes[i].pattern) ? &s_routes[literal++] : &s_routes[next_param++];
+        httpd_uri_t uri = {
+            .uri      = routes[i].pattern,
+            .method   = routes[i].method,
+            .handler  = routes[i].handler,
+            .user_ctx = routes[i].user_ctx
+        };
+        entry->pattern = routes[i].pattern;
+        entry->catch_all = routes[i].pattern[strlen(routes[i].pattern) - 1] == '*';
+        // 统计表已满时entry->uri为未包装的处理器，仍可分发
+        http_metrics_wrap_uri_handler(&uri, routes[i].pattern, &entry->uri);
+    }
+    qsort(s_routes, literal, sizeof(s_routes[0]), route_compare);
+
+    s_literal_count = literal;
+    s_route_count = count;
+    ESP_LOGI(TAG, "API路由表: %u条固定路由，%u条参数路由",
+             (unsigned)literal, (unsigned)(count - literal));
+    return ESP_OK;
+}
+
+/**
+ * 比较路由模式与请求路径 (路径不以'\0'结尾)
+ */
+static int path_compare(const char *pattern, const char *path, size_t len)
+{
+    int cmp = strncmp(pattern, path, len);
+    if (cmp == 0 && pattern[len] != '\0') {
+        return 1;
+    }
+    return cmp;
+}
+
+/**
+ * 二分查找路径相同的第一条固定路由，没有时返回-1
+ */
+static int literal_find(const char *path, size_t len)
+{
+    size_t lo = 0;
+    size_t hi = s_literal_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (path_compare(s_routes[mid].pattern, path, len) < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo < s_literal_count && path_compare(s_routes[lo].pattern, path, len) == 0) {
+        return (int)lo;
+    }
+    return -1;
+}
+
+/**
+ * 按参数模式匹配路径，成功时输出路径参数
+ */
+static bool param_match(const router_entry_t *entry, const char *path, size_t len, router_match_t *match)
+{
+    const char *p = entry->pattern;
+    size_t pos = 0;
+
+    match->count = 0;
+    while (*p != '\0') {
+        if (*p == '*') {
+            return true;
+        }
+        if (*p == '{') {
+            const char *close = strchr(p, '}');
+            const char *slash = memchr(path + pos, '/', len - pos);
+            size_t seg_end = slash != NULL ? (size_t)(slash - path) : len;
+            if (seg_end == pos) {
+                return false;
+            }
+            match->params[match->count++] = (router_param_t) {
+                .name = p + 1, .name_len = close - p - 1, .offset = pos, .len = seg_end - pos
+            };
+            p = close + 1;
+            pos = seg_end;
+            continue;
+        }
+        if (pos == len || *p != path[pos]) {
+            return false;
+        }
+        p++;
+        pos++;
+    }
+    return pos == len;
+}
+
+/**
+ * 调用路由处理器，处理器返回前路径参数有效
+ */
+static esp_err_t route_call(httpd_req_t *req, const router_entry_t *entry, const router_match_t *match)
+{
+    s_match = *match;
+    s_match.req = req;
+    req->user_ctx = entry->uri.user_ctx;
+    esp_err_t ret = entry->uri.handler(req);
+    s_match.req = NULL;
+    return ret;
+}
+
+/**
+ * 分发器
+ */
+esp_err_t api_router_dispatch(httpd_req_t *req)
+{
+    const char *query = strchr(req->uri, '?');
+    size_t len = query != NULL ? (size_t)(query - req->uri) : strlen(req->uri);
+    bool path_found = false;
+    router_match_t match = { .count = 0 };
+
+    int first = literal_find(req->uri, len);
+    if (first >= 0) {
+        path_found = true;
+        for (size_t i = first; i < s_literal_count && strcmp(s_routes[i].pattern, s_routes[first].pattern) == 0; i++) {
+            if ((int)s_routes[i].uri.method == req->method) {
+                return route_call(req, &s_routes[i], &match);
+            }
+        }
+    }
+
+    for (size_t i = s_literal_count; i < s_route_count; i++) {
+        if (!param_match(&s_routes[i], req->uri, len, &match)) {
+            continue;
+        }
+        if ((int)s_routes[i].uri.method == req->method) {
+            return route_call(req, &s_routes[i], &match);
+        }
+        path_found = path_found || !s_routes[i].catch_all;
+    }
+
+    if (path_found) {
+        return httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, NULL);
+    }
+    return httpd_resp_send_404(req);
+}
+
+/**
+ * URI匹配函数
+ */
+bool api_router_uri_match(const char *uri_template, const char *uri_to_match, size_t match_upto)
+{
+    size_t tpl_len = strlen(uri_template);
+    if (tpl_len > 0 && uri_template[tpl_len - 1] == '*') {
+        tpl_len--;
+        return match_upto >= tpl_len && strncmp(uri_template, uri_to_match, tpl_len) == 0;
+    }
+    return match_upto == tpl_len && strncmp(uri_template, uri_to_match, tpl_len) == 0;
+}
+
+/**
+ * 查找当前请求的路径参数
+ */
+static const router_param_t *param_find(httpd_req_t *req, const char *name)
+{
+    if (s_match.req != req) {
+        return NULL;
+    }
+    size_t name_len = strlen(name);
+    for (int i = 0; i < s_match.count; i++) {
+        if (s_match.params[i].name_len == name_len && strncmp(s_match.params[i].name, name, name_len) == 0) {
+            return &s_match.params[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 获取路径参数
+ */
+esp_err_t api_router_get_param(httpd_req_t *req, const char *name, char *buf, size_t size)
+{
+    const router_param_t *param = param_find(req, name);
+    if (param == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    if (param->len >= size) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    memcpy(buf, req->uri + param->offset, param->len);
+    buf[param->len] = '\0';
+    return ESP_OK;
+}
+
+/**
+ * 获取十进制整数路径参数
+ */
+esp_err_t api_router_get_param_int(httpd_req_t *req, const char *name, long *value)
+{
+    char buf[12];
+    esp_err_t ret = api_router_get_param(req, name, buf, sizeof(buf));
+    if (ret == ESP_ERR_INVALID_SIZE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    char *end = NULL;
+    long parsed = strtol(buf, &end, 10);
+    if (end == buf || *end != '\0') {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *value = parsed;
+    return ESP_OK;
+}
@@ -0,0 +1,138 @@
+/**
+ * 内部事件总线实现
+ * 功能: 在独立的esp_event事件循环上发布和订阅KVM状态变化事件
+ */
+
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+
+#include "event_bus.h"
+
+static const char *TAG = "EVENT_BUS";
+
+ESP_EVENT_DEFINE_BASE(KVM_EVENT);
+
+static esp_event_loop_handle_t s_loop = NULL;
+
+// 按事件类型统计 (已分发 / 因队列满丢弃)
+static atomic_uint_least32_t s_delivered[KVM_EVENT_MAX];
+static atomic_uint_least32_t s_dropped[KVM_EVENT_MAX];
+
+static const char *const EVENT_NAMES[KVM_EVENT_MAX] = {
+    [KVM_EVENT_CHANNEL_SWITCHED]    = "channel_switched",
+    [KVM_EVENT_SWITCH_FAILED]       = "switch_failed",
+    [KVM_EVENT_WIFI_LINK_UP]        = "wifi_link_up",
+    [KVM_EVENT_WIFI_LINK_DOWN]      = "wifi_link_down",
+    [KVM_EVENT_WIFI_GOT_IP]         = "wifi_got_ip",
+    [KVM_EVENT_AP_CLIENTS_CHANGED]  = "ap_clients_changed",
+    [KVM_EVENT_UART_LINK_UP]        = "uart_link_up",
+    [KVM_EVENT_UART_LINK_DOWN]      = "uart_link_down",
+    [KVM_EVENT_UART_ERROR]          = "uart_error",
+};
+
+/**
+ * 内置订阅者: 统计并记录全部事件
+ */
+static void event_bus_account(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (id < 0 || id >= KVM_EVENT_MAX) {
+        return;
+    }
+    atomic_fetch_add_explicit(&s_delivered[id], 1, memory_order_relaxed);
+    ESP_LOGD(TAG, "事件: %s", EVENT_NAMES[id]);
+}
+
+/**
+ * 初始化事件总线
+ */
+esp_err_t event_bus_init(void)
+{
+    if (s_loop != NULL) {
+        return ESP_OK;
+    }
+
+    esp_event_loop_args_t args = {
+        .queue_size = EVENT_BUS_QUEUE_SIZE,
+        .task_name = "event_bus",
+        .task_priority = EVENT_BUS_TASK_PRIORITY,
+        .task_stack_size = EVENT_BUS_TASK_STACK_SIZE,
+        .task_core_id = tskNO_AFFINITY
+    };
+    esp_err_t ret = esp_event_loop_create(&args, &s_loop);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "创建事件循环失败: %s", esp_err_to_name(ret));
+        s_loop = NULL;
+        return ret;
+    }
+
+    return event_bus_subscribe(ESP_EVENT_ANY_ID, event_bus_account, NULL, NULL);
+}
+
+/**
+ * 发布事件
+ */
+esp_err_t event_bus_post(kvm_event_id_t id, const void *data, size_t size)
+{
+    if (s_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (id < 0 || id >= KVM_EVENT_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 发布者可能是切换任务或UART接收任务，不能因订阅者处理慢而阻塞
+    esp_err_t ret = esp_event_post_to(s_loop, KVM_EVENT, id, data, size, 0);
+    if (ret != ESP_OK) {
+        atomic_fetch_add_explicit(&s_dropped[id], 1, memory_order_relaxed);
+    }
+    return ret;
+}
+
+/**
+ * 订阅事件
+ */
+esp_err_t event_bus_subscribe(int32_t id, esp_event_handler_t handler, void *arg,
+                              esp_event_handler_instance_t *instance)
+{
+    if (s_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_event_handler_instance_register_with(s_loop, KVM_EVENT, id, handler, arg, instance);
+}
+
+/**
+ * 取消订阅
+ */
+esp_err_t event_bus_unsubscribe(int32_t id, esp_event_handler_instance_t instance)
+{
+    if (s_loop == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    return esp_event_handler_instance_unregister_with(s_loop, KVM_EVENT, id, instance);
+}
+
+/**
+ * 获取事件名称
+ */
+const char *event_bus_event_name(int32_t id)
+{
+    if (id < 0 || id >= KVM_EVENT_MAX) {
+        return "unknown";
+    }
+    return EVENT_NAMES[id];
+}
+
+/**
+ * 获取事件统计
+ */
+void event_bus_get_stats(int32_t id, uint32_t *delivered, uint32_t *dropped)
+{
+    if (id < 0 || id >= KVM_EVENT_MAX) {
+        *delivered = 0;
+        *dropped = 0;
+        return;
+    }
+    *delivered = atomic_load_explicit(&s_delivered[id], memory_order_relaxed);
+    *dropped = atomic_load_explicit(&s_dropped[id], memory_order_relaxed);
+}
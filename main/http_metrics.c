@@ -0,0 +1,418 @@
+/**
+ * HTTP路由指标实现
+ * 功能: 按路由统计请求数、发送字节数、错误数和对数分桶的延迟直方图
+ *
+ * 请求从包装处理器开始计时，同步请求在处理器返回时结束，异步请求在
+ * http_metrics_async_handler_complete时结束；发送字节数和状态码通过会话的发送覆盖函数获取
+ */
+
+#include <errno.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "http_metrics.h"
+
+static const char *TAG = "HTTP_METRICS";
+
+#define METRICS_CHUNK_SIZE      512
+#define METRICS_LINE_SIZE       192
+
+// 单条路由的统计 (计数只增不减)
+typedef struct {
+    const char *route;
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;
+    uint32_t requests;
+    uint32_t errors;                // 状态码>=400或处理器返回失败
+    uint64_t bytes_sent;
+    uint64_t latency_sum_us;
+    uint32_t buckets[HTTP_METRICS_BUCKETS];
+} http_route_metrics_t;
+
+static http_route_metrics_t s_routes[HTTP_METRICS_MAX_ROUTES];
+static int s_route_count = 0;
+
+// 进行中的请求 (按socket区分，异步请求在其他任务中完成前一直占用)
+typedef struct {
+    int fd;
+    http_route_metrics_t *route;        // NULL表示空闲
+    int64_t start_us;
+    uint32_t bytes;
+    int status;
+    bool async;                         // 已转为异步请求，由http_metrics_async_handler_complete结束
+} http_inflight_t;
+
+static http_inflight_t s_inflight[HTTP_METRICS_MAX_INFLIGHT];
+static SemaphoreHandle_t s_lock = NULL;     // 保护s_inflight和异步完成时的计数更新
+
+static const char *method_name(httpd_method_t method)
+{
+    switch (method) {
+    case HTTP_GET:      return "GET";
+    case HTTP_POST:     return "POST";
+    case HTTP_PUT:      return "PUT";
+    case HTTP_DELETE:   return "DELETE";
+    case HTTP_OPTIONS:  return "OPTIONS";
+    default:            return "OTHER";
+    }
+}
+
+static http_inflight_t *inflight_find(int fd)
+{
+    for (int i = 0; i < HTTP_METRICS_MAX_INFLIGHT; i++) {
+        if (s_inflight[i].route != NULL && s_inflight[i].fd == fd) {
+            return &s_inflight[i];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * 会话发送覆盖函数: 与默认发送相同，同时统计进行中请求的字节数和状态码
+ */
+static int metrics_send(httpd_handle_t hd, int sockfd, const char *buf, size_t buf_len, int flags)
+{
+    int ret = send(sockfd, buf, buf_len, flags);
+    if (ret < 0) {
+        return (errno == EAGAIN || errno == EWOULDBLOCK) ? HTTPD_SOCK_ERR_TIMEOUT : HTTPD_SOCK_ERR_FAIL;
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    http_inflight_t *inflight = inflight_find(sockfd);
+    if (inflight != NULL) {
+        // 响应头以状态行开头: "HTTP/1.1 200 OK"
+        if (inflight->status == 0 && ret > 12 && memcmp(buf, "HTTP/1.", 7) == 0) {
+            inflight->status = atoi(buf + 9);
+        }
+        inflight->bytes += ret;
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+/**
+ * 延迟所在的直方图桶，超出最大桶时返回HTTP_METRICS_BUCKETS
+ */
+static int latency_bucket(int64_t latency_us)
+{
+    if (latency_us <= (1 << HTTP_METRICS_MIN_BUCKET_SHIFT)) {
+        return 0;
+    }
+    // 桶上限为2的幂: 取不小于latency的最小2的幂的指数
+    int shift = 64 - __builtin_clzll((uint64_t)latency_us - 1);
+    int bucket = shift - HTTP_METRICS_MIN_BUCKET_SHIFT;
+    return bucket < HTTP_METRICS_BUCKETS ? bucket : HTTP_METRICS_BUCKETS;
+}
+
+/**
+ * 结束一个请求并计入路由统计 (调用者持有s_lock)
+ */
+static void inflight_finish(http_inflight_t *inflight, esp_err_t ret)
+{
+    http_route_metrics_t *route = inflight->route;
+    int64_t latency = esp_timer_get_time() - inflight->start_us;
+
+    route->requests++;
+    route->bytes_sent += inflight->bytes;
+    route->latency_sum_us += latency;
+    int bucket = latency_bucket(latency);
+    if (bucket < HTTP_METRICS_BUCKETS) {
+        route->buckets[bucket]++;
+    }
+    if (ret != ESP_OK || inflight->status >= 400) {
+        route->errors++;
+    }
+    inflight->route = NULL;
+}
+
+/**
+ * 包装处理器: 计时并记录统计
+ */
+static esp_err_t metrics_handler(httpd_req_t *req)
+{
+    http_route_metrics_t *route = (http_route_metrics_t *)req->user_ctx;
+    req->user_ctx = route->user_ctx;
+    int fd = httpd_req_to_sockfd(req);
+
+    // 同一socket上一个请求未结束时(不应发生)不重复统计
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    http_inflight_t *inflight = NULL;
+    if (inflight_find(fd) == NULL) {
+        for (int i = 0; i < HTTP_METRICS_MAX_INFLIGHT; i++) {
+            if (s_inflight[i].route == NULL) {
+                inflight = &s_inflight[i];
+                *inflight = (http_inflight_t) {
+                    .fd = fd, .route = route, .start_us = esp_timer_get_time()
+                };
+                break;
+            }
+        }
+    }
+    xSemaphoreGive(s_lock);
+
+    httpd_sess_set_send_override(req->handle, fd, metrics_send);
+    esp_err_t ret = route->handler(req);
+
+    // 转为异步的请求在完成时统计；异步请求已提前完成时槽位已释放
+    if (inflight != NULL) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        if (inflight->route == route && inflight->fd == fd && !inflight->async) {
+            inflight_finish(inflight, ret);
+        }
+        xSemaphoreGive(s_lock);
+    }
+    return ret;
+}
+
+esp_err_t http_metrics_async_handler_begin(httpd_req_t *req, httpd_req_t **out)
+{
+    esp_err_t ret = httpd_req_async_handler_begin(req, out);
+    if (ret == ESP_OK) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        http_inflight_t *inflight = inflight_find(httpd_req_to_sockfd(req));
+        if (inflight != NULL) {
+            inflight->async = true;
+        }
+        xSemaphoreGive(s_lock);
+    }
+    return ret;
+}
+
+esp_err_t http_metrics_async_handler_complete(httpd_req_t *req)
+{
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    http_inflight_t *inflight = inflight_find(httpd_req_to_sockfd(req));
+    if (inflight != NULL && inflight->async) {
+        inflight_finish(inflight, ESP_OK);
+    }
+    xSemaphoreGive(s_lock);
+    return httpd_req_async_handler_complete(req);
+}
+
+/**
+ * 查找或分配路由统计项
+ */
+static http_route_metrics_t *route_get(const char *route, const httpd_uri_t *uri)
+{
+    for (int i = 0; i < s_route_count; i++) {
+        http_route_metrics_t *m = &s_routes[i];
+        if (m->method == uri->method && m->handler == uri->handler && m->user_ctx == uri->user_ctx &&
+            strcmp(m->route, route) == 0) {
+            return m;
+        }
+    }
+    if (s_route_count >= HTTP_METRICS_MAX_ROUTES) {
+        return NULL;
+    }
+    http_route_metrics_t *m = &s_routes[s_route_count++];
+    m->route = route;
+    m->method = uri->method;
+    m->handler = uri->handler;
+    m->user_ctx = uri->user_ctx;
+    return m;
+}
+
+/**
+ * 包装带计时统计的URI处理器
+ */
+esp_err_t http_metrics_wrap_uri_handler(const httpd_uri_t *uri, const char *route, httpd_uri_t *out)
+{
+    *out = *uri;
+    if (s_lock == NULL) {
+        s_lock = xSemaphoreCreateMutex();
+        if (s_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    http_route_metrics_t *m = route_get(route != NULL ? route : uri->uri, uri);
+    if (m == NULL) {
+        ESP_LOGW(TAG, "路由统计表已满，%s 不做统计", route != NULL ? route : uri->uri);
+        return ESP_ERR_NO_MEM;
+    }
+
+    out->handler = metrics_handler;
+    out->user_ctx = m;
+    return ESP_OK;
+}
+
+/**
+ * 注册带计时统计的URI处理器
+ */
+esp_err_t http_metrics_register_uri_handler(httpd_handle_t server, const httpd_uri_t *uri, const char *route)
+{
+    httpd_uri_t wrapped;
+    if (http_metrics_wrap_uri_handler(uri, route, &wrapped) != ESP_OK && s_lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return httpd_register_uri_handler(server, &wrapped);
+}
+
+// 分块输出缓冲
+typedef struct http_metrics_writer {
+    httpd_req_t *req;
+    char buf[METRICS_CHUNK_SIZE];
+    size_t len;
+    bool failed;
+} metrics_writer_t;
+
+// 附加指标收集器 (初始化阶段注册)
+static struct {
+    http_metrics_collector_t fn;
+    void *arg;
+} s_collectors[HTTP_METRICS_MAX_COLLECTORS];
+static int s_collector_count = 0;
+
+static void writer_flush(metrics_writer_t *w)
+{
+    if (w->len > 0 && !w->failed) {
+        w->failed = httpd_resp_send_chunk(w->req, w->buf, w->len) != ESP_OK;
+    }
+    w->len = 0;
+}
+
+static void writer_vprintf(metrics_writer_t *w, const char *fmt, va_list args)
+{
+    char line[METRICS_LINE_SIZE];
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    if (len < 0) {
+        return;
+    }
+    if ((size_t)len >= sizeof(line)) {
+        len = sizeof(line) - 1;
+    }
+    if (w->len + len > sizeof(w->buf)) {
+        writer_flush(w);
+    }
+    memcpy(w->buf + w->len, line, len);
+    w->len += len;
+}
+
+static void writer_printf(metrics_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+static void writer_printf(metrics_writer_t *w, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    writer_vprintf(w, fmt, args);
+    va_end(args);
+}
+
+/**
+ * 输出一个计数器指标族 (每条路由一行)
+ */
+static void write_counter(metrics_writer_t *w, const http_route_metrics_t *routes, int count,
+                          const char *name, const char *help, size_t field_offset, bool wide)
+{
+    writer_printf(w, "# HELP %s %s\n# TYPE %s counter\n", name, help, name);
+    for (int i = 0; i < count; i++) {
+        const http_route_metrics_t *m = &routes[i];
+        const uint8_t *field = (const uint8_t *)m + field_offset;
+        unsigned long long value = wide ? *(const uint64_t *)field : *(const uint32_t *)field;
+        writer_printf(w, "%s{route=\"%s\",method=\"%s\"} %llu\n", name, m->route, method_name(m->method), value);
+    }
+}
+
+/**
+ * 以Prometheus文本格式发送全部路由指标
+ * 先在锁内复制计数快照，发送期间异步请求完成不会阻塞在锁上
+ */
+esp_err_t http_metrics_send(httpd_req_t *req)
+{
+    // 仅在httpd任务中使用，静态分配避免占用任务栈
+    static http_route_metrics_t snapshot[HTTP_METRICS_MAX_ROUTES];
+    static metrics_writer_t w;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int count = s_route_count;
+    memcpy(snapshot, s_routes, count * sizeof(http_route_metrics_t));
+    xSemaphoreGive(s_lock);
+
+    w.req = req;
+    w.len = 0;
+    w.failed = false;
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+
+    write_counter(&w, snapshot, count, "kvm_http_requests_total", "HTTP requests completed per route.",
+                  offsetof(http_route_metrics_t, requests), false);
+    write_counter(&w, snapshot, count, "kvm_http_errors_total",
+                  "HTTP requests answered with status >= 400 or failed in the handler.",
+                  offsetof(http_route_metrics_t, errors), false);
+    write_counter(&w, snapshot, count, "kvm_http_response_bytes_total", "Response bytes sent, headers included.",
+                  offsetof(http_route_metrics_t, bytes_sent), true);
+
+    const char *name = "kvm_http_request_duration_seconds";
+    writer_printf(&w, "# HELP %s Time from handler entry until the response is complete.\n# TYPE %s histogram\n",
+                  name, name);
+    for (int i = 0; i < count; i++) {
+        const http_route_metrics_t *m = &snapshot[i];
+        const char *method = method_name(m->method);
+        uint32_t cumulative = 0;
+        for (int b = 0; b < HTTP_METRICS_BUCKETS; b++) {
+            cumulative += m->buckets[b];
+            writer_printf(&w, "%s_bucket{route=\"%s\",method=\"%s\",le=\"%.6f\"} %lu\n", name, m->route, method,
+                          (double)(1UL << (b + HTTP_METRICS_MIN_BUCKET_SHIFT)) / 1e6, (unsigned long)cumulative);
+        }
+        writer_printf(&w, "%s_bucket{route=\"%s\",method=\"%s\",le=\"+Inf\"} %lu\n", name, m->route, method,
+                      (unsigned long)m->requests);
+        writer_printf(&w, "%s_sum{route=\"%s\",method=\"%s\"} %.6f\n", name, m->route, method,
+                      m->latency_sum_us / 1e6);
+        writer_printf(&w, "%s_count{route=\"%s\",method=\"%s\"} %lu\n", name, m->route, method,
+                      (unsigned long)m->requests);
+    }
+
+    for (int i = 0; i < s_collector_count; i++) {
+        s_collectors[i].fn(&w, s_collectors[i].arg);
+    }
+
+    writer_flush(&w);
+    if (w.failed) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * 注册附加指标收集器
+ */
+esp_err_t http_metrics_add_collector(http_metrics_collector_t collector, void *arg)
+{
+    if (collector == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < s_collector_count; i++) {
+        if (s_collectors[i].fn == collector && s_collectors[i].arg == arg) {
+            return ESP_OK;
+        }
+    }
+    if (s_collector_count >= HTTP_METRICS_MAX_COLLECTORS) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_collectors[s_collector_count].fn = collector;
+    s_collectors[s_collector_count].arg = arg;
+    s_collector_count++;
+    return ESP_OK;
+}
+
+/**
+ * 在收集器中输出Prometheus文本
+ */
+void http_metrics_printf(http_metrics_writer_t *w, const char *fmt, ...)
+{
+    va_list args;
+    va_start(args, fmt);
+    writer_vprintf(w, fmt, args);
+    va_end(args);
+}
@@ -0,0 +1,83 @@
+/**
+ * API路由表头文件
+ * 功能: 所有/api/请求只占用一个URI处理器槽位，由排序的路由表分发并提取路径参数
+ *
+ * 路由模式: 固定路径 (例如 "/api/status")，"{name}"匹配一个非空路径段 (例如 "/api/switch/{n}")，
+ *           结尾的"*"匹配剩余部分 (通配路由只在方法相同时生效，不会使其他方法的请求变为405)
+ * 分发: 固定路径按二分查找，带参数的模式(少量)依次匹配，耗时与通道数无关；
+ *       同一路径的固定路由优先于参数路由
+ */
+
+#ifndef API_ROUTER_H
+#define API_ROUTER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define API_ROUTER_PREFIX       "/api/*"    // 分发器注册的URI
+#define API_ROUTER_MAX_ROUTES   16
+#define API_ROUTER_MAX_PARAMS   2           // 单个模式最多的路径参数
+
+// 路由描述
+typedef struct {
+    const char *pattern;                        // 路由模式，同时作为指标的路由标签
+    httpd_method_t method;
+    esp_err_t (*handler)(httpd_req_t *req);
+    void *user_ctx;                             // 处理器收到的req->user_ctx
+} api_route_t;
+
+/**
+ * 建立路由表 (服务器启动时调用，重复调用时替换原路由表)
+ * 每条路由都带计时统计 (见http_metrics)，标签为路由模式
+ * 应在httpd任务开始处理/api/请求之前调用
+ * @param routes 路由描述数组 (pattern字符串须在整个运行期间有效)
+ * @param count 路由数
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 路由过多或模式无效
+ */
+esp_err_t api_router_init(const api_route_t *routes, size_t count);
+
+/**
+ * 分发器: 注册到API_ROUTER_PREFIX、方法为HTTP_ANY的URI处理器
+ * 没有匹配的路径回复404，路径匹配但方法不匹配回复405
+ * @param req HTTP请求对象
+ * @return 路由处理器的返回值
+ */
+esp_err_t api_router_dispatch(httpd_req_t *req);
+
+/**
+ * URI匹配函数 (用作httpd_config_t.uri_match_fn)
+ * 以"*"结尾的模板按前缀匹配，其他模板完全匹配 (不含查询串)
+ */
+bool api_router_uri_match(const char *uri_template, const char *uri_to_match, size_t match_upto);
+
+/**
+ * 获取当前请求的路径参数
+ * 只能在路由处理器中同步调用 (转为异步处理之前)
+ * @param req 处理器收到的请求
+ * @param name 参数名 (模式中"{}"内的名称)
+ * @param buf 输出缓冲区
+ * @param size 缓冲区大小
+ * @return ESP_OK 成功，ESP_ERR_NOT_FOUND 路由不含该参数，ESP_ERR_INVALID_SIZE 缓冲区不足
+ */
+esp_err_t api_router_get_param(httpd_req_t *req, const char *name, char *buf, size_t size);
+
+/**
+ * 获取十进制整数路径参数
+ * @param req 处理器收到的请求
+ * @param name 参数名
+ * @param value 输出参数值
+ * @return ESP_OK 成功，ESP_ERR_NOT_FOUND 路由不含该参数，ESP_ERR_INVALID_ARG 不是有效的整数
+ */
+esp_err_t api_router_get_param_int(httpd_req_t *req, const char *name, long *value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // API_ROUTER_H
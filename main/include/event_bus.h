@@ -0,0 +1,128 @@
+/**
+ * 内部事件总线头文件
+ * 功能: KVM控制器、WiFi管理器和UART通信模块发布类型化的状态变化事件，
+ *       状态LED、WebSocket推送、指标和日志订阅，取代各自的轮询
+ *
+ * 基于独立的esp_event事件循环 (不占用系统默认循环)，事件数据投递时复制，
+ * 处理器在事件总线任务中按投递顺序执行
+ */
+
+#ifndef EVENT_BUS_H
+#define EVENT_BUS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_event.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 事件总线任务配置
+#define EVENT_BUS_QUEUE_SIZE        16
+#define EVENT_BUS_TASK_STACK_SIZE   4096    // 订阅者在此任务中格式化WebSocket状态消息
+#define EVENT_BUS_TASK_PRIORITY     5
+
+ESP_EVENT_DECLARE_BASE(KVM_EVENT);
+
+// 事件类型 (注释为事件数据类型)
+typedef enum {
+    KVM_EVENT_CHANNEL_SWITCHED,     // kvm_event_switch_t
+    KVM_EVENT_SWITCH_FAILED,        // kvm_event_switch_t
+    KVM_EVENT_WIFI_LINK_UP,         // kvm_event_wifi_link_t (STA已关联，尚未获得IP)
+    KVM_EVENT_WIFI_LINK_DOWN,       // kvm_event_wifi_link_t
+    KVM_EVENT_WIFI_GOT_IP,          // kvm_event_wifi_ip_t
+    KVM_EVENT_AP_CLIENTS_CHANGED,   // kvm_event_ap_clients_t
+    KVM_EVENT_UART_LINK_UP,         // 无数据
+    KVM_EVENT_UART_LINK_DOWN,       // 无数据
+    KVM_EVENT_UART_ERROR,           // kvm_event_uart_error_t
+    KVM_EVENT_MAX
+} kvm_event_id_t;
+
+typedef struct {
+    int channel;                    // 目标通道
+    int previous_channel;
+    esp_err_t result;               // KVM_EVENT_SWITCH_FAILED时的错误码
+} kvm_event_switch_t;
+
+typedef struct {
+    char ssid[33];
+    int reason;                     // 断开原因 (wifi_err_reason_t)，连接时为0
+} kvm_event_wifi_link_t;
+
+typedef struct {
+    char ip[16];
+} kvm_event_wifi_ip_t;
+
+typedef struct {
+    int connected_clients;
+} kvm_event_ap_clients_t;
+
+// UART错误类型
+typedef enum {
+    KVM_UART_ERROR_CHECKSUM,        // 应答帧校验失败
+    KVM_UART_ERROR_OVERFLOW,        // 接收溢出
+    KVM_UART_ERROR_FRAMING,         // 帧错误或奇偶校验错误
+} kvm_uart_error_t;
+
+typedef struct {
+    kvm_uart_error_t kind;
+    uint32_t error_count;           // 发生后的累计错误数
+} kvm_event_uart_error_t;
+
+/**
+ * 初始化事件总线 (应在发布事件的模块初始化之前调用)
+ * @return ESP_OK 成功，其他值失败
+ */
+esp_err_t event_bus_init(void);
+
+/**
+ * 发布事件 (不阻塞，队列满时丢弃并计数；未初始化时忽略)
+ * 可在任意任务中调用，不能在中断中调用
+ * @param id 事件类型
+ * @param data 事件数据，投递时复制，可为NULL
+ * @param size 事件数据大小
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 未初始化，ESP_ERR_TIMEOUT 队列已满
+ */
+esp_err_t event_bus_post(kvm_event_id_t id, const void *data, size_t size);
+
+/**
+ * 订阅事件
+ * 处理器在事件总线任务中执行，应快速返回，不能同步等待通道切换
+ * @param id 事件类型，ESP_EVENT_ANY_ID订阅全部
+ * @param handler 处理器，event_data指向复制的事件数据
+ * @param arg 处理器参数
+ * @param instance 输出订阅句柄 (用于取消订阅)，可为NULL
+ * @return ESP_OK 成功，其他值失败
+ */
+esp_err_t event_bus_subscribe(int32_t id, esp_event_handler_t handler, void *arg,
+                              esp_event_handler_instance_t *instance);
+
+/**
+ * 取消订阅
+ * @param id 订阅时的事件类型
+ * @param instance event_bus_subscribe返回的句柄
+ * @return ESP_OK 成功，其他值失败
+ */
+esp_err_t event_bus_unsubscribe(int32_t id, esp_event_handler_instance_t instance);
+
+/**
+ * 获取事件名称
+ * @param id 事件类型
+ * @return 事件名称 (用于日志和指标标签)
+ */
+const char *event_bus_event_name(int32_t id);
+
+/**
+ * 获取事件统计 (无锁读取)
+ * @param id 事件类型
+ * @param delivered 输出已分发次数
+ * @param dropped 输出因队列满丢弃的次数
+ */
+void event_bus_get_stats(int32_t id, uint32_t *delivered, uint32_t *dropped);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVENT_BUS_H
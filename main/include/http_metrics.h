@@ -0,0 +1,107 @@
+/**
+ * HTTP路由指标头文件
+ * 功能: 包装URI处理器，按路由统计请求数、发送字节数、错误数和延迟直方图，以Prometheus文本格式导出
+ */
+
+#ifndef HTTP_METRICS_H
+#define HTTP_METRICS_H
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_http_server.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 最多统计的路由数 (静态分配，服务器重启后按路由标签复用，计数继续累加)
+#define HTTP_METRICS_MAX_ROUTES     24
+
+// 延迟直方图: 第i个桶上限为 2^(i+7) 微秒 (128us ~ 4.2s)，超出的计入+Inf
+#define HTTP_METRICS_BUCKETS        16
+#define HTTP_METRICS_MIN_BUCKET_SHIFT 7
+
+// 同时统计的进行中请求数 (每个socket最多一个，应不小于max_open_sockets)
+#define HTTP_METRICS_MAX_INFLIGHT   8
+
+// 最多可注册的附加指标收集器数
+#define HTTP_METRICS_MAX_COLLECTORS 4
+
+// 指标输出 (由http_metrics_send创建，只能在收集器回调中使用)
+typedef struct http_metrics_writer http_metrics_writer_t;
+
+/**
+ * 附加指标收集器，在/api/metrics输出路由指标后调用
+ * 在httpd任务中执行，应只读取计数器，不能阻塞
+ */
+typedef void (*http_metrics_collector_t)(http_metrics_writer_t *w, void *arg);
+
+/**
+ * 注册带计时统计的URI处理器 (替代httpd_register_uri_handler)
+ * 处理器收到的req->user_ctx仍是uri->user_ctx
+ *
+ * 同步请求统计到处理器返回为止；处理器用http_metrics_async_handler_begin转为异步时，
+ * 统计到http_metrics_async_handler_complete为止 (包括在其他任务中发送的应答)
+ * 长轮询等有意挂起的请求同样使用这对函数，否则其应答的字节数和状态码无法计入；
+ * 这类请求的延迟包含等待时间，主要落在高位桶中
+ *
+ * @param server 服务器句柄
+ * @param uri URI处理器描述
+ * @param route 路由标签，NULL时使用uri->uri；相同标签、方法与处理器的多个URI合并统计
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 路由表已满，其他值为注册失败
+ */
+esp_err_t http_metrics_register_uri_handler(httpd_handle_t server, const httpd_uri_t *uri, const char *route);
+
+/**
+ * 为URI处理器包装计时统计但不注册 (供自行分发请求的路由表使用)
+ * 调用out->handler时req->user_ctx必须为out->user_ctx
+ * @param uri URI处理器描述
+ * @param route 路由标签，NULL时使用uri->uri
+ * @param out 输出包装后的处理器描述；统计表已满时为未包装的uri副本
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 统计表已满或创建锁失败
+ */
+esp_err_t http_metrics_wrap_uri_handler(const httpd_uri_t *uri, const char *route, httpd_uri_t *out);
+
+/**
+ * 开始异步处理 (替代httpd_req_async_handler_begin)，请求延迟统计到异步处理结束
+ * @param req 处理器收到的请求
+ * @param out 复制出的异步请求
+ * @return 同httpd_req_async_handler_begin
+ */
+esp_err_t http_metrics_async_handler_begin(httpd_req_t *req, httpd_req_t **out);
+
+/**
+ * 结束异步处理并记录统计 (替代httpd_req_async_handler_complete，可在任意任务中调用)
+ * @param req http_metrics_async_handler_begin返回的异步请求
+ * @return 同httpd_req_async_handler_complete
+ */
+esp_err_t http_metrics_async_handler_complete(httpd_req_t *req);
+
+/**
+ * 以Prometheus文本格式(分块传输)发送全部路由指标
+ * 必须在httpd任务中调用 (通常由/api/metrics处理器调用)
+ * @param req HTTP请求对象
+ * @return ESP_OK 成功，其他值失败
+ */
+esp_err_t http_metrics_send(httpd_req_t *req);
+
+/**
+ * 注册附加指标收集器 (重复注册同一回调与参数时忽略)
+ * @param collector 收集器回调
+ * @param arg 回调参数
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 收集器已满
+ */
+esp_err_t http_metrics_add_collector(http_metrics_collector_t collector, void *arg);
+
+/**
+ * 在收集器中输出一行或多行Prometheus文本 (单次不超过192字节)
+ * @param w 收集器收到的输出
+ * @param fmt 格式字符串
+ */
+void http_metrics_printf(http_metrics_writer_t *w, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HTTP_METRICS_H
@@ -7,17 +7,25 @@
 #define KVM_CONTROLLER_H
 
 #include "esp_err.h"
+#include "sdkconfig.h"
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
-// 通道配置
+// 通道配置 (通道数由menuconfig的KVM_CHANNEL_COUNT决定)
+#ifndef CONFIG_KVM_CHANNEL_COUNT
+#define CONFIG_KVM_CHANNEL_COUNT    2
+#endif
 #define KVM_CHANNEL_MIN         1
-#define KVM_CHANNEL_MAX         2
+#define KVM_CHANNEL_MAX         CONFIG_KVM_CHANNEL_COUNT
 #define KVM_CHANNEL_DEFAULT     1
 
+// 通道变化代数: 正在更新时的取值，大于任何状态代数
+#define KVM_CHANNEL_GEN_PENDING UINT32_MAX
+
 // 切换状态
 typedef enum {
     KVM_SWITCH_IDLE,
@@ -26,6 +34,36 @@ typedef enum {
     KVM_SWITCH_FAILED
 } kvm_switch_status_t;
 
+// 切换任务配置
+#define KVM_SWITCH_JOB_HISTORY      8       // 保留最近的切换任务结果，供查询
+#define KVM_SWITCH_TASK_STACK_SIZE  4096
+#define KVM_SWITCH_TASK_PRIORITY    6
+
+// 切换任务状态
+typedef enum {
+    KVM_JOB_UNKNOWN,        // 任务不存在或已被新任务覆盖
+    KVM_JOB_QUEUED,
+    KVM_JOB_RUNNING,
+    KVM_JOB_DONE,
+    KVM_JOB_COALESCED       // 执行前被更新的切换请求取代，未发送
+} kvm_job_state_t;
+
+// 切换任务信息
+typedef struct {
+    uint32_t id;
+    int channel;
+    kvm_job_state_t state;
+    esp_err_t result;       // 仅在KVM_JOB_DONE时有效
+    uint32_t superseded_by; // 仅在KVM_JOB_COALESCED时有效
+} kvm_switch_job_info_t;
+
+/**
+ * 切换完成回调，在切换工作任务中调用 (请求被取代时在提交新请求的任务中调用)
+ * 回调应快速返回，不能阻塞 (例如发送网络数据)，需要时交给其他任务处理；
+ * 回调中不能再同步等待切换(kvm_controller_switch_channel)，否则会死锁
+ */
+typedef void (*kvm_switch_done_cb_t)(const kvm_switch_job_info_t *job, void *arg);
+
 // 通道状态
 typedef struct {
     int channel;
@@ -34,6 +72,7 @@ typedef struct {
     char name[32];
     uint32_t switch_count;
     uint32_t last_switch_time;
+    uint32_t changed_gen;       // 最后一次变化后的系统状态代数，用于只序列化变化的通道
 } kvm_channel_info_t;
 
 // KVM系统状态
@@ -44,6 +83,7 @@ typedef struct {
     bool communication_ok;
     uint32_t total_switches;
     uint32_t error_count;
+    uint32_t coalesced_switches;    // 被后续请求取代而未发送的切换次数
     kvm_channel_info_t channels[KVM_CHANNEL_MAX];
 } kvm_status_t;
 
@@ -54,12 +94,36 @@ typedef struct {
 esp_err_t kvm_controller_init(void);
 
 /**
- * 切换到指定通道
- * @param channel 目标通道 (1-2)
+ * 切换到指定通道 (同步)
+ * 提交到切换工作任务并等待完成，不能在httpd任务或完成回调中调用
+ * @param channel 目标通道 (1 ~ KVM_CHANNEL_MAX)
  * @return ESP_OK 成功，其他值失败
  */
 esp_err_t kvm_controller_switch_channel(int channel);
 
+/**
+ * 提交切换请求 (异步)
+ * 切换由专用工作任务串行执行，完成后调用done_cb
+ * 只保留一个等待中的请求(后写者胜): 上一条指令发送期间提交的新请求会取代
+ * 尚未执行的旧请求，旧请求的done_cb以KVM_JOB_COALESCED状态在本函数中回调
+ * @param channel 目标通道 (1 ~ KVM_CHANNEL_MAX)
+ * @param received_us 请求到达时间 (esp_timer_get_time)，用于切换延迟追踪；0表示提交时刻
+ * @param done_cb 完成回调，可为NULL
+ * @param arg 回调参数
+ * @param job_id 输出任务ID，可为NULL
+ * @return ESP_OK 已提交，ESP_ERR_INVALID_ARG 通道无效
+ */
+esp_err_t kvm_controller_submit_switch(int channel, int64_t received_us, kvm_switch_done_cb_t done_cb, void *arg,
+                                       uint32_t *job_id);
+
+/**
+ * 查询切换任务状态
+ * @param job_id 任务ID
+ * @param info 输出任务信息
+ * @return ESP_OK 成功，ESP_ERR_NOT_FOUND 任务不存在或已过期
+ */
+esp_err_t kvm_controller_get_switch_job(uint32_t job_id, kvm_switch_job_info_t *info);
+
 /**
  * 获取当前活跃通道
  * @return 当前通道号
@@ -67,10 +131,19 @@ esp_err_t kvm_controller_switch_channel(int channel);
 int kvm_controller_get_current_channel(void);
 
 /**
- * 获取KVM系统状态
- * @return KVM状态结构体指针
+ * 获取KVM系统状态的一致快照 (顺序锁，不阻塞切换任务，可在任意任务中调用)
+ * 统计计数器来自kvm_controller_get_counters
+ * @param out 输出状态副本
  */
-const kvm_status_t* kvm_controller_get_status(void);
+void kvm_controller_get_status_snapshot(kvm_status_t *out);
+
+/**
+ * 读取切换统计计数器 (无锁无等待)
+ * 只填写total_switches、error_count、coalesced_switches和各通道switch_count，其他字段不变
+ * 总切换次数不会超过同一次读取中各通道切换次数之和
+ * @param out 输出状态结构体
+ */
+void kvm_controller_get_counters(kvm_status_t *out);
 
 /**
  * 检查通道是否有效
@@ -88,11 +161,19 @@ bool kvm_controller_is_valid_channel(int channel);
 esp_err_t kvm_controller_set_channel_name(int channel, const char *name);
 
 /**
- * 获取通道信息
+ * 查询CH32V003的当前通道，与本地记录不一致时以对端为准 (会阻塞等待应答)
+ * 本地状态变化时发布KVM_EVENT_CHANNEL_SWITCHED
+ * @return ESP_OK 已同步，ESP_ERR_NOT_SUPPORTED 对端不支持查询，其他值失败
+ */
+esp_err_t kvm_controller_sync_channel(void);
+
+/**
+ * 获取通道信息的一致快照
  * @param channel 通道号
- * @return 通道信息结构体指针，失败返回NULL
+ * @param out 输出通道信息副本
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 通道无效
  */
-const kvm_channel_info_t* kvm_controller_get_channel_info(int channel);
+esp_err_t kvm_controller_get_channel_snapshot(int channel, kvm_channel_info_t *out);
 
 /**
  * 检测通道连接状态
@@ -112,14 +193,6 @@ kvm_switch_status_t kvm_controller_get_switch_status(void);
  */
 void kvm_controller_reset_error_count(void);
 
-/**
- * 获取统计信息JSON字符串
- * @param buffer 输出缓冲区
- * @param buffer_size 缓冲区大小
- * @return ESP_OK 成功，其他值失败
- */
-esp_err_t kvm_controller_get_stats_json(char *buffer, size_t buffer_size);
-
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,55 @@
+/**
+ * 响应缓存头文件
+ * 功能: 按状态代数缓存序列化后的API响应，状态未变化时直接复用
+ */
+
+#ifndef RESPONSE_CACHE_H
+#define RESPONSE_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 单条缓存，存储区由使用者静态分配
+typedef struct {
+    char *buf;
+    size_t capacity;
+    size_t len;
+    uint32_t generation;
+    bool valid;
+} response_cache_t;
+
+// 使用静态数组初始化缓存: static char buf[N]; static response_cache_t c = RESPONSE_CACHE_INIT(buf);
+#define RESPONSE_CACHE_INIT(storage) { .buf = (storage), .capacity = sizeof(storage), .len = 0, .generation = 0, .valid = false }
+
+/**
+ * 检查缓存是否对应指定的状态代数
+ * @param cache 缓存
+ * @param generation 当前状态代数
+ * @return true 可直接使用缓存内容
+ */
+bool response_cache_is_fresh(const response_cache_t *cache, uint32_t generation);
+
+/**
+ * 提交已写入cache->buf的内容
+ * @param cache 缓存
+ * @param generation 构建内容前读取的状态代数
+ * @param len 内容长度
+ */
+void response_cache_commit(response_cache_t *cache, uint32_t generation, size_t len);
+
+/**
+ * 使缓存失效
+ * @param cache 缓存
+ */
+void response_cache_invalidate(response_cache_t *cache);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RESPONSE_CACHE_H
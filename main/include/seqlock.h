@@ -0,0 +1,77 @@
+/**
+ * 顺序锁 (seqlock)
+ * 功能: 读者无锁获取一致的数据副本，写者不被读者阻塞
+ *
+ * 写者: 写区间必须不可抢占且写者之间互斥 (在portENTER_CRITICAL临界区内)，
+ *       否则读者可能在同一核心上抢占写者后一直自旋；写区间内只做赋值，不能阻塞、打印日志或调用回调
+ *   portENTER_CRITICAL(&mux); seqlock_write_begin(&sl); ...修改... seqlock_write_end(&sl); portEXIT_CRITICAL(&mux);
+ * 读者: 复制数据后检查序号，期间有写入则重试 (写区间很短，重试次数有限)
+ *   uint32_t seq;
+ *   do {
+ *       seq = seqlock_read_begin(&sl);
+ *       copy = data;
+ *   } while (seqlock_read_retry(&sl, seq));
+ */
+
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    atomic_uint_least32_t seq;      // 奇数表示写入进行中
+} seqlock_t;
+
+#define SEQLOCK_INIT    { 0 }
+
+/**
+ * 开始读取，等待正在进行的写入结束
+ * @return 读取开始时的序号
+ */
+static inline uint32_t seqlock_read_begin(const seqlock_t *sl)
+{
+    uint32_t seq;
+    while ((seq = atomic_load_explicit((atomic_uint_least32_t *)&sl->seq, memory_order_acquire)) & 1) {
+        // 写者在临界区内 (不可抢占) 且只有几次赋值，自旋等待即可
+    }
+    return seq;
+}
+
+/**
+ * 检查读取期间是否发生写入
+ * @return true 数据可能不一致，需要重新读取
+ */
+static inline bool seqlock_read_retry(const seqlock_t *sl, uint32_t start)
+{
+    atomic_thread_fence(memory_order_acquire);
+    return atomic_load_explicit((atomic_uint_least32_t *)&sl->seq, memory_order_relaxed) != start;
+}
+
+/**
+ * 开始写入 (调用者已保证写者互斥)
+ */
+static inline void seqlock_write_begin(seqlock_t *sl)
+{
+    atomic_fetch_add_explicit(&sl->seq, 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+}
+
+/**
+ * 结束写入
+ */
+static inline void seqlock_write_end(seqlock_t *sl)
+{
+    atomic_fetch_add_explicit(&sl->seq, 1, memory_order_release);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SEQLOCK_H
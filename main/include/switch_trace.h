@@ -0,0 +1,73 @@
+/**
+ * 通道切换延迟追踪头文件
+ * 功能: 记录每次切换从请求到达到对端确认的各阶段耗时，保存分阶段直方图和最近的切换记录
+ */
+
+#ifndef SWITCH_TRACE_H
+#define SWITCH_TRACE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "json_writer.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SWITCH_TRACE_HISTORY        16      // 保留最近的切换记录数
+#define SWITCH_TRACE_BUCKETS        16      // 第i个桶上限为 2^(i+7) 微秒 (128us ~ 4.2s)，超出的计入溢出桶
+#define SWITCH_TRACE_MIN_BUCKET_SHIFT 7
+
+// 切换阶段
+typedef enum {
+    SWITCH_PHASE_HTTP,          // 请求到达 -> 提交切换 (读取正文、解析参数)
+    SWITCH_PHASE_QUEUE,         // 提交 -> 切换工作任务取出 (等待前一个切换完成)
+    SWITCH_PHASE_MUTEX,         // 取出 -> 获得KVM互斥锁
+    SWITCH_PHASE_UART_WAIT,     // 获得锁 -> 帧写入UART驱动 (等待发送窗口和UART锁)
+    SWITCH_PHASE_TX,            // 写入驱动 -> 帧从UART发出
+    SWITCH_PHASE_ACK,           // 发出 -> 收到CH32V003应答 (含重传)
+    SWITCH_PHASE_TOTAL,         // 请求到达 -> 切换完成
+    SWITCH_PHASE_MAX
+} switch_phase_t;
+
+// 一次切换的各阶段时间戳 (esp_timer_get_time，微秒；0表示该阶段未发生)
+typedef struct {
+    uint32_t job_id;
+    int channel;
+    int64_t received_us;
+    int64_t submitted_us;
+    int64_t dequeued_us;
+    int64_t locked_us;
+    int64_t tx_start_us;
+    int64_t tx_done_us;
+    int64_t ack_us;
+    int64_t done_us;
+} switch_trace_stamps_t;
+
+/**
+ * 初始化切换追踪 (由KVM控制器初始化时调用)
+ * @return ESP_OK 成功，ESP_ERR_NO_MEM 创建互斥锁失败
+ */
+esp_err_t switch_trace_init(void);
+
+/**
+ * 记录一次已执行的切换 (在切换工作任务中调用)
+ * 没有发送UART帧(已在目标通道)时只记录HTTP/排队/互斥锁和总耗时
+ * @param stamps 各阶段时间戳
+ * @param result 切换结果
+ */
+void switch_trace_record(const switch_trace_stamps_t *stamps, esp_err_t result);
+
+/**
+ * 写入追踪数据: "phases"(各阶段直方图与分位数估计，取所在桶的上限) 和 "recent"(最近的切换，新的在前)
+ * 字段写入调用者已打开的对象中
+ * @param w JSON写入器
+ */
+void switch_trace_write_json(json_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SWITCH_TRACE_H
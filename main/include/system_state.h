@@ -0,0 +1,49 @@
+/**
+ * 系统状态版本号头文件
+ * 功能: 全局单调递增的状态代数(generation)，用于缓存失效和变更检测
+ */
+
+#ifndef SYSTEM_STATE_H
+#define SYSTEM_STATE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 最多可注册的变化监听器数量
+#define SYSTEM_STATE_MAX_LISTENERS  4
+
+/**
+ * 状态变化监听器
+ * 在调用system_state_mark_changed的任务上下文中执行，必须快速返回且不能阻塞
+ * (通常只做任务通知)
+ */
+typedef void (*system_state_listener_t)(uint32_t generation, void *arg);
+
+/**
+ * 获取当前状态代数
+ * @return 状态代数，每次可见状态变化后递增
+ */
+uint32_t system_state_get_generation(void);
+
+/**
+ * 标记系统状态已变化 (KVM、WiFi、通信模块在修改对外可见状态后调用)
+ * @return 递增后的状态代数
+ */
+uint32_t system_state_mark_changed(void);
+
+/**
+ * 注册状态变化监听器 (应在初始化阶段调用)
+ * @param listener 回调函数
+ * @param arg 回调参数
+ * @return 0 成功，-1 监听器已满
+ */
+int system_state_add_listener(system_state_listener_t listener, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYSTEM_STATE_H
@@ -17,7 +17,15 @@ extern "C" {
 
 // UART配置参数 - 使用UART0的默认引脚（TX0/RX0丝印）
 #define UART_PORT_NUM           UART_NUM_0
-#define UART_BAUD_RATE          9600
+#define UART_BAUD_RATE          9600    // 默认波特率，CH32V003复位后使用
+
+// 波特率协商: 按顺序逐级尝试，结果保存在NVS
+#define UART_BAUD_RATE_CANDIDATES   { 115200, 460800, 921600 }
+#define UART_BAUD_PROBE_RETRIES     1       // 协商时的重传次数
+#define UART_BAUD_REVERT_MS         500     // 对端在新速率下无有效帧时回退的时间
+#define UART_BAUD_FALLBACK_TIMEOUTS 3       // 高速率下连续无应答次数达到此值时回退
+#define UART_NVS_NAMESPACE          "uart"
+#define UART_NVS_KEY_BAUD           "baud"
 #define UART_DATA_BITS          UART_DATA_8_BITS
 #define UART_PARITY             UART_PARITY_DISABLE
 #define UART_STOP_BITS          UART_STOP_BITS_1
@@ -33,15 +41,76 @@ extern "C" {
 #define UART_TX_BUFFER_SIZE     256
 #define UART_RX_BUFFER_SIZE     256
 
-// 通信状态 (简化)
+// 帧格式: [0xBB][状态][数据长度][通道][序号][指令][参数13字节][校验和][0x66]
+// 序号和指令位于原协议的填充区。对端应答回显非0序号之前 (未确认支持扩展协议)，
+// 切换指令按原协议发送 (序号和指令为0，校验和与协议图片一致)
+#define UART_FRAME_SIZE         21
+#define UART_FRAME_HEAD         0xBB
+#define UART_FRAME_TAIL         0x66
+#define UART_FRAME_STATUS_OK    0x00
+#define UART_FRAME_STATUS_FAIL  0x01
+#define UART_FRAME_SEQ_IDX      4
+#define UART_FRAME_CMD_IDX      5
+#define UART_FRAME_PAYLOAD_IDX  6
+#define UART_FRAME_PAYLOAD_MAX  13
+#define UART_FRAME_CHECKSUM_IDX 19
+
+// 指令类型
+#define UART_CMD_SWITCH         0x00    // 切换通道 (原协议帧)
+#define UART_CMD_QUERY          0x01    // 查询当前通道
+#define UART_CMD_RENAME         0x02    // 设置通道名称 (参数区为名称)
+#define UART_CMD_SET_BAUD       0x03    // 切换波特率 (参数区为4字节小端波特率)
+
+// 传输层配置
+#define UART_TX_WINDOW          4       // 同时在途的指令数
+#define UART_MAX_RETRIES        3       // 超时重传次数
+#define UART_WINDOW_WAIT_MS     1000    // 等待空闲窗口的时间
+#define UART_FRAME_TIME_MS      22      // 9600波特率下一帧的发送时间 (最慢情况)
+#define UART_RTO_INITIAL_MS     200     // 尚无往返时间样本时的重传超时
+#define UART_RTO_MIN_MS         50
+#define UART_RTO_MAX_MS         1000
+#define UART_LEGACY_REPLY_MS    (UART_FRAME_TIME_MS * 3)   // 原协议帧发出后等待可选应答的时间 (不重传)
+
+// 接收任务配置
+#define UART_EVENT_QUEUE_SIZE   16
+#define UART_PATTERN_QUEUE_SIZE 8
+#define UART_RX_TASK_STACK_SIZE 3072
+#define UART_RX_TASK_PRIORITY   7
+
+// 为1时切换指令始终要求应答 (重传后仍未收到视为失败)；
+// 为0时仅在对端确认支持扩展协议后要求应答，此前按原协议只发送一次，无应答只标记链路断开
+#define UART_REQUIRE_RESPONSE       0
+
+// 通信状态
 typedef struct {
-    bool connected;
-    uint32_t tx_count;
-    uint32_t rx_count;
-    uint32_t error_count;
-    uint64_t last_response_time; // 使用64位以防溢出
+    bool connected;                 // 最近一次指令收到了有效应答
+    uint32_t tx_count;              // 已发送帧数
+    uint32_t rx_count;              // 已接收的有效帧数
+    uint32_t error_count;           // 校验/帧格式/溢出错误数
+    uint32_t timeout_count;         // 重传后仍无应答的指令数
+    uint32_t retransmit_count;      // 重传次数
+    uint32_t srtt_ms;               // 平滑往返时间
+    uint32_t rto_ms;                // 当前重传超时
+    uint32_t baud_rate;             // 当前波特率
+    uint64_t last_response_time;    // 最近一次有效应答时间 (开机后毫秒)
 } uart_comm_status_t;
 
+// 单条同步指令各阶段的时间戳 (esp_timer_get_time，微秒)
+typedef struct {
+    int64_t submit_us;              // 开始提交 (等待发送窗口之前)
+    int64_t tx_start_us;            // 帧写入驱动发送缓冲区 (首次发送)
+    int64_t tx_done_us;             // 帧已从UART发出
+    int64_t ack_us;                 // 收到对端应答，超时为0
+} uart_comm_timing_t;
+
+/**
+ * 指令完成回调，在UART接收任务中调用
+ * @param result ESP_OK 对端确认，ESP_FAIL 对端返回失败，ESP_ERR_TIMEOUT 重传后仍无应答
+ * @param reply 应答帧 (21字节)，超时时为NULL
+ * @param arg 用户参数
+ */
+typedef void (*uart_comm_done_cb_t)(esp_err_t result, const uint8_t *reply, void *arg);
+
 /**
  * 初始化UART通信
  * @return ESP_OK 成功，其他值失败
@@ -49,26 +118,95 @@ typedef struct {
 esp_err_t uart_comm_init(void);
 
 /**
- * 发送通道切换命令
- * @param channel 目标通道 (1 或 2)
- * @return ESP_OK 成功，其他值失败
+ * 提交指令 (异步)
+ * 窗口已满时最多等待UART_WINDOW_WAIT_MS，发送后立即返回
+ * @param cmd 指令类型 (UART_CMD_*)
+ * @param channel 通道号
+ * @param payload 参数，可为NULL
+ * @param payload_len 参数长度 (不超过UART_FRAME_PAYLOAD_MAX)
+ * @param done_cb 完成回调，可为NULL
+ * @param arg 回调参数
+ * @return ESP_OK 已发送，其他值失败 (回调不会被调用)
+ */
+esp_err_t uart_comm_submit(uint8_t cmd, int channel, const uint8_t *payload, size_t payload_len,
+                           uart_comm_done_cb_t done_cb, void *arg);
+
+/**
+ * 发送指令并等待应答 (同步)
+ * 不能在UART接收任务(完成回调)中调用
+ * @param reply 输出应答帧 (21字节)，可为NULL
+ * @return ESP_OK 对端确认，ESP_FAIL 对端返回失败，ESP_ERR_TIMEOUT 无应答
+ */
+esp_err_t uart_comm_request(uint8_t cmd, int channel, const uint8_t *payload, size_t payload_len,
+                            uint8_t *reply);
+
+/**
+ * 发送通道切换命令并等待CH32V003确认
+ * @param channel 目标通道 (1 ~ KVM_CHANNEL_MAX)
+ * @return ESP_OK 成功(已确认，或不要求应答时未应答)，
+ *         ESP_FAIL 对端返回失败，ESP_ERR_TIMEOUT 未应答(要求应答时，见UART_REQUIRE_RESPONSE)
  */
 esp_err_t uart_comm_switch_channel(int channel);
 
 /**
- * 检查通信连接状态 (存根)
+ * 发送通道切换命令并等待确认，同时记录各阶段时间戳 (用于切换延迟追踪)
+ * @param channel 目标通道 (1 ~ KVM_CHANNEL_MAX)
+ * @param timing 输出时间戳，可为NULL (与uart_comm_switch_channel相同)
+ * @return 同uart_comm_switch_channel
+ */
+esp_err_t uart_comm_switch_channel_timed(int channel, uart_comm_timing_t *timing);
+
+/**
+ * 查询CH32V003当前通道
+ * @param channel 输出通道号
+ * @return ESP_OK 成功，ESP_ERR_NOT_SUPPORTED 对端未确认支持扩展协议，其他值失败
+ */
+esp_err_t uart_comm_query_channel(int *channel);
+
+/**
+ * 设置CH32V003端的通道名称 (超过13字节截断)
+ * 原协议固件会把该指令当作切换，因此对端确认支持扩展协议之前不发送
+ * 指令提交后立即返回，对端拒绝或超时只记录日志
+ * @return ESP_OK 已提交，ESP_ERR_NOT_SUPPORTED 对端未确认支持扩展协议，其他值失败
+ */
+esp_err_t uart_comm_set_channel_name(int channel, const char *name);
+
+/**
+ * 协商波特率
+ * 先在默认速率下探测，无应答时尝试NVS中保存的速率；默认速率可用时逐级尝试UART_BAUD_RATE_CANDIDATES
+ * 需要在uart_comm_init之后调用 (会阻塞，探测失败时可达数秒)
+ * @return ESP_OK 链路可用，ESP_ERR_TIMEOUT 对端无应答 (保持默认速率)
+ */
+esp_err_t uart_comm_negotiate_baud(void);
+
+/**
+ * 计算帧校验和
+ * 按协议图片推算: 除数据长度字节外，第0-18字节的异或
+ * (BB 00 01 01 ... -> 0xBA, BB 00 01 02 ... -> 0xB9, BB 01 00 00 ... -> 0xBA)
+ * @param frame 21字节帧
+ * @return 校验和
+ */
+uint8_t uart_comm_frame_checksum(const uint8_t *frame);
+
+/**
+ * 对端是否已确认支持扩展协议 (应答回显过非0序号，一般在uart_comm_negotiate_baud中确认)
+ */
+bool uart_comm_peer_sequenced(void);
+
+/**
+ * 检查通信连接状态
  * @return true 已连接，false 未连接
  */
 bool uart_comm_is_connected(void);
 
 /**
- * 获取通信状态 (存根)
- * @return 通信状态结构体指针
+ * 获取通信状态快照 (各字段原子读取，可在任意任务中调用)
+ * @param out 输出通信状态
  */
-const uart_comm_status_t* uart_comm_get_status(void);
+void uart_comm_get_status_snapshot(uart_comm_status_t *out);
 
 /**
- * 重置通信状态 (存根)
+ * 重置通信计数
  */
 void uart_comm_reset_status(void);
 
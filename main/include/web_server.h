@@ -22,10 +22,12 @@ extern "C" {
 #define API_ROOT                "/api"
 #define API_STATUS              "/api/status"
 #define API_SWITCH              "/api/switch"
+#define API_SWITCH_TRACE        "/api/switch/trace"
 #define API_CHANNELS            "/api/channels"
 #define API_WIFI                "/api/wifi"
 #define API_SCAN                "/api/scan"
 #define API_CONFIG              "/api/config"
+#define API_METRICS             "/api/metrics"
 
 // WebSocket路径
 #define WS_PATH                 "/ws"
@@ -100,11 +102,25 @@ int web_server_parse_post_data(httpd_req_t *req, char *buffer, size_t buffer_siz
 
 /**
  * 向所有WebSocket客户端广播消息
+ * 消息被复制后交给httpd任务异步发送，不阻塞调用者
  * @param message 要广播的消息
  * @return ESP_OK 成功，其他值失败
  */
 esp_err_t web_server_broadcast_ws_message(const char *message);
 
+/**
+ * 向所有WebSocket客户端广播系统状态 (status_update)
+ * 通道列表只包含上次广播之后变化的通道；由事件总线订阅者调用，不可重入
+ * @return ESP_OK 成功，其他值失败
+ */
+esp_err_t web_server_broadcast_status(void);
+
+/**
+ * 获取当前WebSocket客户端数量
+ * @return 客户端数量
+ */
+int web_server_get_ws_client_count(void);
+
 #ifdef __cplusplus
 }
 #endif
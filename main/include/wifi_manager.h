@@ -16,7 +16,39 @@ extern "C" {
 // WiFi配置参数
 #define WIFI_SSID_MAX_LEN       32
 #define WIFI_PASSWORD_MAX_LEN   64
-#define WIFI_RETRY_MAX          5
+#define WIFI_CONNECT_TIMEOUT_MS 15000   // 发起连接后超过该时间没有结果视为失败
+
+// 重连: 断开后第一次立即重试，之后按指数退避 (基数 * 2^n，上限WIFI_BACKOFF_MAX_MS)，
+// 实际等待在退避时间的一半到全部之间随机，避免多台设备在AP恢复后同时重连
+#define WIFI_BACKOFF_BASE_MS    250
+#define WIFI_BACKOFF_MAX_MS     30000
+
+// 快速重连: 启动时的首次连接和断开后的前几次重试使用上次成功连接的BSSID和信道定向连接 (不做全信道扫描)，
+// 仍失败时改为全信道扫描；连接参数保存在NVS，断电重启后同样有效
+#define WIFI_FAST_CONNECT_TRIES 2
+#define WIFI_NVS_NAMESPACE      "wifi"
+#define WIFI_NVS_KEY_LINK       "link"
+
+// 已知网络列表: 保存在NVS (通过POST /api/wifi配置)，有多个已知网络时，
+// 启动和快速重连失败后扫描一次，按优先级、再按信号强度选择可见的网络；列表为空时使用DEFAULT_STA_*
+#define WIFI_KNOWN_MAX          8
+#define WIFI_NVS_KEY_KNOWN      "known"
+
+// 链路采样: 连接任务在STA在线时定期读取RSSI，状态读取不访问WiFi驱动
+#define WIFI_SAMPLE_INTERVAL_MS 2000
+#define WIFI_RSSI_EWMA_SHIFT    2       // 平滑系数 1/2^n
+#define WIFI_RSSI_CHANGE_THRESHOLD  3   // 平滑后的RSSI变化超过该值(dBm)才更新状态
+
+// 扫描: 由连接任务在后台发起 (不阻塞调用者)，结果缓存并标记时间，
+// 每个信道驻留较短时间并在信道之间回到工作信道，减少对STA和AP流量的影响
+#define WIFI_SCAN_MAX_RECORDS   16
+#define WIFI_SCAN_CACHE_TTL_MS  30000   // 默认的缓存有效期，超过后的请求触发重新扫描
+#define WIFI_SCAN_DWELL_MS      60      // 每个信道的主动扫描时间上限
+#define WIFI_SCAN_HOME_DWELL_MS 30      // 相邻信道之间回到工作信道的时间
+
+// 连接任务配置
+#define WIFI_TASK_STACK_SIZE    3072
+#define WIFI_TASK_PRIORITY      4
 
 // 默认AP配置
 #define DEFAULT_AP_SSID         "ESP32-KVM"
@@ -24,23 +56,52 @@ extern "C" {
 #define DEFAULT_AP_CHANNEL      1
 #define DEFAULT_AP_MAX_CONN     4
 
-// 默认STA配置 - 请修改为您的WiFi信息
+// 默认STA配置 (已知网络列表为空时使用) - 请修改为您的WiFi信息
 #define DEFAULT_STA_SSID        "maomao"     // WiFi名称
 #define DEFAULT_STA_PASSWORD    "y20050725" // WiFi密码
 
+// STA连接状态 (由连接任务维护)
+typedef enum {
+    WIFI_STA_STATE_IDLE,            // 未发起连接 (已调用wifi_manager_disconnect)
+    WIFI_STA_STATE_CONNECTING,      // 正在连接
+    WIFI_STA_STATE_CONNECTED,       // 已获得IP
+    WIFI_STA_STATE_WAIT_RETRY,      // 连接失败或断开，等待重试
+    WIFI_STA_STATE_SELECTING,       // 扫描中，扫描完成后从已知网络中选择
+} wifi_sta_state_t;
+
+// 已知网络
+typedef struct {
+    char ssid[WIFI_SSID_MAX_LEN + 1];
+    char password[WIFI_PASSWORD_MAX_LEN + 1];   // 空字符串表示开放网络
+    uint8_t priority;                           // 越大越优先
+} wifi_known_network_t;
+
+// 扫描缓存信息
+typedef struct {
+    uint16_t count;                 // 复制的记录数
+    bool valid;                     // 已有完成的扫描结果
+    bool scanning;                  // 扫描进行中或已请求
+    uint32_t age_ms;                // 结果距完成的时间 (valid时有效)
+} wifi_scan_info_t;
+
 // WiFi状态
 typedef struct {
+    wifi_sta_state_t sta_state;
     bool sta_connected;
     bool ap_started;
     char sta_ssid[WIFI_SSID_MAX_LEN];
     char sta_ip[16];
     char ap_ip[16];
-    int sta_rssi;
+    int sta_rssi;                   // 平滑后的RSSI (dBm)，未连接时为0
+    int sta_link_quality;           // 链路质量 (0 ~ 100)，由平滑RSSI换算
+    uint32_t sta_tx_rate_kbps;      // 按平滑RSSI和协商的PHY模式估算的发送速率
     int connected_clients;
 } wifi_status_t;
 
 /**
  * 初始化WiFi管理器
+ * 以AP+STA模式启动后立即返回: AP马上可用，STA由连接任务在后台连接和重试；
+ * STA获得IP且AP上没有客户端时关闭AP，STA断开时重新开启AP
  * @return ESP_OK 成功，其他值失败
  */
 esp_err_t wifi_manager_init(void);
@@ -54,24 +115,51 @@ esp_err_t wifi_manager_init(void);
 esp_err_t wifi_manager_start_ap(const char *ssid, const char *password);
 
 /**
- * 连接到WiFi网络
+ * 连接到WiFi网络 (不等待结果)
+ * 连接结果通过KVM_EVENT_WIFI_GOT_IP / KVM_EVENT_WIFI_LINK_DOWN事件和wifi_manager_get_status_snapshot获得，
+ * 失败后自动重试
  * @param ssid 网络名称
  * @param password 网络密码
- * @return ESP_OK 成功，其他值失败
+ * @return ESP_OK 已发起连接，ESP_ERR_INVALID_ARG 参数无效，ESP_ERR_INVALID_STATE 未初始化
  */
 esp_err_t wifi_manager_connect_sta(const char *ssid, const char *password);
 
 /**
- * 断开WiFi连接
+ * 替换已知网络列表并保存到NVS，然后按新列表重新选择网络
+ * 当前已连接的网络仍在列表中时保持连接
+ * @param networks 已知网络数组 (SSID不能为空或重复，密码为空或8~64个字符)
+ * @param count 网络数 (0表示清空，之后使用默认配置)
+ * @return ESP_OK 成功，ESP_ERR_INVALID_ARG 参数无效，ESP_ERR_INVALID_STATE 未初始化，其他值为NVS错误
+ */
+esp_err_t wifi_manager_set_known_networks(const wifi_known_network_t *networks, size_t count);
+
+/**
+ * 获取已知网络列表
+ * @param networks 输出缓冲区
+ * @param max_count 缓冲区容量
+ * @return 复制的网络数
+ */
+size_t wifi_manager_get_known_networks(wifi_known_network_t *networks, size_t max_count);
+
+/**
+ * 断开WiFi连接并停止自动重连 (AP重新开启)
  * @return ESP_OK 成功，其他值失败
  */
 esp_err_t wifi_manager_disconnect(void);
 
 /**
- * 获取WiFi状态
- * @return WiFi状态结构体指针
+ * 获取STA连接状态名称
+ * @param state STA连接状态
+ * @return 状态名称 (用于API输出)
+ */
+const char *wifi_manager_sta_state_name(wifi_sta_state_t state);
+
+/**
+ * 获取WiFi状态的一致快照 (顺序锁，不访问WiFi驱动，可在任意任务中调用)
+ * RSSI、链路质量和发送速率由连接任务每WIFI_SAMPLE_INTERVAL_MS采样一次
+ * @param out 输出状态副本
  */
-const wifi_status_t* wifi_manager_get_status(void);
+void wifi_manager_get_status_snapshot(wifi_status_t *out);
 
 /**
  * 检查是否已连接WiFi
@@ -88,12 +176,18 @@ bool wifi_manager_is_connected(void);
 esp_err_t wifi_manager_get_ip(char *ip_str, size_t len);
 
 /**
- * 扫描可用WiFi网络
- * @param scan_result 扫描结果缓冲区
- * @param max_records 最大记录数
- * @return 实际扫描到的网络数量
+ * 获取缓存的扫描结果 (不阻塞，可在任意任务中调用)
+ * 没有结果或结果超过max_age_ms且没有扫描在进行时，请求连接任务在后台扫描，
+ * 扫描完成后的调用得到新结果；并发调用者共享同一次扫描
+ * STA正在连接时扫描推迟到连接结束，扫描期间的重连推迟到扫描完成
+ * @param max_age_ms 可接受的结果时间
+ * @param records 输出记录缓冲区，可为NULL
+ * @param max_records 缓冲区容量
+ * @param info 输出缓存信息
+ * @return ESP_OK 成功，ESP_ERR_INVALID_STATE 未初始化
  */
-uint16_t wifi_manager_scan_networks(wifi_ap_record_t *scan_result, uint16_t max_records);
+esp_err_t wifi_manager_scan_get_cached(uint32_t max_age_ms, wifi_ap_record_t *records,
+                                       uint16_t max_records, wifi_scan_info_t *info);
 
 #ifdef __cplusplus
 }
@@ -3,28 +3,166 @@
  * 功能: 管理HDMI通道切换和状态
  */
 
+#include <stdio.h>
 #include <string.h>
+#include <stdatomic.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_timer.h"
-#include "cJSON.h"
 
 #include "kvm_controller.h"
 #include "uart_comm.h"
+#include "system_state.h"
+#include "switch_trace.h"
+#include "seqlock.h"
+#include "event_bus.h"
 
 static const char *TAG = "KVM_CTRL";
 
 // KVM系统状态
+// s_kvm_mutex串行化切换 (持有期间包括UART收发)；对s_kvm_status的每次修改另外在
+// s_status_spinlock临界区 + 顺序锁写区间内完成，读者通过快照接口无锁获取一致副本
 static kvm_status_t s_kvm_status = {0};
 static SemaphoreHandle_t s_kvm_mutex = NULL;
+static portMUX_TYPE s_status_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static seqlock_t s_status_seq = SEQLOCK_INIT;
 
-// 默认通道名称
-static const char* default_channel_names[KVM_CHANNEL_MAX] = {
-    "电脑1", "电脑2"
-};
+// 切换统计计数器: 原子变量，不进入s_kvm_mutex和顺序锁写区间，抓取指标时无需等待
+// (各计数器实际只有一个写者任务，不存在跨核竞争，因此不再按核心分片)
+// 快照中的对应字段由这里填入，s_kvm_status中的这些字段不再使用
+typedef struct {
+    atomic_uint_least32_t total_switches;
+    atomic_uint_least32_t error_count;
+    atomic_uint_least32_t coalesced_switches;
+    atomic_uint_least32_t channel_switches[KVM_CHANNEL_MAX];
+} kvm_counters_t;
+
+static kvm_counters_t s_counters;
+
+// 切换工作任务: 串行执行UART切换，避免在httpd任务中阻塞
+#if CONFIG_FREERTOS_UNICORE
+#define KVM_SWITCH_TASK_CORE    0
+#else
+#define KVM_SWITCH_TASK_CORE    1       // WiFi/lwip默认运行在核心0
+#endif
+
+typedef struct {
+    uint32_t id;
+    int channel;
+    kvm_switch_done_cb_t done_cb;
+    void *arg;
+    int64_t received_us;        // 请求到达时间 (用于延迟追踪)
+    int64_t submitted_us;
+} kvm_switch_job_t;
+
+// 等待执行的切换请求 (后写者胜，受s_job_mutex保护)
+static kvm_switch_job_t s_pending_job;
+static bool s_pending_valid = false;
+static TaskHandle_t s_switch_task = NULL;
+static SemaphoreHandle_t s_job_mutex = NULL;
+static kvm_switch_job_info_t s_job_history[KVM_SWITCH_JOB_HISTORY];
+static uint32_t s_next_job_id = 1;
+
+static esp_err_t kvm_controller_do_switch(int channel, switch_trace_stamps_t *stamps);
+
+// 默认通道名称 (按通道号生成)
+#define KVM_DEFAULT_CHANNEL_NAME    "电脑%d"
+
+/**
+ * 开始修改s_kvm_status (进入临界区，写区间内只做赋值，不能阻塞或打印日志)
+ */
+static void kvm_status_write_begin(void)
+{
+    portENTER_CRITICAL(&s_status_spinlock);
+    seqlock_write_begin(&s_status_seq);
+}
+
+/**
+ * 结束修改s_kvm_status
+ */
+static void kvm_status_write_end(void)
+{
+    seqlock_write_end(&s_status_seq);
+    portEXIT_CRITICAL(&s_status_spinlock);
+}
+
+/**
+ * 发布通道变化: 递增系统状态代数并写入各通道的变化代数
+ * 调用者在修改通道的同一写区间内已把changed_gen置为KVM_CHANNEL_GEN_PENDING，
+ * 因此在新代数写入之前，基于任何旧代数的读者都会把这些通道视为已变化
+ */
+static void kvm_channels_publish(const int *channels, int count)
+{
+    uint32_t generation = system_state_mark_changed();
+
+    kvm_status_write_begin();
+    for (int i = 0; i < count; i++) {
+        s_kvm_status.channels[channels[i] - 1].changed_gen = generation;
+    }
+    kvm_status_write_end();
+}
+
+/**
+ * 记录切换任务状态 (调用者持有s_job_mutex，按ID取模覆盖最旧的记录)
+ */
+static void kvm_job_record(const kvm_switch_job_info_t *info)
+{
+    s_job_history[info->id % KVM_SWITCH_JOB_HISTORY] = *info;
+}
+
+/**
+ * 切换工作任务
+ * 每次取出最新的等待请求执行，UART等待只阻塞本任务
+ */
+static void kvm_switch_task(void *pvParameters)
+{
+    kvm_switch_job_t job;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        while (1) {
+            xSemaphoreTake(s_job_mutex, portMAX_DELAY);
+            if (!s_pending_valid) {
+                xSemaphoreGive(s_job_mutex);
+                break;
+            }
+            job = s_pending_job;
+            s_pending_valid = false;
+            switch_trace_stamps_t stamps = {
+                .job_id = job.id,
+                .channel = job.channel,
+                .received_us = job.received_us,
+                .submitted_us = job.submitted_us,
+                .dequeued_us = esp_timer_get_time()
+            };
+            kvm_switch_job_info_t info = {
+                .id = job.id,
+                .channel = job.channel,
+                .state = KVM_JOB_RUNNING
+            };
+            kvm_job_record(&info);
+            xSemaphoreGive(s_job_mutex);
+
+            // 发送期间提交的新请求进入等待槽，可能互相取代
+            info.result = kvm_controller_do_switch(job.channel, &stamps);
+            info.state = KVM_JOB_DONE;
+            stamps.done_us = esp_timer_get_time();
+            switch_trace_record(&stamps, info.result);
+
+            xSemaphoreTake(s_job_mutex, portMAX_DELAY);
+            kvm_job_record(&info);
+            xSemaphoreGive(s_job_mutex);
+
+            if (job.done_cb != NULL) {
+                job.done_cb(&info, job.arg);
+            }
+        }
+    }
+}
 
 /**
  * 初始化KVM控制器
@@ -52,21 +190,42 @@ esp_err_t kvm_controller_init(void)
         s_kvm_status.channels[i].channel = i + 1;
         s_kvm_status.channels[i].active = (i + 1 == KVM_CHANNEL_DEFAULT);
         s_kvm_status.channels[i].connected = true; // 假设所有通道都已连接
-        strncpy(s_kvm_status.channels[i].name, default_channel_names[i], 
-                sizeof(s_kvm_status.channels[i].name) - 1);
+        snprintf(s_kvm_status.channels[i].name, sizeof(s_kvm_status.channels[i].name),
+                 KVM_DEFAULT_CHANNEL_NAME, i + 1);
         s_kvm_status.channels[i].switch_count = 0;
         s_kvm_status.channels[i].last_switch_time = 0;
+        s_kvm_status.channels[i].changed_gen = 0;
+        atomic_init(&s_counters.channel_switches[i], 0);
     }
+    atomic_init(&s_counters.total_switches, 0);
+    atomic_init(&s_counters.error_count, 0);
+    atomic_init(&s_counters.coalesced_switches, 0);
     
+    // 创建切换工作任务
+    if (switch_trace_init() != ESP_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_job_mutex = xSemaphoreCreateMutex();
+    if (s_job_mutex == NULL) {
+        ESP_LOGE(TAG, "创建切换任务互斥锁失败");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(kvm_switch_task, "kvm_switch", KVM_SWITCH_TASK_STACK_SIZE, NULL,
+                                KVM_SWITCH_TASK_PRIORITY, &s_switch_task, KVM_SWITCH_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "创建切换工作任务失败");
+        return ESP_ERR_NO_MEM;
+    }
+
     // 简化初始化完成日志
     return ESP_OK;
 }
 
 /**
- * 切换到指定通道 (简化版)
+ * 执行通道切换 (仅在切换工作任务中调用)
  * 发送指令后立即更新状态，不等待响应
+ * @param stamps 记录获得互斥锁及UART各阶段的时间戳
  */
-esp_err_t kvm_controller_switch_channel(int channel)
+static esp_err_t kvm_controller_do_switch(int channel, switch_trace_stamps_t *stamps)
 {
     if (!kvm_controller_is_valid_channel(channel)) {
         ESP_LOGE(TAG, "Invalid channel number: %d", channel);
@@ -77,6 +236,7 @@ esp_err_t kvm_controller_switch_channel(int channel)
         ESP_LOGE(TAG, "Failed to acquire KVM mutex");
         return ESP_ERR_TIMEOUT;
     }
+    stamps->locked_us = esp_timer_get_time();
 
     ESP_LOGI(TAG, "开始切换到通道 %d (当前通道: %d)", channel, s_kvm_status.current_channel);
 
@@ -88,61 +248,249 @@ esp_err_t kvm_controller_switch_channel(int channel)
     }
 
     // 设置目标通道和状态
+    kvm_status_write_begin();
     s_kvm_status.target_channel = channel;
     s_kvm_status.switch_status = KVM_SWITCH_IN_PROGRESS;
+    kvm_status_write_end();
 
     ESP_LOGI(TAG, "调用UART发送切换命令到通道 %d", channel);
     // 通过UART发送切换命令
-    esp_err_t ret = uart_comm_switch_channel(channel);
+    uart_comm_timing_t timing = {0};
+    esp_err_t ret = uart_comm_switch_channel_timed(channel, &timing);
+    stamps->tx_start_us = timing.tx_start_us;
+    stamps->tx_done_us = timing.tx_done_us;
+    stamps->ack_us = timing.ack_us;
 
     if (ret != ESP_OK) {
         // 如果UART发送失败，记录错误并返回
+        kvm_status_write_begin();
         s_kvm_status.switch_status = KVM_SWITCH_FAILED;
-        s_kvm_status.error_count++;
         s_kvm_status.communication_ok = false;
+        kvm_status_write_end();
+        atomic_fetch_add_explicit(&s_counters.error_count, 1, memory_order_relaxed);
+        system_state_mark_changed();
+        kvm_event_switch_t event = {
+            .channel = channel,
+            .previous_channel = s_kvm_status.current_channel,
+            .result = ret
+        };
+        event_bus_post(KVM_EVENT_SWITCH_FAILED, &event, sizeof(event));
         ESP_LOGE(TAG, "Failed to send switch command to UART, error: %s", esp_err_to_name(ret));
         xSemaphoreGive(s_kvm_mutex);
         return ret;
     }
 
-    // 立即更新状态，不等待CH32V003响应
+    // CH32V003已确认切换 (原协议固件下为指令已发出)，更新状态
+    int previous_channel = s_kvm_status.current_channel;
+    kvm_status_write_begin();
     // 更新旧通道状态
-    if (s_kvm_status.current_channel >= 1 && s_kvm_status.current_channel <= KVM_CHANNEL_MAX) {
-        s_kvm_status.channels[s_kvm_status.current_channel - 1].active = false;
+    if (kvm_controller_is_valid_channel(previous_channel)) {
+        s_kvm_status.channels[previous_channel - 1].active = false;
+        s_kvm_status.channels[previous_channel - 1].changed_gen = KVM_CHANNEL_GEN_PENDING;
     }
 
     // 更新新通道状态
     s_kvm_status.current_channel = channel;
     s_kvm_status.channels[channel - 1].active = true;
-    s_kvm_status.channels[channel - 1].switch_count++;
+    s_kvm_status.channels[channel - 1].changed_gen = KVM_CHANNEL_GEN_PENDING;
     s_kvm_status.channels[channel - 1].last_switch_time = esp_timer_get_time() / 1000000;
-
-    // 更新系统统计
-    s_kvm_status.total_switches++;
     s_kvm_status.switch_status = KVM_SWITCH_SUCCESS;
     s_kvm_status.communication_ok = true;
+    kvm_status_write_end();
+
+    // 更新统计: 先加通道计数再以release加总数，读者先读总数，保证总数不超过各通道之和
+    atomic_fetch_add_explicit(&s_counters.channel_switches[channel - 1], 1, memory_order_relaxed);
+    uint32_t total = atomic_fetch_add_explicit(&s_counters.total_switches, 1, memory_order_release) + 1;
+    int changed[] = { channel, previous_channel };
+    kvm_channels_publish(changed, kvm_controller_is_valid_channel(previous_channel) ? 2 : 1);
+    kvm_event_switch_t event = {
+        .channel = channel,
+        .previous_channel = previous_channel,
+        .result = ESP_OK
+    };
+    event_bus_post(KVM_EVENT_CHANNEL_SWITCHED, &event, sizeof(event));
 
     ESP_LOGI(TAG, "✓ 通道切换完成: %d -> %d (总切换次数: %lu)", 
-             s_kvm_status.current_channel, channel, s_kvm_status.total_switches);
+             previous_channel, channel, total);
 
     xSemaphoreGive(s_kvm_mutex);
     return ESP_OK;
 }
 
+/**
+ * 提交切换请求
+ */
+esp_err_t kvm_controller_submit_switch(int channel, int64_t received_us, kvm_switch_done_cb_t done_cb, void *arg,
+                                       uint32_t *job_id)
+{
+    if (!kvm_controller_is_valid_channel(channel)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_switch_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    int64_t now = esp_timer_get_time();
+    kvm_switch_job_t job = {
+        .channel = channel,
+        .done_cb = done_cb,
+        .arg = arg,
+        .received_us = received_us != 0 ? received_us : now,
+        .submitted_us = now
+    };
+    kvm_switch_job_t superseded;
+    bool coalesced = false;
+
+    xSemaphoreTake(s_job_mutex, portMAX_DELAY);
+    job.id = s_next_job_id++;
+    if (s_pending_valid) {
+        // 后写者胜: 尚未发送的旧请求直接丢弃
+        superseded = s_pending_job;
+        coalesced = true;
+        atomic_fetch_add_explicit(&s_counters.coalesced_switches, 1, memory_order_relaxed);
+        kvm_switch_job_info_t info = {
+            .id = superseded.id,
+            .channel = superseded.channel,
+            .state = KVM_JOB_COALESCED,
+            .result = ESP_OK,
+            .superseded_by = job.id
+        };
+        kvm_job_record(&info);
+    }
+    s_pending_job = job;
+    s_pending_valid = true;
+    kvm_switch_job_info_t info = {
+        .id = job.id,
+        .channel = channel,
+        .state = KVM_JOB_QUEUED
+    };
+    kvm_job_record(&info);
+    xSemaphoreGive(s_job_mutex);
+
+    xTaskNotifyGive(s_switch_task);
+
+    if (coalesced) {
+        ESP_LOGI(TAG, "切换请求 #%lu (通道 %d) 被 #%lu (通道 %d) 取代",
+                 superseded.id, superseded.channel, job.id, channel);
+        system_state_mark_changed();
+        if (superseded.done_cb != NULL) {
+            kvm_switch_job_info_t done = {
+                .id = superseded.id,
+                .channel = superseded.channel,
+                .state = KVM_JOB_COALESCED,
+                .result = ESP_OK,
+                .superseded_by = job.id
+            };
+            superseded.done_cb(&done, superseded.arg);
+        }
+    }
+
+    if (job_id != NULL) {
+        *job_id = job.id;
+    }
+    return ESP_OK;
+}
+
+/**
+ * 同步切换的完成回调
+ */
+typedef struct {
+    SemaphoreHandle_t done;
+    esp_err_t result;
+} kvm_sync_switch_t;
+
+static void kvm_sync_switch_done(const kvm_switch_job_info_t *job, void *arg)
+{
+    kvm_sync_switch_t *sync = (kvm_sync_switch_t *)arg;
+    sync->result = job->result;
+    xSemaphoreGive(sync->done);
+}
+
+/**
+ * 切换到指定通道 (同步)
+ */
+esp_err_t kvm_controller_switch_channel(int channel)
+{
+    kvm_sync_switch_t sync = {
+        .done = xSemaphoreCreateBinary(),
+        .result = ESP_FAIL
+    };
+    if (sync.done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = kvm_controller_submit_switch(channel, 0, kvm_sync_switch_done, &sync, NULL);
+    if (ret == ESP_OK) {
+        // 工作任务一定会调用回调，sync在栈上，必须等到回调完成
+        xSemaphoreTake(sync.done, portMAX_DELAY);
+        ret = sync.result;
+    }
+
+    vSemaphoreDelete(sync.done);
+    return ret;
+}
+
+/**
+ * 查询切换任务状态
+ */
+esp_err_t kvm_controller_get_switch_job(uint32_t job_id, kvm_switch_job_info_t *info)
+{
+    if (info == NULL || s_job_mutex == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    xSemaphoreTake(s_job_mutex, portMAX_DELAY);
+    const kvm_switch_job_info_t *entry = &s_job_history[job_id % KVM_SWITCH_JOB_HISTORY];
+    if (job_id != 0 && entry->id == job_id) {
+        *info = *entry;
+        ret = ESP_OK;
+    }
+    xSemaphoreGive(s_job_mutex);
+    return ret;
+}
+
 /**
  * 获取当前活跃通道
  */
 int kvm_controller_get_current_channel(void)
 {
-    return s_kvm_status.current_channel;
+    int channel;
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_status_seq);
+        channel = s_kvm_status.current_channel;
+    } while (seqlock_read_retry(&s_status_seq, seq));
+    return channel;
+}
+
+/**
+ * 获取KVM系统状态的一致快照
+ */
+void kvm_controller_get_status_snapshot(kvm_status_t *out)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_status_seq);
+        *out = s_kvm_status;
+    } while (seqlock_read_retry(&s_status_seq, seq));
+
+    kvm_controller_get_counters(out);
 }
 
 /**
- * 获取KVM系统状态
+ * 读取切换统计计数器
  */
-const kvm_status_t* kvm_controller_get_status(void)
+void kvm_controller_get_counters(kvm_status_t *out)
 {
-    return &s_kvm_status;
+    // 先读总数(acquire)，再读各通道计数
+    out->total_switches = atomic_load_explicit(&s_counters.total_switches, memory_order_acquire);
+    out->error_count = atomic_load_explicit(&s_counters.error_count, memory_order_relaxed);
+    out->coalesced_switches = atomic_load_explicit(&s_counters.coalesced_switches, memory_order_relaxed);
+    for (int i = 0; i < KVM_CHANNEL_MAX; i++) {
+        out->channels[i].switch_count = atomic_load_explicit(&s_counters.channel_switches[i],
+                                                             memory_order_relaxed);
+    }
 }
 
 /**
@@ -166,26 +514,94 @@ esp_err_t kvm_controller_set_channel_name(int channel, const char *name)
         return ESP_ERR_TIMEOUT;
     }
     
+    kvm_status_write_begin();
     strncpy(s_kvm_status.channels[channel - 1].name, name, 
             sizeof(s_kvm_status.channels[channel - 1].name) - 1);
     s_kvm_status.channels[channel - 1].name[sizeof(s_kvm_status.channels[channel - 1].name) - 1] = '\0';
+    s_kvm_status.channels[channel - 1].changed_gen = KVM_CHANNEL_GEN_PENDING;
+    kvm_status_write_end();
+    kvm_channels_publish(&channel, 1);
     
     xSemaphoreGive(s_kvm_mutex);
     
-    // 通道名称已更新
+    // 同步到CH32V003 (原协议固件不支持，只保留本地名称)
+    esp_err_t ret = uart_comm_set_channel_name(channel, name);
+    if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "通道%d名称未能同步到CH32V003: %s", channel, esp_err_to_name(ret));
+    }
     return ESP_OK;
 }
 
 /**
- * 获取通道信息
+ * 以CH32V003的当前通道校正本地状态
  */
-const kvm_channel_info_t* kvm_controller_get_channel_info(int channel)
+esp_err_t kvm_controller_sync_channel(void)
 {
+    if (xSemaphoreTake(s_kvm_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    // 持有互斥锁查询，避免与切换交错
+    int channel = 0;
+    esp_err_t ret = uart_comm_query_channel(&channel);
+    if (ret != ESP_OK) {
+        xSemaphoreGive(s_kvm_mutex);
+        return ret;
+    }
     if (!kvm_controller_is_valid_channel(channel)) {
-        return NULL;
+        xSemaphoreGive(s_kvm_mutex);
+        ESP_LOGW(TAG, "CH32V003报告的通道%d无效", channel);
+        return ESP_ERR_INVALID_RESPONSE;
     }
-    
-    return &s_kvm_status.channels[channel - 1];
+
+    int previous_channel = s_kvm_status.current_channel;
+    if (channel == previous_channel) {
+        xSemaphoreGive(s_kvm_mutex);
+        return ESP_OK;
+    }
+
+    kvm_status_write_begin();
+    if (kvm_controller_is_valid_channel(previous_channel)) {
+        s_kvm_status.channels[previous_channel - 1].active = false;
+        s_kvm_status.channels[previous_channel - 1].changed_gen = KVM_CHANNEL_GEN_PENDING;
+    }
+    s_kvm_status.current_channel = channel;
+    s_kvm_status.target_channel = channel;
+    s_kvm_status.channels[channel - 1].active = true;
+    s_kvm_status.channels[channel - 1].changed_gen = KVM_CHANNEL_GEN_PENDING;
+    s_kvm_status.communication_ok = true;
+    kvm_status_write_end();
+
+    int changed[] = { channel, previous_channel };
+    kvm_channels_publish(changed, kvm_controller_is_valid_channel(previous_channel) ? 2 : 1);
+    kvm_event_switch_t event = {
+        .channel = channel,
+        .previous_channel = previous_channel,
+        .result = ESP_OK
+    };
+    event_bus_post(KVM_EVENT_CHANNEL_SWITCHED, &event, sizeof(event));
+
+    ESP_LOGW(TAG, "CH32V003当前通道为%d，与本地记录的%d不一致，已同步", channel, previous_channel);
+    xSemaphoreGive(s_kvm_mutex);
+    return ESP_OK;
+}
+
+/**
+ * 获取通道信息的一致快照
+ */
+esp_err_t kvm_controller_get_channel_snapshot(int channel, kvm_channel_info_t *out)
+{
+    if (!kvm_controller_is_valid_channel(channel) || out == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_status_seq);
+        *out = s_kvm_status.channels[channel - 1];
+    } while (seqlock_read_retry(&s_status_seq, seq));
+    out->switch_count = atomic_load_explicit(&s_counters.channel_switches[channel - 1], memory_order_relaxed);
+    return ESP_OK;
 }
 
 /**
@@ -197,7 +613,13 @@ bool kvm_controller_is_channel_connected(int channel)
         return false;
     }
     
-    return s_kvm_status.channels[channel - 1].connected;
+    bool connected;
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_status_seq);
+        connected = s_kvm_status.channels[channel - 1].connected;
+    } while (seqlock_read_retry(&s_status_seq, seq));
+    return connected;
 }
 
 /**
@@ -205,7 +627,13 @@ bool kvm_controller_is_channel_connected(int channel)
  */
 kvm_switch_status_t kvm_controller_get_switch_status(void)
 {
-    return s_kvm_status.switch_status;
+    kvm_switch_status_t status;
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_status_seq);
+        status = s_kvm_status.switch_status;
+    } while (seqlock_read_retry(&s_status_seq, seq));
+    return status;
 }
 
 /**
@@ -213,68 +641,6 @@ kvm_switch_status_t kvm_controller_get_switch_status(void)
  */
 void kvm_controller_reset_error_count(void)
 {
-    if (xSemaphoreTake(s_kvm_mutex, pdMS_TO_TICKS(1000)) == pdTRUE) {
-        s_kvm_status.error_count = 0;
-        xSemaphoreGive(s_kvm_mutex);
-        // 错误计数已重置
-    }
-}
-
-/**
- * 获取统计信息JSON字符串
- */
-esp_err_t kvm_controller_get_stats_json(char *buffer, size_t buffer_size)
-{
-    if (buffer == NULL || buffer_size == 0) {
-        return ESP_ERR_INVALID_ARG;
-    }
-    
-    cJSON *json = cJSON_CreateObject();
-    
-    cJSON_AddNumberToObject(json, "current_channel", s_kvm_status.current_channel);
-    cJSON_AddNumberToObject(json, "total_switches", s_kvm_status.total_switches);
-    cJSON_AddNumberToObject(json, "error_count", s_kvm_status.error_count);
-    cJSON_AddBoolToObject(json, "communication_ok", s_kvm_status.communication_ok);
-    
-    // 计算成功率
-    float success_rate = 100.0f;
-    if (s_kvm_status.total_switches > 0) {
-        success_rate = ((float)(s_kvm_status.total_switches - s_kvm_status.error_count) / 
-                       s_kvm_status.total_switches) * 100.0f;
-    }
-    cJSON_AddNumberToObject(json, "success_rate", success_rate);
-    
-    // 添加通道信息
-    cJSON *channels = cJSON_CreateArray();
-    for (int i = 0; i < KVM_CHANNEL_MAX; i++) {
-        cJSON *channel = cJSON_CreateObject();
-        cJSON_AddNumberToObject(channel, "channel", s_kvm_status.channels[i].channel);
-        cJSON_AddBoolToObject(channel, "active", s_kvm_status.channels[i].active);
-        cJSON_AddBoolToObject(channel, "connected", s_kvm_status.channels[i].connected);
-        cJSON_AddStringToObject(channel, "name", s_kvm_status.channels[i].name);
-        cJSON_AddNumberToObject(channel, "switch_count", s_kvm_status.channels[i].switch_count);
-        cJSON_AddNumberToObject(channel, "last_switch_time", s_kvm_status.channels[i].last_switch_time);
-        cJSON_AddItemToArray(channels, channel);
-    }
-    cJSON_AddItemToObject(json, "channels", channels);
-    
-    char *json_string = cJSON_Print(json);
-    if (json_string == NULL) {
-        cJSON_Delete(json);
-        return ESP_FAIL;
-    }
-    
-    size_t json_len = strlen(json_string);
-    if (json_len >= buffer_size) {
-        free(json_string);
-        cJSON_Delete(json);
-        return ESP_ERR_NO_MEM;
-    }
-    
-    strcpy(buffer, json_string);
-    
-    free(json_string);
-    cJSON_Delete(json);
-    
-    return ESP_OK;
+    atomic_store_explicit(&s_counters.error_count, 0, memory_order_relaxed);
+    system_state_mark_changed();
 }
@@ -19,13 +19,13 @@
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include "driver/gpio.h"
-#include "cJSON.h"
 
 #include "wifi_manager.h"
 #include "web_server.h"
 #include "kvm_controller.h"
 #include "uart_comm.h"
 #include "driver/uart.h"
+#include "event_bus.h"
 
 static const char *TAG = "KVM_MAIN";
 
@@ -43,6 +43,10 @@ static int uart1_vprintf(const char *format, va_list args) {
 #define STATUS_LED_GPIO     GPIO_NUM_2
 #define LED_ON              1
 #define LED_OFF             0
+#define LED_BLINK_FAST_MS   500     // 快闪：未连接WiFi
+#define LED_BLINK_SLOW_MS   2000    // 慢闪：已连接WiFi
+
+static TaskHandle_t s_led_task = NULL;
 
 /**
  * 初始化状态LED
@@ -62,75 +66,61 @@ static void init_status_led(void)
 
 /**
  * 状态LED闪烁任务
+ * 闪烁周期通过任务通知值更新，收到通知时立即按新周期闪烁
  */
 static void status_led_task(void *pvParameters)
 {
     bool led_state = false;
+    uint32_t period_ms = LED_BLINK_FAST_MS;
     
     while (1) {
         led_state = !led_state;
         gpio_set_level(STATUS_LED_GPIO, led_state ? LED_ON : LED_OFF);
         
-        // 根据系统状态调整闪烁频率
-        if (wifi_manager_is_connected()) {
-            vTaskDelay(pdMS_TO_TICKS(2000)); // 慢闪：已连接WiFi
-        } else {
-            vTaskDelay(pdMS_TO_TICKS(500));  // 快闪：未连接WiFi
+        // 超时返回时通知值同样会被写出，只在收到通知时更新周期
+        uint32_t notified_ms = 0;
+        if (xTaskNotifyWait(0, 0, &notified_ms, pdMS_TO_TICKS(period_ms)) == pdTRUE && notified_ms > 0) {
+            period_ms = notified_ms;
         }
     }
 }
 
 /**
- * 系统监控任务
+ * WiFi链路事件: 根据连接状态调整LED闪烁频率
  */
-static void system_monitor_task(void *pvParameters)
+static void status_led_on_event(void *arg, esp_event_base_t base, int32_t id, void *data)
 {
-    while (1) {
-        // 只保留内存监控，删除其他调试信息
-        if (esp_get_free_heap_size() < 50000) {
-            ESP_LOGW(TAG, "警告: 可用内存不足!");
-        }
+    uint32_t period_ms = id == KVM_EVENT_WIFI_GOT_IP ? LED_BLINK_SLOW_MS : LED_BLINK_FAST_MS;
+    xTaskNotify(s_led_task, period_ms, eSetValueWithOverwrite);
+}
 
-        vTaskDelay(pdMS_TO_TICKS(30000)); // 每30秒监控一次
+/**
+ * CH32V003链路任务: 协商波特率后同步当前通道，完成后退出
+ * 在后台执行，协商期间链路保持默认速率，不阻塞启动
+ */
+static void uart_link_task(void *pvParameters)
+{
+    if (uart_comm_negotiate_baud() == ESP_OK) {
+        esp_err_t ret = kvm_controller_sync_channel();
+        if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+            ESP_LOGW(TAG, "同步CH32V003当前通道失败: %s", esp_err_to_name(ret));
+        }
     }
+    vTaskDelete(NULL);
 }
 
 /**
- * WebSocket状态推送任务
+ * 系统监控任务
  */
-static void websocket_status_task(void *pvParameters)
+static void system_monitor_task(void *pvParameters)
 {
     while (1) {
-        // 构建状态更新消息
-        cJSON *json = cJSON_CreateObject();
-        cJSON *data = cJSON_CreateObject();
-
-        // 获取KVM状态
-        const kvm_status_t *kvm_status = kvm_controller_get_status();
-        cJSON_AddNumberToObject(data, "current_channel", kvm_status->current_channel);
-
-        // 获取WiFi状态
-        const wifi_status_t *wifi_status = wifi_manager_get_status();
-        cJSON *wifi_obj = cJSON_CreateObject();
-        cJSON_AddBoolToObject(wifi_obj, "connected", wifi_status->sta_connected);
-        cJSON_AddStringToObject(wifi_obj, "ssid", wifi_status->sta_ssid);
-        cJSON_AddStringToObject(wifi_obj, "ip", wifi_status->sta_ip);
-        cJSON_AddNumberToObject(wifi_obj, "rssi", wifi_status->sta_rssi);
-        cJSON_AddItemToObject(data, "wifi_status", wifi_obj);
-
-        // 构建WebSocket消息
-        cJSON_AddStringToObject(json, "type", "status_update");
-        cJSON_AddItemToObject(json, "data", data);
-
-        char *json_string = cJSON_Print(json);
-        if (json_string) {
-            web_server_broadcast_ws_message(json_string);
-            free(json_string);
+        // 只保留内存监控，删除其他调试信息
+        if (esp_get_free_heap_size() < 50000) {
+            ESP_LOGW(TAG, "警告: 可用内存不足!");
         }
 
-        cJSON_Delete(json);
-
-        vTaskDelay(pdMS_TO_TICKS(5000)); // 每5秒推送一次状态
+        vTaskDelay(pdMS_TO_TICKS(30000)); // 每30秒监控一次
     }
 }
 
@@ -153,8 +143,14 @@ void app_main(void)
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
 
-    // 初始化状态LED
+    // 初始化事件总线 (在发布事件的模块之前)
+    ESP_ERROR_CHECK(event_bus_init());
+
+    // 初始化状态LED，订阅WiFi链路事件
     init_status_led();
+    xTaskCreate(status_led_task, "status_led", 2048, NULL, 5, &s_led_task);
+    event_bus_subscribe(KVM_EVENT_WIFI_GOT_IP, status_led_on_event, NULL, NULL);
+    event_bus_subscribe(KVM_EVENT_WIFI_LINK_DOWN, status_led_on_event, NULL, NULL);
     
     // 配置调试日志输出到GPIO17/18 (UART1)
     uart_config_t uart_config = {
@@ -180,7 +176,7 @@ void app_main(void)
     // 初始化KVM控制器
     kvm_controller_init();
 
-    // 初始化WiFi管理器
+    // 初始化WiFi管理器 (不等待STA连接，AP立即可用，Web服务器随即启动)
     wifi_manager_init();
 
     // 启动Web服务器
@@ -189,14 +185,11 @@ void app_main(void)
         ESP_LOGE(TAG, "Web服务器启动失败: %s", esp_err_to_name(web_ret));
     }
     
-    // 创建状态LED任务
-    xTaskCreate(status_led_task, "status_led", 2048, NULL, 5, NULL);
+    // 在后台与CH32V003协商波特率并同步当前通道 (对端无应答时保持默认速率)
+    xTaskCreate(uart_link_task, "uart_link", 3072, NULL, 4, NULL);
 
     // 创建系统监控任务
     xTaskCreate(system_monitor_task, "sys_monitor", 4096, NULL, 3, NULL);
-
-    // WebSocket功能已禁用，不创建状态推送任务
-    // xTaskCreate(websocket_status_task, "ws_status", 4096, NULL, 4, NULL);
     
     // 主循环
     while (1) {
@@ -0,0 +1,37 @@
+/**
+ * 响应缓存实现
+ * 功能: 按状态代数缓存序列化后的API响应
+ */
+
+#include "response_cache.h"
+
+/**
+ * 检查缓存是否对应指定的状态代数
+ */
+bool response_cache_is_fresh(const response_cache_t *cache, uint32_t generation)
+{
+    return cache->valid && cache->generation == generation;
+}
+
+/**
+ * 提交缓存内容
+ */
+void response_cache_commit(response_cache_t *cache, uint32_t generation, size_t len)
+{
+    if (len > cache->capacity) {
+        cache->valid = false;
+        return;
+    }
+    cache->len = len;
+    cache->generation = generation;
+    cache->valid = true;
+}
+
+/**
+ * 使缓存失效
+ */
+void response_cache_invalidate(response_cache_t *cache)
+{
+    cache->valid = false;
+    cache->len = 0;
+}
@@ -0,0 +1,211 @@
+/**
+ * 通道切换延迟追踪实现
+ * 功能: 按阶段统计切换耗时 (对数分桶直方图) 并保存最近的切换记录
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+
+#include "switch_trace.h"
+
+static const char *TAG = "SWITCH_TRACE";
+
+// 单个阶段的耗时分布
+typedef struct {
+    uint32_t count;
+    uint32_t max_us;
+    uint64_t sum_us;
+    uint32_t buckets[SWITCH_TRACE_BUCKETS + 1];     // 最后一个为溢出桶
+} phase_hist_t;
+
+// 一次切换的记录
+typedef struct {
+    uint32_t job_id;
+    int channel;
+    esp_err_t result;
+    uint32_t done_ms;                               // 完成时间 (开机后毫秒)
+    int32_t phase_us[SWITCH_PHASE_MAX];             // -1表示该阶段未发生
+} switch_trace_entry_t;
+
+typedef struct {
+    phase_hist_t phases[SWITCH_PHASE_MAX];
+    switch_trace_entry_t recent[SWITCH_TRACE_HISTORY];
+    uint32_t recorded;                              // 累计记录数，recent按其取模写入
+} switch_trace_data_t;
+
+static const char *const PHASE_NAMES[SWITCH_PHASE_MAX] = {
+    [SWITCH_PHASE_HTTP]      = "http",
+    [SWITCH_PHASE_QUEUE]     = "queue",
+    [SWITCH_PHASE_MUTEX]     = "mutex",
+    [SWITCH_PHASE_UART_WAIT] = "uart_wait",
+    [SWITCH_PHASE_TX]        = "tx",
+    [SWITCH_PHASE_ACK]       = "ack",
+    [SWITCH_PHASE_TOTAL]     = "total",
+};
+
+static switch_trace_data_t s_data;
+static SemaphoreHandle_t s_trace_mutex = NULL;
+
+/**
+ * 初始化切换追踪
+ */
+esp_err_t switch_trace_init(void)
+{
+    if (s_trace_mutex != NULL) {
+        return ESP_OK;
+    }
+    s_trace_mutex = xSemaphoreCreateMutex();
+    if (s_trace_mutex == NULL) {
+        ESP_LOGE(TAG, "创建互斥锁失败");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+/**
+ * 两个时间戳之间的耗时，任一未发生时返回-1
+ */
+static int32_t phase_duration(int64_t start_us, int64_t end_us)
+{
+    if (start_us == 0 || end_us == 0 || end_us < start_us) {
+        return -1;
+    }
+    int64_t delta = end_us - start_us;
+    return delta > INT32_MAX ? INT32_MAX : (int32_t)delta;
+}
+
+/**
+ * 耗时所在的直方图桶，超出最大桶时返回溢出桶SWITCH_TRACE_BUCKETS
+ */
+static int phase_bucket(uint32_t duration_us)
+{
+    if (duration_us <= (1u << SWITCH_TRACE_MIN_BUCKET_SHIFT)) {
+        return 0;
+    }
+    int bucket = 32 - __builtin_clz(duration_us - 1) - SWITCH_TRACE_MIN_BUCKET_SHIFT;
+    return bucket < SWITCH_TRACE_BUCKETS ? bucket : SWITCH_TRACE_BUCKETS;
+}
+
+/**
+ * 记录一次已执行的切换
+ */
+void switch_trace_record(const switch_trace_stamps_t *stamps, esp_err_t result)
+{
+    if (s_trace_mutex == NULL || stamps == NULL) {
+        return;
+    }
+
+    switch_trace_entry_t entry = {
+        .job_id = stamps->job_id,
+        .channel = stamps->channel,
+        .result = result,
+        .done_ms = stamps->done_us / 1000,
+    };
+    entry.phase_us[SWITCH_PHASE_HTTP] = phase_duration(stamps->received_us, stamps->submitted_us);
+    entry.phase_us[SWITCH_PHASE_QUEUE] = phase_duration(stamps->submitted_us, stamps->dequeued_us);
+    entry.phase_us[SWITCH_PHASE_MUTEX] = phase_duration(stamps->dequeued_us, stamps->locked_us);
+    entry.phase_us[SWITCH_PHASE_UART_WAIT] = phase_duration(stamps->locked_us, stamps->tx_start_us);
+    entry.phase_us[SWITCH_PHASE_TX] = phase_duration(stamps->tx_start_us, stamps->tx_done_us);
+    entry.phase_us[SWITCH_PHASE_ACK] = phase_duration(stamps->tx_done_us, stamps->ack_us);
+    entry.phase_us[SWITCH_PHASE_TOTAL] = phase_duration(stamps->received_us, stamps->done_us);
+
+    xSemaphoreTake(s_trace_mutex, portMAX_DELAY);
+    for (int i = 0; i < SWITCH_PHASE_MAX; i++) {
+        if (entry.phase_us[i] < 0) {
+            continue;
+        }
+        phase_hist_t *hist = &s_data.phases[i];
+        uint32_t duration = entry.phase_us[i];
+        hist->count++;
+        hist->sum_us += duration;
+        hist->max_us = duration > hist->max_us ? duration : hist->max_us;
+        hist->buckets[phase_bucket(duration)]++;
+    }
+    s_data.recent[s_data.recorded % SWITCH_TRACE_HISTORY] = entry;
+    s_data.recorded++;
+    xSemaphoreGive(s_trace_mutex);
+}
+
+/**
+ * 按直方图估计分位数 (取所在桶的上限，落在溢出桶时取最大值)
+ */
+static uint32_t phase_percentile(const phase_hist_t *hist, uint32_t permille)
+{
+    if (hist->count == 0) {
+        return 0;
+    }
+    uint64_t rank = ((uint64_t)hist->count * permille + 999) / 1000;
+    uint32_t cumulative = 0;
+    for (int b = 0; b < SWITCH_TRACE_BUCKETS; b++) {
+        cumulative += hist->buckets[b];
+        if (cumulative >= rank) {
+            uint32_t bound = 1u << (b + SWITCH_TRACE_MIN_BUCKET_SHIFT);
+            return bound < hist->max_us ? bound : hist->max_us;
+        }
+    }
+    return hist->max_us;
+}
+
+/**
+ * 写入追踪数据
+ */
+void switch_trace_write_json(json_writer_t *w)
+{
+    // 在锁内复制快照，流式发送期间不阻塞切换任务 (调用者只有httpd任务，静态分配避免占用栈)
+    static switch_trace_data_t snapshot;
+    if (s_trace_mutex == NULL) {
+        memset(&snapshot, 0, sizeof(snapshot));
+    } else {
+        xSemaphoreTake(s_trace_mutex, portMAX_DELAY);
+        snapshot = s_data;
+        xSemaphoreGive(s_trace_mutex);
+    }
+
+    json_writer_begin_array(w, "bucket_bounds_us");
+    for (int b = 0; b < SWITCH_TRACE_BUCKETS; b++) {
+        json_writer_add_uint(w, NULL, 1u << (b + SWITCH_TRACE_MIN_BUCKET_SHIFT));
+    }
+    json_writer_end_array(w);
+
+    json_writer_begin_object(w, "phases");
+    for (int i = 0; i < SWITCH_PHASE_MAX; i++) {
+        const phase_hist_t *hist = &snapshot.phases[i];
+        json_writer_begin_object(w, PHASE_NAMES[i]);
+        json_writer_add_uint(w, "count", hist->count);
+        json_writer_add_uint(w, "mean_us", hist->count > 0 ? hist->sum_us / hist->count : 0);
+        json_writer_add_uint(w, "p50_us", phase_percentile(hist, 500));
+        json_writer_add_uint(w, "p95_us", phase_percentile(hist, 950));
+        json_writer_add_uint(w, "p99_us", phase_percentile(hist, 990));
+        json_writer_add_uint(w, "max_us", hist->max_us);
+        json_writer_begin_array(w, "buckets");      // 与bucket_bounds_us对应，最后一个为溢出桶
+        for (int b = 0; b <= SWITCH_TRACE_BUCKETS; b++) {
+            json_writer_add_uint(w, NULL, hist->buckets[b]);
+        }
+        json_writer_end_array(w);
+        json_writer_end_object(w);
+    }
+    json_writer_end_object(w);
+
+    // 最近的切换，新的在前
+    json_writer_begin_array(w, "recent");
+    uint32_t count = snapshot.recorded < SWITCH_TRACE_HISTORY ? snapshot.recorded : SWITCH_TRACE_HISTORY;
+    for (uint32_t n = 0; n < count; n++) {
+        const switch_trace_entry_t *entry = &snapshot.recent[(snapshot.recorded - 1 - n) % SWITCH_TRACE_HISTORY];
+        json_writer_begin_object(w, NULL);
+        json_writer_add_uint(w, "job_id", entry->job_id);
+        json_writer_add_int(w, "channel", entry->channel);
+        json_writer_add_string(w, "result", esp_err_to_name(entry->result));
+        json_writer_add_uint(w, "done_ms", entry->done_ms);
+        json_writer_begin_object(w, "phases_us");
+        for (int i = 0; i < SWITCH_PHASE_MAX; i++) {
+            if (entry->phase_us[i] >= 0) {
+                json_writer_add_int(w, PHASE_NAMES[i], entry->phase_us[i]);
+            }
+        }
+        json_writer_end_object(w);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+}
@@ -0,0 +1,56 @@
+/**
+ * 系统状态版本号实现
+ * 功能: 全局单调递增的状态代数(generation)
+ */
+
+#include <stdatomic.h>
+#include <stddef.h>
+
+#include "system_state.h"
+
+// 从1开始，0保留给"尚未缓存"
+static atomic_uint_fast32_t s_generation = 1;
+
+// 变化监听器 (初始化阶段注册，之后只读)
+static struct {
+    system_state_listener_t fn;
+    void *arg;
+} s_listeners[SYSTEM_STATE_MAX_LISTENERS];
+static atomic_int s_listener_count = 0;
+
+/**
+ * 获取当前状态代数
+ */
+uint32_t system_state_get_generation(void)
+{
+    return (uint32_t)atomic_load_explicit(&s_generation, memory_order_acquire);
+}
+
+/**
+ * 标记系统状态已变化
+ */
+uint32_t system_state_mark_changed(void)
+{
+    uint32_t generation = (uint32_t)atomic_fetch_add_explicit(&s_generation, 1, memory_order_acq_rel) + 1;
+
+    int count = atomic_load_explicit(&s_listener_count, memory_order_acquire);
+    for (int i = 0; i < count; i++) {
+        s_listeners[i].fn(generation, s_listeners[i].arg);
+    }
+    return generation;
+}
+
+/**
+ * 注册状态变化监听器
+ */
+int system_state_add_listener(system_state_listener_t listener, void *arg)
+{
+    int index = atomic_load_explicit(&s_listener_count, memory_order_relaxed);
+    if (listener == NULL || index >= SYSTEM_STATE_MAX_LISTENERS) {
+        return -1;
+    }
+    s_listeners[index].fn = listener;
+    s_listeners[index].arg = arg;
+    atomic_store_explicit(&s_listener_count, index + 1, memory_order_release);
+    return 0;
+}
@@ -1,21 +1,455 @@
 /**
  * UART通信实现
- * 功能: 向CH32V003发送固定的KVM切换指令
+ * 功能: 与CH32V003的帧传输层
+ *   - 事件驱动接收并校验应答帧
+ *   - 每帧携带序号，最多UART_TX_WINDOW条指令同时在途
+ *   - 按序号匹配应答，超时按测得的往返时间自适应重传
  */
 
+#include <stdatomic.h>
+#include <stdint.h>
 #include <string.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 #include "driver/uart.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
 
 #include "uart_comm.h"
+#include "kvm_controller.h"
+#include "system_state.h"
+#include "event_bus.h"
 
 static const char *TAG = "UART_COMM";
 
-// UART互斥锁
+// UART互斥锁 (保护在途窗口和发送)
 static SemaphoreHandle_t uart_mutex = NULL;
 
+// 接收事件队列与接收任务
+static QueueHandle_t s_uart_queue = NULL;
+
+// 在途指令
+typedef struct {
+    bool in_use;
+    uint8_t seq;
+    uint8_t retries;
+    uint8_t max_retries;
+    uint8_t frame[UART_FRAME_SIZE];
+    int64_t sent_us;            // 最近一次发送时间
+    int64_t deadline_us;        // 超时重传时间
+    uart_comm_done_cb_t done_cb;
+    void *arg;
+} uart_inflight_t;
+
+static uart_inflight_t s_inflight[UART_TX_WINDOW];
+static SemaphoreHandle_t s_window_sem = NULL;   // 空闲窗口计数
+static uint8_t s_next_seq = 1;
+static atomic_bool s_peer_sequenced;            // 对端应答回显过非0序号
+
+// 当前波特率与连续超时计数 (用于高速率下出错时回退)
+static uint32_t s_baud_rate = UART_BAUD_RATE;
+static int s_consecutive_timeouts = 0;
+
+// 往返时间估计 (微秒，受uart_mutex保护)
+static int64_t s_srtt_us = 0;
+static int64_t s_rttvar_us = 0;
+static int64_t s_rto_us = UART_RTO_INITIAL_MS * 1000;
+
+// 通信状态: 由接收任务和多个发送方更新，均为原子变量，读者通过快照接口获取
+typedef struct {
+    atomic_bool connected;
+    atomic_uint_least32_t tx_count;
+    atomic_uint_least32_t rx_count;
+    atomic_uint_least32_t error_count;
+    atomic_uint_least32_t timeout_count;
+    atomic_uint_least32_t retransmit_count;
+    atomic_uint_least32_t srtt_ms;
+    atomic_uint_least32_t rto_ms;
+    atomic_uint_least32_t baud_rate;
+    atomic_uint_least64_t last_response_time;
+} uart_status_counters_t;
+
+static uart_status_counters_t s_status;
+
+// 接收帧组装 (仅接收任务访问)
+static uint8_t s_rx_frame[UART_FRAME_SIZE];
+static size_t s_rx_len = 0;
+
+/**
+ * 计算帧校验和
+ */
+uint8_t uart_comm_frame_checksum(const uint8_t *frame)
+{
+    uint8_t checksum = 0;
+    for (int i = 0; i < UART_FRAME_CHECKSUM_IDX; i++) {
+        if (i != 2) {   // 数据长度字节不参与校验
+            checksum ^= frame[i];
+        }
+    }
+    return checksum;
+}
+
+/**
+ * 更新链路状态，变化时递增系统状态代数并发布链路事件
+ */
+static void uart_set_connected(bool connected)
+{
+    if (atomic_exchange_explicit(&s_status.connected, connected, memory_order_relaxed) != connected) {
+        ESP_LOGI(TAG, "CH32V003链路%s", connected ? "已连接" : "无应答");
+        event_bus_post(connected ? KVM_EVENT_UART_LINK_UP : KVM_EVENT_UART_LINK_DOWN, NULL, 0);
+    }
+    system_state_mark_changed();
+}
+
+/**
+ * 记录一次接收错误 (仅接收任务调用)
+ */
+static void uart_note_rx_error(kvm_uart_error_t kind)
+{
+    uint32_t error_count = atomic_fetch_add_explicit(&s_status.error_count, 1, memory_order_relaxed) + 1;
+    system_state_mark_changed();
+    kvm_event_uart_error_t event = {
+        .kind = kind,
+        .error_count = error_count
+    };
+    event_bus_post(KVM_EVENT_UART_ERROR, &event, sizeof(event));
+}
+
+/**
+ * 更新往返时间估计 (调用者持有uart_mutex)
+ * 与TCP相同 (RFC 6298): SRTT/RTTVAR平滑，RTO = SRTT + 4*RTTVAR
+ */
+static void uart_rtt_sample(int64_t rtt_us)
+{
+    if (s_srtt_us == 0) {
+        s_srtt_us = rtt_us;
+        s_rttvar_us = rtt_us / 2;
+    } else {
+        int64_t delta = s_srtt_us - rtt_us;
+        s_rttvar_us = (3 * s_rttvar_us + (delta < 0 ? -delta : delta)) / 4;
+        s_srtt_us = (7 * s_srtt_us + rtt_us) / 8;
+    }
+
+    s_rto_us = s_srtt_us + MAX(4 * s_rttvar_us, UART_FRAME_TIME_MS * 1000);
+    s_rto_us = MAX(s_rto_us, UART_RTO_MIN_MS * 1000);
+    s_rto_us = MIN(s_rto_us, UART_RTO_MAX_MS * 1000);
+
+    atomic_store_explicit(&s_status.srtt_ms, s_srtt_us / 1000, memory_order_relaxed);
+    atomic_store_explicit(&s_status.rto_ms, s_rto_us / 1000, memory_order_relaxed);
+}
+
+/**
+ * 唤醒接收任务重新计算重传时间
+ */
+static void uart_wake_rx_task(void)
+{
+    uart_event_t wake = { .type = UART_EVENT_MAX };
+    xQueueSend(s_uart_queue, &wake, 0);
+}
+
+/**
+ * 处理一帧完整且校验通过的应答
+ * 非0序号的应答须与在途指令的序号和指令都一致；序号为0的应答 (不回显序号的旧固件)
+ * 只匹配按原协议发出 (序号为0) 的最早的切换指令，查询、波特率等扩展指令
+ * 只有在对端回显序号时才视为成功。第一次收到回显的非0序号时确认对端支持扩展协议
+ */
+static void uart_handle_frame(const uint8_t *frame)
+{
+    atomic_fetch_add_explicit(&s_status.rx_count, 1, memory_order_relaxed);
+    atomic_store_explicit(&s_status.last_response_time, esp_timer_get_time() / 1000, memory_order_relaxed);
+    s_consecutive_timeouts = 0;
+
+    uint8_t seq = frame[UART_FRAME_SEQ_IDX];
+    uint8_t cmd = frame[UART_FRAME_CMD_IDX];
+    uart_inflight_t done = { .in_use = false };
+
+    xSemaphoreTake(uart_mutex, portMAX_DELAY);
+    uart_inflight_t *match = NULL;
+    for (int i = 0; i < UART_TX_WINDOW; i++) {
+        uart_inflight_t *slot = &s_inflight[i];
+        if (!slot->in_use) {
+            continue;
+        }
+        uint8_t sent_seq = slot->frame[UART_FRAME_SEQ_IDX];
+        if (seq != 0) {
+            if (sent_seq == seq && slot->frame[UART_FRAME_CMD_IDX] == cmd) {
+                match = slot;
+                break;
+            }
+        } else if (sent_seq == 0 && (match == NULL || (int8_t)(slot->seq - match->seq) < 0)) {
+            match = slot;
+        }
+    }
+    bool first_sequenced = false;
+    if (match != NULL) {
+        if (seq != 0) {
+            first_sequenced = !atomic_exchange_explicit(&s_peer_sequenced, true, memory_order_relaxed);
+        }
+        // Karn算法: 重传过的指令无法区分应答对应哪次发送，不采样
+        if (match->retries == 0) {
+            uart_rtt_sample(esp_timer_get_time() - match->sent_us);
+        }
+        done = *match;
+        match->in_use = false;
+    }
+    xSemaphoreGive(uart_mutex);
+
+    if (first_sequenced) {
+        ESP_LOGI(TAG, "CH32V003回显序号，启用扩展协议");
+    }
+    uart_set_connected(true);
+
+    if (!done.in_use) {
+        ESP_LOGD(TAG, "收到无匹配的应答 seq=%d", seq);
+        return;
+    }
+    xSemaphoreGive(s_window_sem);
+
+    if (done.done_cb != NULL) {
+        esp_err_t result = frame[1] == UART_FRAME_STATUS_OK ? ESP_OK : ESP_FAIL;
+        done.done_cb(result, frame, done.arg);
+    }
+}
+
+/**
+ * 切换本端波特率并重置往返时间估计
+ */
+static void uart_apply_baud_rate(uint32_t baud_rate)
+{
+    // 先发完缓冲区中按旧速率编码的数据
+    uart_wait_tx_done(UART_PORT_NUM, pdMS_TO_TICKS(UART_FRAME_TIME_MS * 2));
+    uart_set_baudrate(UART_PORT_NUM, baud_rate);
+
+    xSemaphoreTake(uart_mutex, portMAX_DELAY);
+    s_baud_rate = baud_rate;
+    s_srtt_us = 0;
+    s_rttvar_us = 0;
+    s_rto_us = UART_RTO_INITIAL_MS * 1000;
+    atomic_store_explicit(&s_status.baud_rate, baud_rate, memory_order_relaxed);
+    atomic_store_explicit(&s_status.srtt_ms, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_status.rto_ms, UART_RTO_INITIAL_MS, memory_order_relaxed);
+    xSemaphoreGive(uart_mutex);
+
+    system_state_mark_changed();
+}
+
+/**
+ * 保存协商后的波特率，默认波特率时删除记录
+ */
+static void uart_store_baud_rate(uint32_t baud_rate)
+{
+    nvs_handle_t handle;
+    if (nvs_open(UART_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "打开NVS失败，波特率未保存");
+        return;
+    }
+    if (baud_rate == UART_BAUD_RATE) {
+        nvs_erase_key(handle, UART_NVS_KEY_BAUD);
+    } else {
+        nvs_set_u32(handle, UART_NVS_KEY_BAUD, baud_rate);
+    }
+    nvs_commit(handle);
+    nvs_close(handle);
+}
+
+/**
+ * 读取上次协商的波特率
+ * @return 保存的波特率，没有记录时返回默认波特率
+ */
+static uint32_t uart_load_baud_rate(void)
+{
+    uint32_t baud_rate = UART_BAUD_RATE;
+    nvs_handle_t handle;
+    if (nvs_open(UART_NVS_NAMESPACE, NVS_READONLY, &handle) == ESP_OK) {
+        nvs_get_u32(handle, UART_NVS_KEY_BAUD, &baud_rate);
+        nvs_close(handle);
+    }
+    return baud_rate;
+}
+
+/**
+ * 检查在途指令超时: 未到重试上限则重传，否则以ESP_ERR_TIMEOUT结束
+ * @return 距离下一个超时的时间 (tick)
+ */
+static TickType_t uart_check_timeouts(void)
+{
+    uart_inflight_t expired[UART_TX_WINDOW];
+    int expired_count = 0;
+    int64_t now = esp_timer_get_time();
+    int64_t nearest = INT64_MAX;
+
+    xSemaphoreTake(uart_mutex, portMAX_DELAY);
+    for (int i = 0; i < UART_TX_WINDOW; i++) {
+        uart_inflight_t *slot = &s_inflight[i];
+        if (!slot->in_use) {
+            continue;
+        }
+        if (slot->deadline_us <= now) {
+            if (slot->retries >= slot->max_retries) {
+                expired[expired_count++] = *slot;
+                slot->in_use = false;
+                continue;
+            }
+            // 指数退避重传
+            slot->retries++;
+            atomic_fetch_add_explicit(&s_status.retransmit_count, 1, memory_order_relaxed);
+            slot->sent_us = now;
+            slot->deadline_us = now + MIN(s_rto_us << slot->retries, UART_RTO_MAX_MS * 1000);
+            uart_write_bytes(UART_PORT_NUM, (const char *)slot->frame, UART_FRAME_SIZE);
+            atomic_fetch_add_explicit(&s_status.tx_count, 1, memory_order_relaxed);
+            ESP_LOGW(TAG, "重传指令 seq=%d (第%d次)", slot->seq, slot->retries);
+        }
+        nearest = MIN(nearest, slot->deadline_us);
+    }
+    xSemaphoreGive(uart_mutex);
+
+    for (int i = 0; i < expired_count; i++) {
+        atomic_fetch_add_explicit(&s_status.timeout_count, 1, memory_order_relaxed);
+        ESP_LOGW(TAG, "指令 seq=%d 未收到应答", expired[i].seq);
+        xSemaphoreGive(s_window_sem);
+        if (expired[i].done_cb != NULL) {
+            expired[i].done_cb(ESP_ERR_TIMEOUT, NULL, expired[i].arg);
+        }
+    }
+    if (expired_count > 0) {
+        uart_set_connected(false);
+
+        // 高速率下连续无应答: 对端可能已复位回默认波特率
+        s_consecutive_timeouts += expired_count;
+        if (s_baud_rate != UART_BAUD_RATE && s_consecutive_timeouts >= UART_BAUD_FALLBACK_TIMEOUTS) {
+            ESP_LOGW(TAG, "%lu波特率下连续%d条指令无应答，回退到%d",
+                     s_baud_rate, s_consecutive_timeouts, UART_BAUD_RATE);
+            uart_apply_baud_rate(UART_BAUD_RATE);
+            uart_store_baud_rate(UART_BAUD_RATE);
+            s_consecutive_timeouts = 0;
+        }
+    }
+
+    if (nearest == INT64_MAX) {
+        return portMAX_DELAY;
+    }
+    return nearest > now ? pdMS_TO_TICKS((nearest - now + 999) / 1000) : 0;
+}
+
+/**
+ * 接收字节流并组装帧
+ * 以0xBB起始、0x66结束、长度固定21字节，校验失败时从下一个0xBB重新同步
+ */
+static void uart_feed_bytes(const uint8_t *data, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        if (s_rx_len == 0 && data[i] != UART_FRAME_HEAD) {
+            continue;
+        }
+        s_rx_frame[s_rx_len++] = data[i];
+        if (s_rx_len < UART_FRAME_SIZE) {
+            continue;
+        }
+
+        if (s_rx_frame[UART_FRAME_SIZE - 1] == UART_FRAME_TAIL &&
+            s_rx_frame[UART_FRAME_CHECKSUM_IDX] == uart_comm_frame_checksum(s_rx_frame)) {
+            uart_handle_frame(s_rx_frame);
+            s_rx_len = 0;
+            continue;
+        }
+
+        ESP_LOGW(TAG, "应答帧校验失败");
+        uart_note_rx_error(KVM_UART_ERROR_CHECKSUM);
+
+        // 从下一个起始字节重新同步
+        size_t next = 1;
+        while (next < UART_FRAME_SIZE && s_rx_frame[next] != UART_FRAME_HEAD) {
+            next++;
+        }
+        s_rx_len = UART_FRAME_SIZE - next;
+        memmove(s_rx_frame, s_rx_frame + next, s_rx_len);
+    }
+}
+
+/**
+ * 读取接收缓冲区中的数据并送入帧解析
+ */
+static void uart_read_and_feed(size_t len)
+{
+    uint8_t buf[UART_FRAME_SIZE * 2];
+
+    while (len > 0) {
+        int n = uart_read_bytes(UART_PORT_NUM, buf, MIN(len, sizeof(buf)), 0);
+        if (n <= 0) {
+            break;
+        }
+        uart_feed_bytes(buf, n);
+        len -= n;
+    }
+}
+
+/**
+ * UART接收任务
+ * 结束字节0x66触发模式检测事件，读取到该位置为止的数据；
+ * 等待事件的超时即最近的重传时间
+ */
+static void uart_rx_task(void *pvParameters)
+{
+    uart_event_t event;
+    TickType_t wait = portMAX_DELAY;
+
+    while (1) {
+        if (xQueueReceive(s_uart_queue, &event, wait) != pdTRUE) {
+            wait = uart_check_timeouts();
+            continue;
+        }
+
+        switch (event.type) {
+        case UART_PATTERN_DET: {
+            int pos = uart_pattern_pop_pos(UART_PORT_NUM);
+            if (pos < 0) {
+                // 模式位置队列溢出，丢弃缓冲区重新同步
+                uart_flush_input(UART_PORT_NUM);
+                s_rx_len = 0;
+            } else {
+                uart_read_and_feed(pos + 1);
+            }
+            break;
+        }
+
+        case UART_DATA: {
+            // 正常应答由模式检测处理，这里只清理缓冲区中积累的无结束字节的数据
+            size_t buffered = 0;
+            uart_get_buffered_data_len(UART_PORT_NUM, &buffered);
+            if (buffered > UART_FRAME_SIZE * 2) {
+                uart_read_and_feed(buffered);
+            }
+            break;
+        }
+
+        case UART_FIFO_OVF:
+        case UART_BUFFER_FULL:
+            ESP_LOGW(TAG, "UART接收溢出");
+            uart_flush_input(UART_PORT_NUM);
+            uart_pattern_queue_reset(UART_PORT_NUM, UART_PATTERN_QUEUE_SIZE);
+            xQueueReset(s_uart_queue);
+            s_rx_len = 0;
+            uart_note_rx_error(KVM_UART_ERROR_OVERFLOW);
+            break;
+
+        case UART_FRAME_ERR:
+        case UART_PARITY_ERR:
+            uart_note_rx_error(KVM_UART_ERROR_FRAMING);
+            break;
+
+        default:
+            // 包括uart_wake_rx_task发送的UART_EVENT_MAX
+            break;
+        }
+
+        wait = uart_check_timeouts();
+    }
+}
+
 /**
  * 初始化UART通信
  */
@@ -25,7 +459,8 @@ esp_err_t uart_comm_init(void)
 
     // 创建互斥锁
     uart_mutex = xSemaphoreCreateMutex();
-    if (uart_mutex == NULL) {
+    s_window_sem = xSemaphoreCreateCounting(UART_TX_WINDOW, UART_TX_WINDOW);
+    if (uart_mutex == NULL || s_window_sem == NULL) {
         ESP_LOGE(TAG, "创建UART互斥锁失败");
         return ESP_FAIL;
     }
@@ -58,146 +493,414 @@ esp_err_t uart_comm_init(void)
         return ret;
     }
 
-    // 安装UART驱动
+    // 安装UART驱动 (带事件队列)
     ret = uart_driver_install(UART_PORT_NUM, UART_RX_BUFFER_SIZE,
-                             UART_TX_BUFFER_SIZE, 0, NULL, 0);
+                             UART_TX_BUFFER_SIZE, UART_EVENT_QUEUE_SIZE, &s_uart_queue, 0);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "安装UART驱动失败: %s", esp_err_to_name(ret));
         return ret;
     }
 
+    // 帧结束字节触发模式检测中断
+    uart_enable_pattern_det_baud_intr(UART_PORT_NUM, UART_FRAME_TAIL, 1, 9, 0, 0);
+    uart_pattern_queue_reset(UART_PORT_NUM, UART_PATTERN_QUEUE_SIZE);
+
     // 清空缓冲区
     uart_flush(UART_PORT_NUM);
 
+    atomic_store_explicit(&s_status.rto_ms, UART_RTO_INITIAL_MS, memory_order_relaxed);
+    atomic_store_explicit(&s_status.baud_rate, UART_BAUD_RATE, memory_order_relaxed);
+
+    if (xTaskCreate(uart_rx_task, "uart_rx", UART_RX_TASK_STACK_SIZE, NULL,
+                    UART_RX_TASK_PRIORITY, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "创建UART接收任务失败");
+        return ESP_ERR_NO_MEM;
+    }
+
     ESP_LOGI(TAG, "✓ UART通信初始化完成");
     return ESP_OK;
 }
 
-// 删除uart_comm_read_response函数，按用户要求不等待响应
-
 /**
- * 发送通道切换命令 (简化版)
- * 直接发送21字节的固定指令，不等待响应
+ * 提交指令 (可指定重传次数)
+ * @param tx_start_us 输出帧写入驱动的时间，可为NULL
  */
-esp_err_t uart_comm_switch_channel(int channel)
+static esp_err_t uart_submit(uint8_t cmd, int channel, const uint8_t *payload, size_t payload_len,
+                             uint8_t max_retries, uart_comm_done_cb_t done_cb, void *arg, int64_t *tx_start_us)
 {
-    if (channel < 1 || channel > 2) {
-        ESP_LOGE(TAG, "无效通道号: %d", channel);
+    if (channel < 0 || channel > 0xFF || payload_len > UART_FRAME_PAYLOAD_MAX ||
+        (payload_len > 0 && payload == NULL)) {
         return ESP_ERR_INVALID_ARG;
     }
+    if (uart_mutex == NULL) {
+        ESP_LOGE(TAG, "UART未初始化");
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    // 定义切换成功响应格式 (根据协议文档)
-    // 格式: [起始字节][响应状态][数据长度][当前通道][数据填充15字节][校验和][结束字节]
-    uint8_t response_data[21] = {
-        0xBB,                                                           // 索引0: 起始字节
-        0x00,                                                           // 索引1: 响应状态 (成功)
-        0x01,                                                           // 索引2: 数据长度 (1字节)
-        (uint8_t)channel,                                               // 索引3: 当前通道号
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,               // 索引4-11: 数据填充 (8字节)
-        0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,                     // 索引12-18: 数据填充 (7字节)
-        0x00,                                                           // 索引19: 校验和 (待计算)
-        0x66                                                            // 索引20: 结束字节
-    };
-    
-    // 根据协议图片计算校验和
-    // 通道1: BB 00 01 01 00*15 -> 校验和 0xBA
-    // 通道2: BB 00 01 02 00*15 -> 校验和 0xB9
-    uint8_t checksum;
-    if (channel == 1) {
-        checksum = 0xBA;  // 协议图片中指定的校验和
-    } else if (channel == 2) {
-        checksum = 0xB9;  // 协议图片中指定的校验和
-    } else {
-        // 对于其他通道，使用简单累加算法
-        checksum = 0;
-        for (int i = 0; i < 20; i++) {
-            checksum += response_data[i];
-        }
-    }
-    response_data[19] = checksum;
-
-    const uint8_t *command_to_send = response_data;
-    const int command_size = 21; // 明确指定21字节
-
-    // 纯净发送21位KVM控制数据到CH32V003
-    
-    // 如果需要测试，可以发送一个简单的文本消息
-    // 取消注释下面的代码来发送文本而不是二进制数据
-    /*
-    char test_message[64];
-    snprintf(test_message, sizeof(test_message), "KVM_SWITCH_CH%d_OK\r\n", channel);
-    ESP_LOGI(TAG, "发送测试文本: %s", test_message);
-    uart_write_bytes(UART_PORT_NUM, test_message, strlen(test_message));
+    // 等待空闲窗口
+    if (xSemaphoreTake(s_window_sem, pdMS_TO_TICKS(UART_WINDOW_WAIT_MS)) != pdTRUE) {
+        ESP_LOGW(TAG, "发送窗口已满");
+        return ESP_ERR_TIMEOUT;
+    }
+
+    xSemaphoreTake(uart_mutex, portMAX_DELAY);
+    uart_inflight_t *slot = NULL;
+    for (int i = 0; i < UART_TX_WINDOW; i++) {
+        if (!s_inflight[i].in_use) {
+            slot = &s_inflight[i];
+            break;
+        }
+    }
+    if (slot == NULL) {
+        // 窗口计数与槽位不一致 (不应发生)
+        xSemaphoreGive(uart_mutex);
+        xSemaphoreGive(s_window_sem);
+        ESP_LOGE(TAG, "没有空闲的在途槽位");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 格式: [起始字节][状态][数据长度][通道][序号][指令][参数13字节][校验和][结束字节]
+    memset(slot->frame, 0, UART_FRAME_SIZE);
+    slot->frame[0] = UART_FRAME_HEAD;
+    slot->frame[1] = UART_FRAME_STATUS_OK;
+    slot->frame[2] = 0x01;                      // 数据长度: 通道1字节 (与原协议一致)
+    slot->frame[3] = (uint8_t)channel;
+    // 未确认扩展协议时切换指令与原协议帧完全一致 (序号和指令为0)
+    bool legacy_frame = cmd == UART_CMD_SWITCH && !atomic_load_explicit(&s_peer_sequenced, memory_order_relaxed);
+    if (!legacy_frame) {
+        slot->frame[UART_FRAME_SEQ_IDX] = s_next_seq;
+        slot->frame[UART_FRAME_CMD_IDX] = cmd;
+    }
+    if (payload_len > 0) {
+        memcpy(&slot->frame[UART_FRAME_PAYLOAD_IDX], payload, payload_len);
+    }
+    slot->frame[UART_FRAME_CHECKSUM_IDX] = uart_comm_frame_checksum(slot->frame);
+    slot->frame[UART_FRAME_SIZE - 1] = UART_FRAME_TAIL;
+
+    slot->seq = s_next_seq;
+    s_next_seq = s_next_seq == 0xFF ? 1 : s_next_seq + 1;   // 序号0保留给不回显序号的应答
+    slot->retries = 0;
+    slot->max_retries = max_retries;
+    slot->done_cb = done_cb;
+    slot->arg = arg;
+    slot->sent_us = esp_timer_get_time();
+    // 不重传的原协议帧只短暂等待可能的应答，不按重传超时占用窗口
+    slot->deadline_us = slot->sent_us +
+                        (legacy_frame && max_retries == 0 ? UART_LEGACY_REPLY_MS * 1000 : s_rto_us);
+
+    // 写入驱动发送缓冲区后立即返回，不等待发送完成
+    int bytes_sent = uart_write_bytes(UART_PORT_NUM, (const char *)slot->frame, UART_FRAME_SIZE);
+    if (bytes_sent != UART_FRAME_SIZE) {
+        xSemaphoreGive(uart_mutex);
+        xSemaphoreGive(s_window_sem);
+        atomic_fetch_add_explicit(&s_status.error_count, 1, memory_order_relaxed);
+        ESP_LOGE(TAG, "UART发送失败: %d/%d字节", bytes_sent, UART_FRAME_SIZE);
+        return ESP_FAIL;
+    }
+    slot->in_use = true;
+    atomic_fetch_add_explicit(&s_status.tx_count, 1, memory_order_relaxed);
+    if (tx_start_us != NULL) {
+        *tx_start_us = slot->sent_us;
+    }
+    xSemaphoreGive(uart_mutex);
+
+    uart_wake_rx_task();
     return ESP_OK;
-    */
+}
+
+/**
+ * 提交指令
+ */
+esp_err_t uart_comm_submit(uint8_t cmd, int channel, const uint8_t *payload, size_t payload_len,
+                           uart_comm_done_cb_t done_cb, void *arg)
+{
+    return uart_submit(cmd, channel, payload, payload_len, UART_MAX_RETRIES, done_cb, arg, NULL);
+}
+
+/**
+ * 同步指令的完成回调
+ */
+typedef struct {
+    SemaphoreHandle_t done;
+    esp_err_t result;
+    uint8_t *reply;
+    int64_t ack_us;
+} uart_sync_request_t;
+
+static void uart_sync_done(esp_err_t result, const uint8_t *reply, void *arg)
+{
+    uart_sync_request_t *sync = (uart_sync_request_t *)arg;
+    sync->result = result;
+    if (reply != NULL) {
+        sync->ack_us = esp_timer_get_time();
+    }
+    if (reply != NULL && sync->reply != NULL) {
+        memcpy(sync->reply, reply, UART_FRAME_SIZE);
+    }
+    xSemaphoreGive(sync->done);
+}
+
+/**
+ * 发送指令并等待应答 (可指定重传次数)
+ * @param timing 输出各阶段时间戳，可为NULL；非NULL时额外等待帧从UART发出以记录发送完成时间
+ */
+static esp_err_t uart_request(uint8_t cmd, int channel, const uint8_t *payload, size_t payload_len,
+                              uint8_t max_retries, uint8_t *reply, uart_comm_timing_t *timing)
+{
+    uart_sync_request_t sync = {
+        .done = xSemaphoreCreateBinary(),
+        .result = ESP_FAIL,
+        .reply = reply
+    };
+    if (sync.done == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    int64_t tx_start_us = 0;
+    int64_t submit_us = esp_timer_get_time();
+    esp_err_t ret = uart_submit(cmd, channel, payload, payload_len, max_retries, uart_sync_done, &sync,
+                                &tx_start_us);
+    if (ret == ESP_OK) {
+        int64_t tx_done_us = 0;
+        if (timing != NULL) {
+            // 应答可能先于本任务被调度回来，发送完成时间不晚于应答时间
+            uart_wait_tx_done(UART_PORT_NUM, pdMS_TO_TICKS(UART_FRAME_TIME_MS * 2));
+            tx_done_us = esp_timer_get_time();
+        }
+        // 每条指令最终都会应答或超时，sync在栈上，必须等到回调完成
+        xSemaphoreTake(sync.done, portMAX_DELAY);
+        ret = sync.result;
+
+        if (timing != NULL) {
+            timing->submit_us = submit_us;
+            timing->tx_start_us = tx_start_us;
+            timing->tx_done_us = sync.ack_us != 0 ? MIN(tx_done_us, sync.ack_us) : tx_done_us;
+            timing->ack_us = sync.ack_us;
+        }
+    }
+
+    vSemaphoreDelete(sync.done);
+    return ret;
+}
+
+/**
+ * 发送指令并等待应答
+ */
+esp_err_t uart_comm_request(uint8_t cmd, int channel, const uint8_t *payload, size_t payload_len,
+                            uint8_t *reply)
+{
+    return uart_request(cmd, channel, payload, payload_len, UART_MAX_RETRIES, reply, NULL);
+}
+
+/**
+ * 以查询指令验证当前波特率下链路可用
+ * 只有回显序号和指令的应答才能完成查询，不理解扩展指令的固件在这里失败
+ */
+static bool uart_probe_link(void)
+{
+    return uart_request(UART_CMD_QUERY, 0, NULL, 0, UART_BAUD_PROBE_RETRIES, NULL, NULL) == ESP_OK;
+}
+
+/**
+ * 尝试切换到指定波特率
+ * 对端在旧速率下确认SET_BAUD后切换；若新速率下一段时间内没有收到有效帧，
+ * 对端自行回到原速率。本端在新速率下用测试帧验证，失败时同样回退。
+ */
+static bool uart_try_baud_rate(uint32_t baud_rate)
+{
+    uint32_t previous = s_baud_rate;
+    uint8_t payload[4] = {
+        baud_rate & 0xFF, (baud_rate >> 8) & 0xFF, (baud_rate >> 16) & 0xFF, (baud_rate >> 24) & 0xFF
+    };
+
+    if (uart_request(UART_CMD_SET_BAUD, 0, payload, sizeof(payload), UART_BAUD_PROBE_RETRIES, NULL, NULL) != ESP_OK) {
+        ESP_LOGI(TAG, "CH32V003不支持%lu波特率", baud_rate);
+        return false;
+    }
+
+    uart_apply_baud_rate(baud_rate);
+    if (uart_probe_link()) {
+        return true;
+    }
+
+    ESP_LOGW(TAG, "%lu波特率验证失败，回退到%lu", baud_rate, previous);
+    uart_apply_baud_rate(previous);
+    // 等待对端超时回退
+    vTaskDelay(pdMS_TO_TICKS(UART_BAUD_REVERT_MS));
+    return false;
+}
+
+/**
+ * 协商波特率
+ * 协商期间切换指令照常发送，因此先在默认速率下探测 (对端复位后的速率)，
+ * 默认速率无应答时才尝试保存的速率，避免在协商结束前把链路切到对端未使用的速率
+ */
+esp_err_t uart_comm_negotiate_baud(void)
+{
+    static const uint32_t candidates[] = UART_BAUD_RATE_CANDIDATES;
 
     if (uart_mutex == NULL) {
-        ESP_LOGE(TAG, "UART互斥锁未初始化");
         return ESP_ERR_INVALID_STATE;
     }
 
-    if (xSemaphoreTake(uart_mutex, pdMS_TO_TICKS(1000)) != pdTRUE) {
-        ESP_LOGE(TAG, "获取UART互斥锁失败");
+    if (!uart_probe_link()) {
+        // 对端未复位时仍在上次协商的速率
+        uint32_t stored = uart_load_baud_rate();
+        if (stored != UART_BAUD_RATE) {
+            uart_apply_baud_rate(stored);
+            if (uart_probe_link()) {
+                ESP_LOGI(TAG, "使用保存的波特率: %lu", stored);
+                return ESP_OK;
+            }
+            uart_apply_baud_rate(UART_BAUD_RATE);
+        }
+        ESP_LOGW(TAG, "CH32V003无应答，保持%d波特率", UART_BAUD_RATE);
         return ESP_ERR_TIMEOUT;
     }
 
-    // 清空发送和接收缓冲区
-    uart_flush(UART_PORT_NUM);
-    
-    // 等待UART准备就绪
-    uart_wait_tx_done(UART_PORT_NUM, pdMS_TO_TICKS(100));
+    // 逐级提高速率，直到失败
+    for (size_t i = 0; i < sizeof(candidates) / sizeof(candidates[0]); i++) {
+        if (!uart_try_baud_rate(candidates[i])) {
+            break;
+        }
+    }
+
+    ESP_LOGI(TAG, "波特率协商完成: %lu", s_baud_rate);
+    uart_store_baud_rate(s_baud_rate);
+    return ESP_OK;
+}
+
+/**
+ * 发送通道切换命令并等待CH32V003确认
+ */
+esp_err_t uart_comm_switch_channel(int channel)
+{
+    return uart_comm_switch_channel_timed(channel, NULL);
+}
+
+/**
+ * 发送通道切换命令并记录各阶段时间戳
+ */
+esp_err_t uart_comm_switch_channel_timed(int channel, uart_comm_timing_t *timing)
+{
+    if (channel < 1 || channel > KVM_CHANNEL_MAX) {
+        ESP_LOGE(TAG, "无效通道号: %d", channel);
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 未确认扩展协议的对端可能不应答，只发送一次，短暂等待应答后即返回
+    bool require_response = UART_REQUIRE_RESPONSE || uart_comm_peer_sequenced();
+    uint8_t reply[UART_FRAME_SIZE] = {0};     // 未收到应答时reply[0]不是帧起始字节
+    esp_err_t ret = uart_request(UART_CMD_SWITCH, channel, NULL, 0, require_response ? UART_MAX_RETRIES : 0,
+                                 reply, timing);
 
-    // 发送指令
-    int bytes_sent = uart_write_bytes(UART_PORT_NUM, (const char *)command_to_send, command_size);
-    
-    // 确保数据发送完成
-    esp_err_t wait_result = uart_wait_tx_done(UART_PORT_NUM, pdMS_TO_TICKS(1000));
-    if (wait_result != ESP_OK) {
-        ESP_LOGW(TAG, "UART发送等待超时: %s", esp_err_to_name(wait_result));
+    if (ret == ESP_OK && reply[2] >= 1 && reply[3] != channel) {
+        ESP_LOGW(TAG, "CH32V003应答通道%d与请求通道%d不一致", reply[3], channel);
+        ret = ESP_FAIL;
+    } else if (ret == ESP_FAIL && reply[0] == UART_FRAME_HEAD) {
+        ESP_LOGW(TAG, "CH32V003拒绝切换到通道%d (状态0x%02X)", channel, reply[1]);
+    } else if (ret == ESP_FAIL) {
+        ESP_LOGW(TAG, "切换到通道%d的指令发送失败", channel);
+    } else if (ret == ESP_ERR_TIMEOUT && !require_response) {
+        // 兼容不回复的原协议固件: 指令已发出，按成功处理
+        ret = ESP_OK;
     }
+    return ret;
+}
 
-    xSemaphoreGive(uart_mutex);
+/**
+ * 查询CH32V003当前通道
+ */
+esp_err_t uart_comm_query_channel(int *channel)
+{
+    if (channel == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
 
-    if (bytes_sent == command_size) {
-        return ESP_OK;
-    } else {
-        ESP_LOGE(TAG, "UART发送失败 通道%d: %d/%d字节", channel, bytes_sent, command_size);
-        return ESP_FAIL;
+    if (!uart_comm_peer_sequenced()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    uint8_t reply[UART_FRAME_SIZE];
+    esp_err_t ret = uart_comm_request(UART_CMD_QUERY, 0, NULL, 0, reply);
+    if (ret == ESP_OK) {
+        *channel = reply[3];
+    }
+    return ret;
+}
+
+/**
+ * 设置通道名称指令的完成回调 (在接收任务中执行，只记录结果)
+ */
+static void uart_rename_done(esp_err_t result, const uint8_t *reply, void *arg)
+{
+    int channel = (int)(intptr_t)arg;
+    if (result != ESP_OK) {
+        ESP_LOGW(TAG, "CH32V003通道%d名称同步失败: %s", channel, esp_err_to_name(result));
     }
 }
 
-// --- 存根函数，以保持与其他模块的兼容性 ---
+/**
+ * 设置CH32V003端的通道名称 (提交后立即返回)
+ */
+esp_err_t uart_comm_set_channel_name(int channel, const char *name)
+{
+    if (channel < 1 || channel > KVM_CHANNEL_MAX || name == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!uart_comm_peer_sequenced()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // 名称超出参数区时截断
+    size_t len = MIN(strlen(name), UART_FRAME_PAYLOAD_MAX);
+    return uart_comm_submit(UART_CMD_RENAME, channel, (const uint8_t *)name, len,
+                            uart_rename_done, (void *)(intptr_t)channel);
+}
 
 /**
- * 获取通信状态
- * 返回一个静态的、默认的“已连接”状态
+ * 获取通信状态快照
  */
-const uart_comm_status_t* uart_comm_get_status(void)
+void uart_comm_get_status_snapshot(uart_comm_status_t *out)
 {
-    static const uart_comm_status_t dummy_status = {
-        .connected = true,
-        .tx_count = 0, // 在这个简化版本中不跟踪计数
-        .rx_count = 0,
-        .error_count = 0,
-        .last_response_time = 0
-    };
-    return &dummy_status;
+    out->connected = atomic_load_explicit(&s_status.connected, memory_order_relaxed);
+    out->tx_count = atomic_load_explicit(&s_status.tx_count, memory_order_relaxed);
+    out->rx_count = atomic_load_explicit(&s_status.rx_count, memory_order_relaxed);
+    out->error_count = atomic_load_explicit(&s_status.error_count, memory_order_relaxed);
+    out->timeout_count = atomic_load_explicit(&s_status.timeout_count, memory_order_relaxed);
+    out->retransmit_count = atomic_load_explicit(&s_status.retransmit_count, memory_order_relaxed);
+    out->srtt_ms = atomic_load_explicit(&s_status.srtt_ms, memory_order_relaxed);
+    out->rto_ms = atomic_load_explicit(&s_status.rto_ms, memory_order_relaxed);
+    out->baud_rate = atomic_load_explicit(&s_status.baud_rate, memory_order_relaxed);
+    out->last_response_time = atomic_load_explicit(&s_status.last_response_time, memory_order_relaxed);
+}
+
+/**
+ * 对端是否已确认支持扩展协议
+ */
+bool uart_comm_peer_sequenced(void)
+{
+    return atomic_load_explicit(&s_peer_sequenced, memory_order_relaxed);
 }
 
 /**
  * 检查通信连接状态
- * 总是返回true
+ * 最近一次指令收到有效应答时为true
  */
 bool uart_comm_is_connected(void)
 {
-    return true;
+    return atomic_load_explicit(&s_status.connected, memory_order_relaxed);
 }
 
 /**
- * 重置通信状态
- * 无操作
+ * 重置通信计数
  */
 void uart_comm_reset_status(void)
 {
-    // 无操作
+    atomic_store_explicit(&s_status.tx_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_status.rx_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_status.error_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_status.timeout_count, 0, memory_order_relaxed);
+    atomic_store_explicit(&s_status.retransmit_count, 0, memory_order_relaxed);
+    system_state_mark_changed();
 }
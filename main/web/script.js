@@ -5,9 +5,17 @@
 
 // 全局变量
 let currentChannel = 1;
+let channelCount = 0;
+let channelsLoading = null;
 let isConnected = false;
 let websocket = null;
+let wsReconnectDelay = 1000;
+let wsRequestId = 0;
+let wsPendingRequests = {};
 let statusUpdateInterval = null;
+let statusPollController = null;
+let uptimeBase = null;
+let uptimeTimer = null;
 let logEntries = [];
 
 // API端点
@@ -24,12 +32,12 @@ const API = {
 document.addEventListener('DOMContentLoaded', function() {
     console.log('KVM控制器前端初始化...');
     
-    // 初始化连接状态 (HTTP模式)
+    // 按固件配置的通道数生成通道卡片
+    loadChannels();
+
+    // 优先使用WebSocket推送，连接失败时回退到HTTP轮询
     initWebSocket();
     
-    // 启动轮询模式（包含状态更新）
-    startPollingMode();
-    
     // 初始化界面
     updateUI();
     
@@ -40,37 +48,159 @@ document.addEventListener('DOMContentLoaded', function() {
 });
 
 /**
- * WebSocket功能已禁用，使用HTTP轮询模式
+ * 初始化WebSocket连接
+ * 连接成功后停止HTTP轮询，断开时回退到轮询并按指数退避重连
  */
 function initWebSocket() {
-    // WebSocket功能已禁用
-    console.log('WebSocket功能已禁用，使用HTTP轮询模式');
-    // 不直接设置连接状态，让后续的状态检查来确定
-    isConnected = false;
-    updateConnectionStatus(false);
-    addLog('系统', '正在检查连接状态...');
+    if (!('WebSocket' in window)) {
+        addLog('系统', '浏览器不支持WebSocket，使用HTTP轮询模式');
+        startPollingMode();
+        return;
+    }
+
+    const protocol = location.protocol === 'https:' ? 'wss:' : 'ws:';
+    websocket = new WebSocket(`${protocol}//${location.host}/ws`);
+
+    websocket.onopen = function() {
+        wsReconnectDelay = 1000;
+        stopPollingMode();
+        isConnected = true;
+        updateConnectionStatus(true);
+        addLog('系统', 'WebSocket已连接，实时推送已启用');
+        websocket.send(JSON.stringify({ type: 'get_status' }));
+    };
+
+    websocket.onmessage = function(event) {
+        try {
+            handleWebSocketMessage(JSON.parse(event.data));
+        } catch (error) {
+            console.error('WebSocket消息解析失败:', error);
+        }
+    };
+
+    websocket.onclose = function() {
+        websocket = null;
+        rejectPendingWsRequests('WebSocket连接已断开');
+        addLog('系统', `WebSocket已断开，${wsReconnectDelay / 1000}秒后重连`);
+        startPollingMode();
+        setTimeout(initWebSocket, wsReconnectDelay);
+        wsReconnectDelay = Math.min(wsReconnectDelay * 2, 30000);
+    };
+
+    websocket.onerror = function() {
+        // onclose会随后触发，在那里处理重连
+        console.warn('WebSocket连接错误');
+    };
+}
+
+/**
+ * WebSocket是否可用
+ */
+function isWebSocketOpen() {
+    return websocket !== null && websocket.readyState === WebSocket.OPEN;
+}
+
+/**
+ * 通过WebSocket发送请求并等待带相同id的回复
+ */
+function sendWsRequest(message, timeoutMs = 5000) {
+    return new Promise((resolve, reject) => {
+        const id = ++wsRequestId;
+        const timer = setTimeout(() => {
+            delete wsPendingRequests[id];
+            reject(new Error('WebSocket请求超时'));
+        }, timeoutMs);
+        wsPendingRequests[id] = { resolve, reject, timer };
+        websocket.send(JSON.stringify({ ...message, id: id }));
+    });
+}
+
+/**
+ * 连接断开时结束所有未完成的WebSocket请求
+ */
+function rejectPendingWsRequests(reason) {
+    Object.keys(wsPendingRequests).forEach(id => {
+        clearTimeout(wsPendingRequests[id].timer);
+        wsPendingRequests[id].reject(new Error(reason));
+    });
+    wsPendingRequests = {};
 }
 
 /**
  * 启动轮询模式
+ * 使用长轮询: 携带上次的状态代数请求/api/status，状态变化时服务器才返回
  */
 function startPollingMode() {
-    // 立即更新一次状态
-    updateSystemStatus();
+    if (statusPollController) {
+        return;
+    }
+
+    statusPollController = new AbortController();
+    longPollStatus(statusPollController.signal);
 
-    // 设置定时轮询（每3秒更新一次）
-    setInterval(() => {
-        updateSystemStatus();
-    }, 3000);
+    addLog('系统', '状态长轮询已启动');
+}
 
-    addLog('系统', '状态轮询已启动（每3秒更新）');
+/**
+ * 停止轮询模式
+ */
+function stopPollingMode() {
+    if (statusPollController) {
+        statusPollController.abort();
+        statusPollController = null;
+    }
 }
 
 /**
- * 更新系统状态（轮询模式）
+ * 从ETag(W/"<gen>")中解析状态代数
+ */
+function parseStatusGeneration(response) {
+    const match = /"(\d+)"/.exec(response.headers.get('ETag') || '');
+    return match ? match[1] : null;
+}
+
+/**
+ * 长轮询循环，直到signal被中止
+ */
+async function longPollStatus(signal) {
+    let generation = null;
+
+    while (!signal.aborted) {
+        try {
+            const url = generation ? `${API.STATUS}?since=${generation}` : API.STATUS;
+            const response = await fetch(url, { cache: 'no-store', signal: signal });
+            const data = await response.json();
+            generation = parseStatusGeneration(response);
+
+            if (data.code === 0) {
+                if (!isConnected) {
+                    isConnected = true;
+                    updateConnectionStatus(true);
+                    addLog('系统', '连接已恢复');
+                }
+                updateSystemStatusDisplay(data.data);
+            }
+        } catch (error) {
+            if (signal.aborted) {
+                break;
+            }
+            console.error('状态更新失败:', error);
+            if (isConnected) {
+                isConnected = false;
+                updateConnectionStatus(false);
+                addLog('错误', '连接已断开');
+            }
+            generation = null;
+            await new Promise(resolve => setTimeout(resolve, 3000));
+        }
+    }
+}
+
+/**
+ * 更新系统状态（单次请求）
  */
 function updateSystemStatus() {
-    fetch('/api/status')
+    fetch(API.STATUS, { cache: 'no-store' })
         .then(response => response.json())
         .then(data => {
             if (data.code === 0) {
@@ -78,7 +208,6 @@ function updateSystemStatus() {
                 if (!isConnected) {
                     isConnected = true;
                     updateConnectionStatus(true);
-                    addLog('系统', '连接已恢复');
                 }
 
                 // 更新完整的系统状态
@@ -87,15 +216,35 @@ function updateSystemStatus() {
         })
         .catch(error => {
             console.error('状态更新失败:', error);
-            // 连接失败时更新状态
-            if (isConnected) {
-                isConnected = false;
-                updateConnectionStatus(false);
-                addLog('错误', '连接已断开');
-            }
         });
 }
 
+/**
+ * 本地推算运行时间
+ * 状态不变时服务器不再返回新数据，运行时间由浏览器按收到的值继续计时
+ */
+function setUptimeBase(uptime) {
+    uptimeBase = { uptime: uptime, receivedAt: Date.now() };
+    if (!uptimeTimer) {
+        uptimeTimer = setInterval(renderUptime, 1000);
+    }
+    renderUptime();
+}
+
+function currentUptime() {
+    if (!uptimeBase) {
+        return 0;
+    }
+    return uptimeBase.uptime + Math.floor((Date.now() - uptimeBase.receivedAt) / 1000);
+}
+
+function renderUptime() {
+    const uptimeElement = document.getElementById('uptime');
+    if (uptimeElement && uptimeBase) {
+        uptimeElement.textContent = formatUptime(currentUptime());
+    }
+}
+
 /**
  * 更新系统状态显示（从轮询数据）
  */
@@ -124,7 +273,13 @@ function updateSystemStatusDisplay(data) {
 
     // 更新通信状态
     if (data.comm_status) {
-        const commStatus = data.comm_status.connected ? '正常' : '断开';
+        // 收到CH32V003应答前无法判断链路状态
+        let commStatus = '未确认';
+        if (data.comm_status.connected) {
+            commStatus = '正常';
+        } else if (data.comm_status.tx_count > 0) {
+            commStatus = '无应答';
+        }
         const statusElement = document.getElementById('comm-status');
         if (statusElement) {
             statusElement.textContent = commStatus;
@@ -132,16 +287,13 @@ function updateSystemStatusDisplay(data) {
     }
 
     // 更新运行时间
-    if (data.uptime) {
-        const uptimeElement = document.getElementById('uptime');
-        if (uptimeElement) {
-            uptimeElement.textContent = formatUptime(data.uptime);
-        }
+    if (data.uptime !== undefined) {
+        setUptimeBase(data.uptime);
     }
 
     // 更新统计信息
     if (data.stats) {
-        updateStatsDisplay(data.stats);
+        updateStatsDisplay(data.stats, data.uptime);
     }
 
     // 更新通道状态
@@ -153,7 +305,7 @@ function updateSystemStatusDisplay(data) {
 /**
  * 更新统计信息显示
  */
-function updateStatsDisplay(stats) {
+function updateStatsDisplay(stats, uptime) {
     if (stats.total_switches !== undefined) {
         const element = document.getElementById('total-switches');
         if (element) element.textContent = stats.total_switches;
@@ -170,8 +322,9 @@ function updateStatsDisplay(stats) {
         if (element) element.textContent = `${successRate}%`;
     }
 
-    if (stats.last_switch_time) {
-        const lastSwitch = new Date(stats.last_switch_time * 1000);
+    if (stats.last_switch_time && uptime !== undefined) {
+        // last_switch_time为设备开机后秒数，换算为本地时间
+        const lastSwitch = new Date(Date.now() - (uptime - stats.last_switch_time) * 1000);
         const element = document.getElementById('last-switch');
         if (element) element.textContent = lastSwitch.toLocaleString();
     }
@@ -183,11 +336,18 @@ function updateStatsDisplay(stats) {
 function handleWebSocketMessage(data) {
     switch (data.type) {
         case 'status_update':
-            updateSystemStatus(data.data);
+            updateSystemStatusDisplay(data.data);
             break;
         case 'channel_switched':
             handleChannelSwitched(data.data);
             break;
+        case 'switch_result':
+            if (wsPendingRequests[data.id]) {
+                clearTimeout(wsPendingRequests[data.id].timer);
+                wsPendingRequests[data.id].resolve(data);
+                delete wsPendingRequests[data.id];
+            }
+            break;
         case 'error':
             showMessage(data.message, 'error');
             addLog('错误', data.message);
@@ -215,23 +375,33 @@ async function switchChannel(channel) {
     addLog('操作', `正在切换到通道 ${channel}...`);
     
     try {
-        const response = await fetch(`${API.SWITCH}/${channel}`, {
-            method: 'POST',
-            headers: {
-                'Content-Type': 'application/json'
-            }
-        });
-        
-        const result = await response.json();
+        let result;
+        if (isWebSocketOpen()) {
+            // WebSocket可用时直接通过推送通道下发切换命令
+            result = await sendWsRequest({ type: 'switch', channel: channel });
+        } else {
+            const response = await fetch(`${API.SWITCH}/${channel}`, {
+                method: 'POST',
+                headers: {
+                    'Content-Type': 'application/json'
+                }
+            });
+            result = await response.json();
+        }
         
-        if (result.code === 0) {
+        if (result.code === 0 && result.superseded_by !== undefined) {
+            // 切换请求被之后的请求取代，最终通道以状态推送为准
+            addLog('操作', `切换到通道 ${channel} 的请求已被更新的请求取代`);
+        } else if (result.code === 0) {
             // 切换成功
             currentChannel = channel;
             updateChannelDisplay();
             showMessage(`成功切换到通道 ${channel}`, 'success');
             addLog('操作', `成功切换到通道 ${channel}`);
-            // 立即更新一次状态以确保显示最新信息
-            updateSystemStatus();
+            // 轮询模式下立即更新一次状态，WebSocket模式由服务器推送
+            if (!isWebSocketOpen()) {
+                updateSystemStatus();
+            }
         } else {
             // 切换失败
             showMessage(`切换失败: ${result.message}`, 'error');
@@ -297,24 +467,84 @@ function updateChannelDisplay() {
     document.getElementById('current-channel').textContent = currentChannel;
 }
 
+/**
+ * 获取通道列表并生成通道卡片
+ * 并发调用时共用同一次请求
+ */
+function loadChannels() {
+    if (channelsLoading) {
+        return channelsLoading;
+    }
+    channelsLoading = fetch(API.CHANNELS, { cache: 'no-store' })
+        .then(response => response.json())
+        .then(data => {
+            if (data.code === 0 && Array.isArray(data.data)) {
+                renderChannelCards(data.data);
+            }
+        })
+        .catch(error => {
+            console.error('获取通道列表失败:', error);
+            addLog('错误', '获取通道列表失败');
+        })
+        .finally(() => {
+            channelsLoading = null;
+        });
+    return channelsLoading;
+}
+
+/**
+ * 生成通道卡片
+ */
+function renderChannelCards(channels) {
+    const grid = document.getElementById('channel-grid');
+    grid.textContent = '';
+
+    channels.forEach(channel => {
+        const card = document.createElement('div');
+        card.className = 'channel-card';
+        card.dataset.channel = channel.channel;
+        card.innerHTML = `
+            <div class="channel-header">
+                <div class="channel-number">${channel.channel}</div>
+                <div class="channel-status" id="status-${channel.channel}"></div>
+            </div>
+            <div class="channel-info">
+                <div class="channel-name" id="name-${channel.channel}"></div>
+                <div class="channel-type">HDMI输入</div>
+            </div>
+            <button class="channel-btn">
+                <span class="btn-text">切换到此通道</span>
+                <span class="btn-icon">→</span>
+            </button>`;
+        card.querySelector('.channel-btn').addEventListener('click', () => switchChannel(channel.channel));
+        grid.appendChild(card);
+    });
+
+    channelCount = channels.length;
+    updateChannelStatus(channels);
+    updateChannelDisplay();
+}
+
 /**
  * 更新通道状态
+ * channels可以只包含变化的通道 (增量状态)，按通道号合并
  */
 function updateChannelStatus(channels) {
-    for (let i = 1; i <= 2; i++) {
-        const statusElement = document.getElementById(`status-${i}`);
-        const nameElement = document.getElementById(`name-${i}`);
-
-        if (channels[i-1]) {
-            const channel = channels[i-1];
+    for (const channel of channels) {
+        const statusElement = document.getElementById(`status-${channel.channel}`);
+        const nameElement = document.getElementById(`name-${channel.channel}`);
+        if (!statusElement || !nameElement) {
+            // 卡片尚未生成或固件通道数已变化
+            loadChannels();
+            continue;
+        }
 
-            // 更新连接状态
-            statusElement.className = `channel-status ${channel.connected ? 'connected' : 'disconnected'}`;
+        // 更新连接状态
+        statusElement.className = `channel-status ${channel.connected ? 'connected' : 'disconnected'}`;
 
-            // 更新通道名称
-            if (channel.name && channel.name !== `电脑${i}`) {
-                nameElement.textContent = channel.name;
-            }
+        // 更新通道名称
+        if (channel.name) {
+            nameElement.textContent = channel.name;
         }
     }
 }
@@ -337,6 +567,9 @@ function updateConnectionStatus(connected) {
  * 处理通道切换完成事件
  */
 function handleChannelSwitched(data) {
+    if (data.channel === currentChannel) {
+        return;
+    }
     currentChannel = data.channel;
     updateChannelDisplay();
     addLog('系统', `通道已切换到 ${data.channel}`);
@@ -376,11 +609,13 @@ function updateUI() {
  */
 function addKeyboardShortcuts() {
     document.addEventListener('keydown', function(event) {
-        // 数字键1-2切换通道
-        if (event.key >= '1' && event.key <= '2') {
+        // 数字键1-9切换通道
+        if (event.key >= '1' && event.key <= '9') {
             const channel = parseInt(event.key);
-            switchChannel(channel);
-            event.preventDefault();
+            if (channel <= channelCount) {
+                switchChannel(channel);
+                event.preventDefault();
+            }
         }
 
         // F5刷新状态
@@ -401,7 +636,7 @@ function addKeyboardShortcuts() {
  * 验证通道号是否有效
  */
 function isValidChannel(channel) {
-    return channel >= 1 && channel <= 2;
+    return channel >= 1 && channel <= channelCount;
 }
 
 /**
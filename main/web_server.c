@@ -4,38 +4,94 @@
  */
 
 #include <string.h>
+#include <strings.h>
+#include <unistd.h>
 #include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
 #include "esp_timer.h"
+#include "esp_mac.h"
 #include "cJSON.h"
 
-// WebSocket支持检查 - 简化版本，暂时禁用WebSocket
+// WebSocket支持检查 - 需要在sdkconfig中启用CONFIG_HTTPD_WS_SUPPORT
+#ifdef CONFIG_HTTPD_WS_SUPPORT
 #define WEBSOCKET_SUPPORTED 1
-
-// 如果需要启用WebSocket，请确保ESP-IDF版本支持并取消下面的注释
-// #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(4, 4, 0)
-// #define WEBSOCKET_SUPPORTED 1
-// #else
-// #define WEBSOCKET_SUPPORTED 0
-// #endif
+#else
+#define WEBSOCKET_SUPPORTED 0
+#endif
 
 #include "web_server.h"
 #include "kvm_controller.h"
 #include "wifi_manager.h"
 #include "uart_comm.h"
+#include "web_assets.h"
+#include "system_state.h"
+#include "response_cache.h"
+#include "json_writer.h"
+#include "http_metrics.h"
+#include "switch_trace.h"
+#include "event_bus.h"
+#include "api_router.h"
 
 static const char *TAG = "WEB_SERVER";
 
 // 服务器句柄
 static httpd_handle_t server = NULL;
 
-// WebSocket功能已禁用，删除相关变量
+#if WEBSOCKET_SUPPORTED
+// WebSocket客户端列表 (仅在httpd任务中修改: 握手、关闭回调、广播工作函数)
+#define WS_MAX_CLIENTS          WEB_SERVER_MAX_CLIENTS
+#define WS_MAX_FRAME_LEN        128
+static int s_ws_fds[WS_MAX_CLIENTS];
+static volatile int s_ws_client_count = 0;
+
+// 待发送消息 (由httpd_queue_work在httpd任务中发送后释放)
+typedef struct {
+    int fd;                 // 目标客户端，-1表示广播
+    size_t len;
+    char data[];
+} ws_broadcast_msg_t;
+#endif
+
+// GET接口的响应缓存，按状态代数失效 (仅在httpd任务中访问)
+// 状态与通道列表的大小随通道数增长，按单个通道的最大JSON长度预留
+#define STATUS_TAIL_RESERVE     32      // 为动态追加的运行时间字段预留
+#define STATUS_JSON_BASE_SIZE   768     // 状态中与通道数无关的部分
+#define CHANNEL_JSON_SIZE       96      // 单个通道条目
+#define STATUS_JSON_SIZE        (STATUS_JSON_BASE_SIZE + KVM_CHANNEL_MAX * CHANNEL_JSON_SIZE)
+static char s_status_cache_buf[STATUS_JSON_SIZE];
+static char s_channels_cache_buf[64 + KVM_CHANNEL_MAX * (CHANNEL_JSON_SIZE + 24)];
+static char s_wifi_cache_buf[384 + WIFI_KNOWN_MAX * 64];     // 已知网络条目不含密码
+#define WS_STATUS_MSG_SIZE      STATUS_JSON_SIZE    // WebSocket状态推送消息缓冲区
+
+// /api/status?since=<gen> 长轮询
+// 挂起的请求占用socket，数量需明显小于WEB_SERVER_MAX_CLIENTS
+#define LONGPOLL_MAX_WAITERS        3
+#define LONGPOLL_DEFAULT_TIMEOUT_S  25
+#define LONGPOLL_MAX_TIMEOUT_S      60
+#define LONGPOLL_TASK_STACK_SIZE    4096
 
-// 嵌入的网页文件
+typedef struct {
+    httpd_req_t *req;           // 通过http_metrics_async_handler_begin复制的异步请求
+    uint32_t since;
+    int64_t deadline_us;
+} longpoll_waiter_t;
+
+static longpoll_waiter_t s_longpoll_waiters[LONGPOLL_MAX_WAITERS];
+static SemaphoreHandle_t s_longpoll_mutex = NULL;
+static TaskHandle_t s_longpoll_task = NULL;
+static char s_longpoll_buf[STATUS_JSON_SIZE];   // 仅长轮询任务使用
+static response_cache_t s_status_cache = RESPONSE_CACHE_INIT(s_status_cache_buf);
+static response_cache_t s_channels_cache = RESPONSE_CACHE_INIT(s_channels_cache_buf);
+static response_cache_t s_wifi_cache = RESPONSE_CACHE_INIT(s_wifi_cache_buf);
+
+static bool s_events_subscribed = false;
+
+// 嵌入的网页文件 (原始版本)
 extern const uint8_t index_html_start[] asm("_binary_index_html_start");
 extern const uint8_t index_html_end[]   asm("_binary_index_html_end");
 extern const uint8_t style_css_start[] asm("_binary_style_css_start");
@@ -45,24 +101,89 @@ extern const uint8_t script_js_end[]   asm("_binary_script_js_end");
 extern const uint8_t favicon_ico_start[] asm("_binary_favicon_ico_start");
 extern const uint8_t favicon_ico_end[]   asm("_binary_favicon_ico_end");
 
+// 嵌入的网页文件 (构建时gzip压缩版本)
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[]   asm("_binary_index_html_gz_end");
+extern const uint8_t style_css_gz_start[] asm("_binary_style_css_gz_start");
+extern const uint8_t style_css_gz_end[]   asm("_binary_style_css_gz_end");
+extern const uint8_t script_js_gz_start[] asm("_binary_script_js_gz_start");
+extern const uint8_t script_js_gz_end[]   asm("_binary_script_js_gz_end");
+extern const uint8_t favicon_ico_gz_start[] asm("_binary_favicon_ico_gz_start");
+extern const uint8_t favicon_ico_gz_end[]   asm("_binary_favicon_ico_gz_end");
+
+// 静态资源描述
+typedef struct {
+    const uint8_t *start;
+    const uint8_t *end;
+    const uint8_t *gz_start;
+    const uint8_t *gz_end;
+    const char *content_type;
+    const char *etag;
+    const char *gz_etag;
+} web_asset_t;
+
+static const web_asset_t s_index_asset = {
+    index_html_start, index_html_end, index_html_gz_start, index_html_gz_end,
+    "text/html", WEB_ASSET_INDEX_HTML_ETAG, WEB_ASSET_INDEX_HTML_GZ_ETAG
+};
+
+static const web_asset_t s_style_asset = {
+    style_css_start, style_css_end, style_css_gz_start, style_css_gz_end,
+    "text/css", WEB_ASSET_STYLE_CSS_ETAG, WEB_ASSET_STYLE_CSS_GZ_ETAG
+};
+
+static const web_asset_t s_script_asset = {
+    script_js_start, script_js_end, script_js_gz_start, script_js_gz_end,
+    "application/javascript", WEB_ASSET_SCRIPT_JS_ETAG, WEB_ASSET_SCRIPT_JS_GZ_ETAG
+};
+
+static const web_asset_t s_favicon_asset = {
+    favicon_ico_start, favicon_ico_end, favicon_ico_gz_start, favicon_ico_gz_end,
+    "image/x-icon", WEB_ASSET_FAVICON_ICO_ETAG, WEB_ASSET_FAVICON_ICO_GZ_ETAG
+};
+
 /**
- * 发送HTTP响应
+ * 设置API响应的通用头部
  */
-static esp_err_t send_response(httpd_req_t *req, const char *data, size_t len, const char *content_type)
+static void set_common_headers(httpd_req_t *req, const char *content_type)
 {
     httpd_resp_set_type(req, content_type);
     httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
+}
+
+/**
+ * 设置不允许跨域访问的API响应头部 (修改设备配置的接口)
+ */
+static void set_private_headers(httpd_req_t *req, const char *content_type)
+{
+    httpd_resp_set_type(req, content_type);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+}
+
+/**
+ * 发送HTTP响应
+ */
+static esp_err_t send_response(httpd_req_t *req, const char *data, size_t len, const char *content_type)
+{
+    set_common_headers(req, content_type);
     return httpd_resp_send(req, data, len);
 }
 
 /**
  * OPTIONS请求处理器（用于CORS预检）
+ * /api/wifi可修改STA凭据，不回复允许跨域的头部，其他网页的脚本无法通过预检
  */
 static esp_err_t options_handler(httpd_req_t *req)
 {
+    const char *query = strchr(req->uri, '?');
+    size_t len = query != NULL ? (size_t)(query - req->uri) : strlen(req->uri);
+    if (len == strlen(API_WIFI) && strncmp(req->uri, API_WIFI, len) == 0) {
+        httpd_resp_send(req, "", 0);
+        return ESP_OK;
+    }
     httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Methods", "GET, POST, OPTIONS");
     httpd_resp_set_hdr(req, "Access-Control-Allow-Headers", "Content-Type");
@@ -70,10 +191,132 @@ static esp_err_t options_handler(httpd_req_t *req)
     return ESP_OK;
 }
 
-// WebSocket处理器已删除，功能完全禁用
+#if WEBSOCKET_SUPPORTED
+/**
+ * 记录新的WebSocket客户端
+ */
+static void ws_add_client(int fd)
+{
+    for (int i = 0; i < s_ws_client_count; i++) {
+        if (s_ws_fds[i] == fd) {
+            return;
+        }
+    }
+    if (s_ws_client_count < WS_MAX_CLIENTS) {
+        s_ws_fds[s_ws_client_count++] = fd;
+        ESP_LOGI(TAG, "WebSocket客户端连接: fd=%d (共%d个)", fd, s_ws_client_count);
+    }
+}
+
+/**
+ * 移除WebSocket客户端
+ */
+static void ws_remove_client(int fd)
+{
+    for (int i = 0; i < s_ws_client_count; i++) {
+        if (s_ws_fds[i] == fd) {
+            s_ws_fds[i] = s_ws_fds[--s_ws_client_count];
+            ESP_LOGI(TAG, "WebSocket客户端断开: fd=%d (剩余%d个)", fd, s_ws_client_count);
+            return;
+        }
+    }
+}
+
+/**
+ * 会话关闭回调 (设置close_fn后需要自行关闭socket)
+ */
+static void ws_session_close(httpd_handle_t hd, int sockfd)
+{
+    ws_remove_client(sockfd);
+    close(sockfd);
+}
+
+/**
+ * 广播工作函数，在httpd任务中执行
+ */
+static void ws_broadcast_work(void *arg)
+{
+    ws_broadcast_msg_t *msg = (ws_broadcast_msg_t *)arg;
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)msg->data,
+        .len = msg->len
+    };
+
+    // 倒序遍历，发送失败时可以安全移除当前客户端
+    for (int i = s_ws_client_count - 1; i >= 0; i--) {
+        int fd = s_ws_fds[i];
+        if (msg->fd >= 0 && msg->fd != fd) {
+            continue;
+        }
+        if (server == NULL || httpd_ws_get_fd_info(server, fd) != HTTPD_WS_CLIENT_WEBSOCKET ||
+            httpd_ws_send_frame_async(server, fd, &frame) != ESP_OK) {
+            ESP_LOGW(TAG, "WebSocket发送失败，移除客户端 fd=%d", fd);
+            ws_remove_client(fd);
+        }
+    }
+
+    free(msg);
+}
+
+/**
+ * 向单个WebSocket客户端发送文本
+ */
+static esp_err_t ws_send_text(httpd_req_t *req, const char *text)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)text,
+        .len = strlen(text)
+    };
+    return httpd_ws_send_frame(req, &frame);
+}
+
+/**
+ * 将文本消息排队到httpd任务发送，可在任意任务中调用
+ * @param fd 目标客户端，-1表示广播给所有客户端
+ */
+static esp_err_t ws_queue_text(int fd, const char *text)
+{
+    if (server == NULL || s_ws_client_count == 0) {
+        return ESP_OK;
+    }
+
+    size_t len = strlen(text);
+    ws_broadcast_msg_t *msg = malloc(sizeof(ws_broadcast_msg_t) + len + 1);
+    if (msg == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    msg->fd = fd;
+    msg->len = len;
+    memcpy(msg->data, text, len + 1);
+
+    esp_err_t ret = httpd_queue_work(server, ws_broadcast_work, msg);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "WebSocket消息排队失败: %s", esp_err_to_name(ret));
+        free(msg);
+    }
+    return ret;
+}
+#endif
+
+/**
+ * 获取WebSocket客户端数量
+ */
+int web_server_get_ws_client_count(void)
+{
+#if WEBSOCKET_SUPPORTED
+    return s_ws_client_count;
+#else
+    return 0;
+#endif
+}
 
 /**
  * 向所有WebSocket客户端广播消息
+ * 消息被复制后交给httpd任务发送，调用者不会被阻塞
  */
 esp_err_t web_server_broadcast_ws_message(const char *message)
 {
@@ -81,142 +324,648 @@ esp_err_t web_server_broadcast_ws_message(const char *message)
         return ESP_ERR_INVALID_ARG;
     }
 
-    // WebSocket功能已禁用，只记录日志
-    ESP_LOGD(TAG, "WebSocket已禁用，跳过消息广播: %s", message);
+#if WEBSOCKET_SUPPORTED
+    return ws_queue_text(-1, message);
+#else
+    ESP_LOGD(TAG, "WebSocket未启用，跳过消息广播: %s", message);
     return ESP_OK;
+#endif
 }
 
 /**
- * 主页处理器
+ * 检查请求头是否包含指定的标记 (如 Accept-Encoding 中的 gzip、If-None-Match 中的 ETag)
  */
-static esp_err_t index_handler(httpd_req_t *req)
+static bool request_header_contains(httpd_req_t *req, const char *field, const char *token)
 {
-    const size_t index_html_len = index_html_end - index_html_start;
-    return send_response(req, (const char*)index_html_start, index_html_len, "text/html");
+    char value[128];
+    size_t len = httpd_req_get_hdr_value_len(req, field);
+    if (len == 0 || len >= sizeof(value)) {
+        return false;
+    }
+    if (httpd_req_get_hdr_value_str(req, field, value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+    return strstr(value, token) != NULL;
 }
 
 /**
- * CSS文件处理器
+ * 请求正文是否为JSON (Content-Type: application/json，可带参数)
  */
-static esp_err_t style_handler(httpd_req_t *req)
+static bool request_is_json(httpd_req_t *req)
 {
-    const size_t style_css_len = style_css_end - style_css_start;
-    return send_response(req, (const char*)style_css_start, style_css_len, "text/css");
+    static const char json_type[] = "application/json";
+    char value[64];
+    size_t len = httpd_req_get_hdr_value_len(req, "Content-Type");
+    if (len == 0 || len >= sizeof(value) ||
+        httpd_req_get_hdr_value_str(req, "Content-Type", value, sizeof(value)) != ESP_OK) {
+        return false;
+    }
+    return strncasecmp(value, json_type, sizeof(json_type) - 1) == 0 &&
+           (value[sizeof(json_type) - 1] == '\0' || value[sizeof(json_type) - 1] == ';' ||
+            value[sizeof(json_type) - 1] == ' ');
 }
 
 /**
- * JavaScript文件处理器
+ * 静态资源处理器
+ * 客户端支持时发送预压缩的gzip版本，ETag匹配时返回304
  */
-static esp_err_t script_handler(httpd_req_t *req)
+static esp_err_t static_asset_handler(httpd_req_t *req)
 {
-    const size_t script_js_len = script_js_end - script_js_start;
-    return send_response(req, (const char*)script_js_start, script_js_len, "application/javascript");
+    const web_asset_t *asset = (const web_asset_t *)req->user_ctx;
+    bool use_gzip = request_header_contains(req, "Accept-Encoding", "gzip");
+    const char *etag = use_gzip ? asset->gz_etag : asset->etag;
+
+    // 内容哈希在构建时确定，浏览器每次只需重新验证
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    httpd_resp_set_hdr(req, "ETag", etag);
+    httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+
+    if (request_header_contains(req, "If-None-Match", etag)) {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, asset->content_type);
+    if (use_gzip) {
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+        return httpd_resp_send(req, (const char *)asset->gz_start, asset->gz_end - asset->gz_start);
+    }
+    return httpd_resp_send(req, (const char *)asset->start, asset->end - asset->start);
 }
 
+// JSON构建函数: 向写入器输出一个完整的响应对象，ctx为调用者传入的参数
+typedef void (*json_build_fn_t)(json_writer_t *w, void *ctx);
+
 /**
- * 图标文件处理器
+ * 写入器分块输出回调 (httpd_resp_send_chunk)
  */
-static esp_err_t favicon_handler(httpd_req_t *req)
+static int httpd_chunk_flush(void *ctx, const char *data, size_t len)
 {
-    const size_t favicon_ico_len = favicon_ico_end - favicon_ico_start;
-    return send_response(req, (const char*)favicon_ico_start, favicon_ico_len, "image/x-icon");
+    return httpd_resp_send_chunk((httpd_req_t *)ctx, data, len) == ESP_OK ? 0 : -1;
 }
 
 /**
- * 系统状态API处理器
+ * 以分块编码流式发送JSON响应 (用于超出缓存容量的响应)
  */
-static esp_err_t api_status_handler(httpd_req_t *req)
+static esp_err_t send_json_stream(httpd_req_t *req, json_build_fn_t build_fn, void *ctx)
 {
-    cJSON *json = cJSON_CreateObject();
-    cJSON *data = cJSON_CreateObject();
-    
-    // 获取KVM状态
-    const kvm_status_t *kvm_status = kvm_controller_get_status();
-    cJSON_AddNumberToObject(data, "current_channel", kvm_status->current_channel);
+    char chunk[256];
+    json_writer_t w;
+
+    set_common_headers(req, "application/json");
+    json_writer_init_stream(&w, chunk, sizeof(chunk), httpd_chunk_flush, req);
+    build_fn(&w, ctx);
+    if (json_writer_finish(&w) < 0) {
+        ESP_LOGE(TAG, "JSON流式发送失败");
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+/**
+ * 按状态代数刷新响应缓存
+ * 缓存有效时直接返回，否则调用build_fn把响应直接写入缓存区
+ * 缓存内容只由状态代数决定，build_fn的ctx为NULL
+ * @param reserve 缓存区末尾为动态字段预留的字节数
+ * @return true 缓存可用
+ */
+static bool refresh_response_cache(response_cache_t *cache, uint32_t generation,
+                                   size_t reserve, json_build_fn_t build_fn)
+{
+    if (response_cache_is_fresh(cache, generation)) {
+        return true;
+    }
+
+    json_writer_t w;
+    json_writer_init(&w, cache->buf, cache->capacity - reserve);
+    build_fn(&w, NULL);
+    int len = json_writer_finish(&w);
+    if (len < 0) {
+        ESP_LOGW(TAG, "响应超出缓存容量 (%d字节)，改用流式发送", (int)cache->capacity);
+        response_cache_invalidate(cache);
+        return false;
+    }
+    response_cache_commit(cache, generation, len);
+    return true;
+}
+
+/**
+ * 写入统一响应头部字段并打开根对象: {"code":..,"message":..
+ */
+static void write_response_begin(json_writer_t *w, int code, const char *message)
+{
+    json_writer_begin_object(w, NULL);
+    json_writer_add_int(w, "code", code);
+    json_writer_add_string(w, "message", message);
+}
+
+/**
+ * 写入系统状态字段 (/api/status 与 WebSocket status_update 共用)
+ * 通道列表只包含状态代数since之后变化的通道，since为0时包含全部通道，
+ * 因此增量响应的大小与变化的通道数成正比，与通道总数无关
+ * @param include_uptime 是否包含运行时间 (HTTP缓存路径在发送时追加)
+ * @param since 客户端已有状态的代数，0表示完整状态
+ */
+static void write_status_fields(json_writer_t *w, bool include_uptime, uint32_t since)
+{
+    // 获取KVM状态 (一次快照，当前通道、统计与通道列表来自同一时刻)
+    kvm_status_t kvm_status;
+    kvm_controller_get_status_snapshot(&kvm_status);
+    json_writer_add_int(w, "current_channel", kvm_status.current_channel);
     
     // 获取WiFi状态
-    const wifi_status_t *wifi_status = wifi_manager_get_status();
-    cJSON *wifi_obj = cJSON_CreateObject();
-    cJSON_AddBoolToObject(wifi_obj, "connected", wifi_status->sta_connected);
-    cJSON_AddStringToObject(wifi_obj, "ssid", wifi_status->sta_ssid);
-    cJSON_AddStringToObject(wifi_obj, "ip", wifi_status->sta_ip);
-    cJSON_AddNumberToObject(wifi_obj, "rssi", wifi_status->sta_rssi);
-    cJSON_AddItemToObject(data, "wifi_status", wifi_obj);
+    wifi_status_t wifi_status;
+    wifi_manager_get_status_snapshot(&wifi_status);
+    json_writer_begin_object(w, "wifi_status");
+    json_writer_add_bool(w, "connected", wifi_status.sta_connected);
+    json_writer_add_string(w, "ssid", wifi_status.sta_ssid);
+    json_writer_add_string(w, "ip", wifi_status.sta_ip);
+    json_writer_add_int(w, "rssi", wifi_status.sta_rssi);
+    json_writer_add_int(w, "link_quality", wifi_status.sta_link_quality);
+    json_writer_end_object(w);
     
     // 获取通信状态
-    const uart_comm_status_t *comm_status = uart_comm_get_status();
-    cJSON *comm_obj = cJSON_CreateObject();
-    cJSON_AddBoolToObject(comm_obj, "connected", comm_status->connected);
-    cJSON_AddNumberToObject(comm_obj, "tx_count", comm_status->tx_count);
-    cJSON_AddNumberToObject(comm_obj, "rx_count", comm_status->rx_count);
-    cJSON_AddNumberToObject(comm_obj, "error_count", comm_status->error_count);
-    cJSON_AddItemToObject(data, "comm_status", comm_obj);
+    uart_comm_status_t comm_status;
+    uart_comm_get_status_snapshot(&comm_status);
+    json_writer_begin_object(w, "comm_status");
+    json_writer_add_bool(w, "connected", comm_status.connected);
+    json_writer_add_uint(w, "tx_count", comm_status.tx_count);
+    json_writer_add_uint(w, "rx_count", comm_status.rx_count);
+    json_writer_add_uint(w, "error_count", comm_status.error_count);
+    json_writer_add_uint(w, "timeout_count", comm_status.timeout_count);
+    json_writer_add_uint(w, "retransmit_count", comm_status.retransmit_count);
+    json_writer_add_uint(w, "srtt_ms", comm_status.srtt_ms);
+    json_writer_add_uint(w, "rto_ms", comm_status.rto_ms);
+    json_writer_add_uint(w, "baud_rate", comm_status.baud_rate);
+    json_writer_add_uint(w, "last_response_time", comm_status.last_response_time);
+    json_writer_end_object(w);
     
     // 获取IP地址
     char ip_str[16];
     if (wifi_manager_get_ip(ip_str, sizeof(ip_str)) == ESP_OK) {
-        cJSON_AddStringToObject(data, "ip_address", ip_str);
+        json_writer_add_string(w, "ip_address", ip_str);
     }
     
-    // 获取运行时间
-    uint32_t uptime = esp_timer_get_time() / 1000000; // 转换为秒
-    cJSON_AddNumberToObject(data, "uptime", uptime);
-    
     // 获取统计信息
-    cJSON *stats = cJSON_CreateObject();
-    cJSON_AddNumberToObject(stats, "total_switches", kvm_status->total_switches);
-    cJSON_AddNumberToObject(stats, "error_count", kvm_status->error_count);
-    if (kvm_status->total_switches > 0) {
-        // 计算最后切换时间（这里简化处理）
-        cJSON_AddNumberToObject(stats, "last_switch_time", esp_timer_get_time() / 1000000);
-    }
-    cJSON_AddItemToObject(data, "stats", stats);
+    json_writer_begin_object(w, "stats");
+    json_writer_add_uint(w, "total_switches", kvm_status.total_switches);
+    json_writer_add_uint(w, "error_count", kvm_status.error_count);
+    json_writer_add_uint(w, "coalesced_switches", kvm_status.coalesced_switches);
+    if (kvm_status.total_switches > 0 && kvm_controller_is_valid_channel(kvm_status.current_channel)) {
+        // 最后切换时间 (开机后秒数)
+        json_writer_add_uint(w, "last_switch_time",
+                             kvm_status.channels[kvm_status.current_channel - 1].last_switch_time);
+    }
+    json_writer_end_object(w);
     
-    // 获取通道信息
-    cJSON *channels = cJSON_CreateArray();
-    for (int i = 1; i <= KVM_CHANNEL_MAX; i++) {
-        const kvm_channel_info_t *channel_info = kvm_controller_get_channel_info(i);
-        if (channel_info) {
-            cJSON *channel = cJSON_CreateObject();
-            cJSON_AddNumberToObject(channel, "channel", channel_info->channel);
-            cJSON_AddBoolToObject(channel, "active", channel_info->active);
-            cJSON_AddBoolToObject(channel, "connected", channel_info->connected);
-            cJSON_AddStringToObject(channel, "name", channel_info->name);
-            cJSON_AddItemToArray(channels, channel);
+    // 获取通道信息 (增量时只写变化的通道)
+    json_writer_add_bool(w, "channels_delta", since != 0);
+    json_writer_begin_array(w, "channels");
+    for (int i = 0; i < KVM_CHANNEL_MAX; i++) {
+        const kvm_channel_info_t *channel_info = &kvm_status.channels[i];
+        if (since != 0 && channel_info->changed_gen <= since) {
+            continue;
         }
+        json_writer_begin_object(w, NULL);
+        json_writer_add_int(w, "channel", channel_info->channel);
+        json_writer_add_bool(w, "active", channel_info->active);
+        json_writer_add_bool(w, "connected", channel_info->connected);
+        json_writer_add_string(w, "name", channel_info->name);
+        json_writer_end_object(w);
     }
-    cJSON_AddItemToObject(data, "channels", channels);
-    
-    // 构建响应
-    cJSON_AddNumberToObject(json, "code", 0);
-    cJSON_AddStringToObject(json, "message", "success");
-    cJSON_AddItemToObject(json, "data", data);
-    
-    char *json_string = cJSON_Print(json);
-    esp_err_t ret = send_response(req, json_string, strlen(json_string), "application/json");
-    
-    free(json_string);
-    cJSON_Delete(json);
-    
+    json_writer_end_array(w);
+
+    // 获取运行时间 (每秒变化，放在最后)
+    if (include_uptime) {
+        uint32_t uptime = esp_timer_get_time() / 1000000; // 转换为秒
+        json_writer_add_uint(w, "uptime", uptime);
+    }
+}
+
+/**
+ * 构建/api/status响应 (不含运行时间)
+ */
+static void build_status_response(json_writer_t *w, void *ctx)
+{
+    write_response_begin(w, 0, "success");
+    json_writer_begin_object(w, "data");
+    write_status_fields(w, false, 0);
+    json_writer_end_object(w);
+    json_writer_end_object(w);
+}
+
+/**
+ * 构建含运行时间的/api/status响应
+ * @param ctx 指向客户端已有状态的代数 (uint32_t)，NULL表示完整状态
+ */
+static void build_status_delta_response(json_writer_t *w, void *ctx)
+{
+    uint32_t since = ctx != NULL ? *(const uint32_t *)ctx : 0;
+
+    write_response_begin(w, 0, "success");
+    json_writer_begin_object(w, "data");
+    write_status_fields(w, true, since);
+    json_writer_end_object(w);
+    json_writer_end_object(w);
+}
+
+/**
+ * 格式化状态ETag (状态代数)
+ * 响应中的运行时间不参与比较，因此使用弱校验器
+ */
+static void format_status_etag(char *buf, size_t size, uint32_t generation)
+{
+    snprintf(buf, size, "W/\"%lu\"", (unsigned long)generation);
+}
+
+/**
+ * 发送最新状态 (普通请求与长轮询立即返回的情况)
+ * 状态未变化时直接发送缓存内容，仅在末尾就地追加运行时间
+ */
+static esp_err_t send_status(httpd_req_t *req, uint32_t generation)
+{
+    char etag[16];
+    format_status_etag(etag, sizeof(etag), generation);
+    httpd_resp_set_hdr(req, "ETag", etag);
+
+    if (!refresh_response_cache(&s_status_cache, generation, STATUS_TAIL_RESERVE, build_status_response)) {
+        return send_json_stream(req, build_status_delta_response, NULL);
+    }
+
+    // 缓存内容以"}}"结尾，覆盖后追加运行时间字段
+    size_t len = s_status_cache.len - 2;
+    uint32_t uptime = esp_timer_get_time() / 1000000; // 转换为秒
+    len += snprintf(s_status_cache.buf + len, s_status_cache.capacity - len,
+                    ",\"uptime\":%lu}}", (unsigned long)uptime);
+
+    return send_response(req, s_status_cache.buf, len, "application/json");
+}
+
+/**
+ * 发送自代数since以来的增量状态 (流式发送，不经过缓存)
+ */
+static esp_err_t send_status_delta(httpd_req_t *req, uint32_t since, uint32_t generation)
+{
+    char etag[16];
+    format_status_etag(etag, sizeof(etag), generation);
+    httpd_resp_set_hdr(req, "ETag", etag);
+
+    return send_json_stream(req, build_status_delta_response, &since);
+}
+
+/**
+ * 状态变化监听器: 唤醒长轮询任务
+ */
+static void longpoll_on_state_changed(uint32_t generation, void *arg)
+{
+    if (s_longpoll_task != NULL) {
+        xTaskNotifyGive(s_longpoll_task);
+    }
+}
+
+/**
+ * 挂起长轮询请求，状态变化或超时后由长轮询任务回复
+ * @return ESP_OK 已挂起，ESP_ERR_NO_MEM 等待队列已满
+ */
+static esp_err_t longpoll_park(httpd_req_t *req, uint32_t since, int timeout_s)
+{
+    if (s_longpoll_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    xSemaphoreTake(s_longpoll_mutex, portMAX_DELAY);
+    int slot = -1;
+    for (int i = 0; i < LONGPOLL_MAX_WAITERS; i++) {
+        if (s_longpoll_waiters[i].req == NULL) {
+            slot = i;
+            break;
+        }
+    }
+    if (slot < 0) {
+        xSemaphoreGive(s_longpoll_mutex);
+        return ESP_ERR_NO_MEM;
+    }
+
+    httpd_req_t *async_req = NULL;
+    esp_err_t ret = http_metrics_async_handler_begin(req, &async_req);
+    if (ret == ESP_OK) {
+        s_longpoll_waiters[slot].req = async_req;
+        s_longpoll_waiters[slot].since = since;
+        s_longpoll_waiters[slot].deadline_us = esp_timer_get_time() + (int64_t)timeout_s * 1000000;
+    }
+    xSemaphoreGive(s_longpoll_mutex);
+
+    // 挂起前状态可能已经变化，让长轮询任务重新检查一次
+    xTaskNotifyGive(s_longpoll_task);
     return ret;
 }
 
 /**
- * 通道切换API处理器 (简化版)
- * 调用切换后立即返回成功
+ * 回复一个长轮询请求并结束异步处理
  */
-static esp_err_t api_switch_handler(httpd_req_t *req)
+static void longpoll_reply(httpd_req_t *req, const char *body, int len, uint32_t generation)
 {
-    // 删除调试信息，按用户要求简化日志
+    char etag[16];
+    format_status_etag(etag, sizeof(etag), generation);
+    httpd_resp_set_hdr(req, "ETag", etag);
 
-    int channel = -1; // 初始化为无效值
+    if (len < 0) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Status response too large");
+    } else {
+        send_response(req, body, len, "application/json");
+    }
+    http_metrics_async_handler_complete(req);
+}
+
+/**
+ * 长轮询任务
+ * 状态代数变化或请求超时时，统一构建一次状态并回复所有就绪的请求
+ */
+static void longpoll_task(void *pvParameters)
+{
+    while (1) {
+        // 计算最近的超时时间
+        int64_t now = esp_timer_get_time();
+        int64_t nearest = INT64_MAX;
+        xSemaphoreTake(s_longpoll_mutex, portMAX_DELAY);
+        for (int i = 0; i < LONGPOLL_MAX_WAITERS; i++) {
+            if (s_longpoll_waiters[i].req != NULL && s_longpoll_waiters[i].deadline_us < nearest) {
+                nearest = s_longpoll_waiters[i].deadline_us;
+            }
+        }
+        xSemaphoreGive(s_longpoll_mutex);
+
+        TickType_t wait = portMAX_DELAY;
+        if (nearest != INT64_MAX) {
+            wait = nearest > now ? pdMS_TO_TICKS((nearest - now) / 1000) + 1 : 0;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        // 取出状态已变化或已超时的请求
+        longpoll_waiter_t ready[LONGPOLL_MAX_WAITERS];
+        int ready_count = 0;
+        uint32_t generation = system_state_get_generation();
+        now = esp_timer_get_time();
+        xSemaphoreTake(s_longpoll_mutex, portMAX_DELAY);
+        for (int i = 0; i < LONGPOLL_MAX_WAITERS; i++) {
+            longpoll_waiter_t *waiter = &s_longpoll_waiters[i];
+            if (waiter->req != NULL && (waiter->since != generation || waiter->deadline_us <= now)) {
+                ready[ready_count++] = *waiter;
+                waiter->req = NULL;
+            }
+        }
+        xSemaphoreGive(s_longpoll_mutex);
+
+        if (ready_count == 0) {
+            continue;
+        }
+
+        // 回复自各请求的代数以来的增量 (超时的请求通道列表为空)，客户端用新的ETag继续轮询
+        // 代数相同的请求共用一次构建
+        int len = -1;
+        uint32_t built_since = 0;
+        for (int i = 0; i < ready_count; i++) {
+            if (i == 0 || ready[i].since != built_since) {
+                json_writer_t w;
+                json_writer_init(&w, s_longpoll_buf, sizeof(s_longpoll_buf));
+                build_status_delta_response(&w, &ready[i].since);
+                len = json_writer_finish(&w);
+                built_since = ready[i].since;
+            }
+            longpoll_reply(ready[i].req, s_longpoll_buf, len, generation);
+        }
+    }
+}
+
+/**
+ * 系统状态API处理器
+ * 支持:
+ *   If-None-Match: W/"<gen>"   状态未变化时返回304
+ *   ?since=<gen>[&timeout=<s>] 长轮询，状态变化或超时后才返回
+ */
+static esp_err_t api_status_handler(httpd_req_t *req)
+{
+    uint32_t generation = system_state_get_generation();
+
+    // 条件请求
+    char etag[16];
+    format_status_etag(etag, sizeof(etag), generation);
+    if (request_header_contains(req, "If-None-Match", etag + 2)) {
+        set_common_headers(req, "application/json");
+        httpd_resp_set_hdr(req, "ETag", etag);
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    // 长轮询请求
+    char query[48];
+    char param[16];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "since", param, sizeof(param)) == ESP_OK) {
+        uint32_t since = strtoul(param, NULL, 10);
+        if (since == generation) {
+            int timeout_s = LONGPOLL_DEFAULT_TIMEOUT_S;
+            if (httpd_query_key_value(query, "timeout", param, sizeof(param)) == ESP_OK) {
+                timeout_s = MAX(1, MIN(atoi(param), LONGPOLL_MAX_TIMEOUT_S));
+            }
+            if (longpoll_park(req, since, timeout_s) == ESP_OK) {
+                return ESP_OK;
+            }
+            // 等待队列已满时直接返回当前状态，客户端稍后重试
+            ESP_LOGW(TAG, "长轮询等待队列已满");
+        } else if (since != 0 && since < generation) {
+            // 客户端已有较早的状态，只返回之后变化的通道 (代数大于当前值说明设备已重启，返回完整状态)
+            return send_status_delta(req, since, generation);
+        }
+    }
+
+    return send_status(req, generation);
+}
+
+/**
+ * 格式化WebSocket状态推送消息
+ * @return 消息长度，<0 表示缓冲区不足
+ */
+static int format_status_update(char *buf, size_t size, uint32_t since)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_add_string(&w, "type", "status_update");
+    json_writer_begin_object(&w, "data");
+    write_status_fields(&w, true, since);
+    json_writer_end_object(&w);
+    json_writer_end_object(&w);
+    return json_writer_finish(&w);
+}
+
+/**
+ * 广播系统状态
+ * 通道列表只包含上次广播之后变化的通道 (新客户端连接时通过get_status获取完整状态)
+ */
+esp_err_t web_server_broadcast_status(void)
+{
+    // 仅在事件总线任务中调用
+    static char message[WS_STATUS_MSG_SIZE];
+    static uint32_t s_last_broadcast_gen = 0;
+
+    if (web_server_get_ws_client_count() == 0) {
+        s_last_broadcast_gen = 0;
+        return ESP_OK;
+    }
+
+    uint32_t generation = system_state_get_generation();
+    if (format_status_update(message, sizeof(message), s_last_broadcast_gen) < 0) {
+        ESP_LOGE(TAG, "状态推送消息过长");
+        return ESP_ERR_NO_MEM;
+    }
+    s_last_broadcast_gen = generation;
+    return web_server_broadcast_ws_message(message);
+}
+
+/**
+ * 广播通道切换完成通知
+ */
+static void broadcast_channel_switched(int channel)
+{
+    char message[64];
+    snprintf(message, sizeof(message),
+             "{\"type\":\"channel_switched\",\"data\":{\"channel\":%d}}", channel);
+    web_server_broadcast_ws_message(message);
+}
+
+/**
+ * 事件总线订阅者: 把状态变化即时推送给WebSocket客户端 (在事件总线任务中执行)
+ */
+static void web_server_on_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    if (web_server_get_ws_client_count() == 0) {
+        return;
+    }
+    if (id == KVM_EVENT_CHANNEL_SWITCHED) {
+        const kvm_event_switch_t *event = (const kvm_event_switch_t *)data;
+        broadcast_channel_switched(event->channel);
+    }
+    web_server_broadcast_status();
+}
+
+/**
+ * 事件总线指标收集器: 按事件类型输出分发和丢弃次数
+ */
+static void event_bus_metrics_collect(http_metrics_writer_t *w, void *arg)
+{
+    http_metrics_printf(w, "# HELP kvm_events_total Events delivered on the internal event bus.\n"
+                           "# TYPE kvm_events_total counter\n");
+    for (int id = 0; id < KVM_EVENT_MAX; id++) {
+        uint32_t delivered, dropped;
+        event_bus_get_stats(id, &delivered, &dropped);
+        http_metrics_printf(w, "kvm_events_total{event=\"%s\"} %lu\n",
+                            event_bus_event_name(id), (unsigned long)delivered);
+    }
+    http_metrics_printf(w, "# HELP kvm_events_dropped_total Events dropped because the bus queue was full.\n"
+                           "# TYPE kvm_events_dropped_total counter\n");
+    for (int id = 0; id < KVM_EVENT_MAX; id++) {
+        uint32_t delivered, dropped;
+        event_bus_get_stats(id, &delivered, &dropped);
+        http_metrics_printf(w, "kvm_events_dropped_total{event=\"%s\"} %lu\n",
+                            event_bus_event_name(id), (unsigned long)dropped);
+    }
+}
+
+/**
+ * 写入切换结果响应
+ */
+static int format_switch_result(char *buf, size_t size, const kvm_switch_job_info_t *job)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    if (job->state == KVM_JOB_COALESCED) {
+        write_response_begin(&w, 0, "Superseded by a newer switch request");
+    } else if (job->result == ESP_OK) {
+        write_response_begin(&w, 0, "Switch command sent successfully");
+    } else {
+        write_response_begin(&w, 1, "Switch failed");
+    }
+    json_writer_add_int(&w, "channel", job->channel);
+    json_writer_add_uint(&w, "job_id", job->id);
+    if (job->state == KVM_JOB_COALESCED) {
+        json_writer_add_uint(&w, "superseded_by", job->superseded_by);
+    }
+    json_writer_end_object(&w);
+    return json_writer_finish(&w);
+}
 
-    // 从URL路径解析通道号 (例如 /api/switch/2)
-    const char *uri = req->uri;
-    const char *channel_pos = strrchr(uri, '/');
-    if (channel_pos && strlen(channel_pos) > 1) {
-        channel = atoi(channel_pos + 1);
+// 等待模式的切换结果 (由httpd_queue_work在httpd任务中回复后释放)
+typedef struct {
+    httpd_req_t *req;
+    int len;                    // 小于0表示结果过长
+    char body[160];
+} switch_http_reply_t;
+
+/**
+ * 回复挂起的切换请求并结束异步请求
+ */
+static void switch_http_reply(switch_http_reply_t *reply)
+{
+    if (reply->len < 0) {
+        httpd_resp_send_err(reply->req, HTTPD_500_INTERNAL_SERVER_ERROR, "Response too large");
     } else {
+        send_response(reply->req, reply->body, reply->len, "application/json");
+    }
+    http_metrics_async_handler_complete(reply->req);
+}
+
+static void switch_http_reply_work(void *arg)
+{
+    switch_http_reply_t *reply = (switch_http_reply_t *)arg;
+    switch_http_reply(reply);
+    free(reply);
+}
+
+/**
+ * 切换完成回调 (等待模式)
+ * 在切换工作任务 (或被取代时在提交者) 中调用，只格式化结果，交给httpd任务发送，
+ * 客户端接收慢时不会阻塞切换流程
+ */
+static void switch_http_done(const kvm_switch_job_info_t *job, void *arg)
+{
+    switch_http_reply_t *reply = malloc(sizeof(*reply));
+    if (reply != NULL) {
+        reply->req = (httpd_req_t *)arg;
+        reply->len = format_switch_result(reply->body, sizeof(reply->body), job);
+        if (server != NULL && httpd_queue_work(server, switch_http_reply_work, reply) == ESP_OK) {
+            return;
+        }
+        free(reply);
+    }
+
+    // 无法排队 (内存不足或服务器停止) 时直接回复，避免请求永远挂起
+    ESP_LOGW(TAG, "切换结果排队失败，直接回复");
+    switch_http_reply_t fallback = { .req = (httpd_req_t *)arg };
+    fallback.len = format_switch_result(fallback.body, sizeof(fallback.body), job);
+    switch_http_reply(&fallback);
+}
+
+/**
+ * 通道切换API处理器
+ * 切换由KVM控制器的工作任务执行，httpd任务不会等待UART
+ *   默认(等待模式): 请求挂起，切换完成后返回结果
+ *   ?async=1 或 {"async":true}: 立即返回202和job_id，通过GET /api/switch?job=<id>查询
+ */
+static esp_err_t api_switch_handler(httpd_req_t *req)
+{
+    int64_t received_us = esp_timer_get_time();     // 切换延迟追踪的起点
+    int channel = -1; // 初始化为无效值
+    bool async_mode = false;
+
+    // 从URL路径参数解析通道号 (例如 /api/switch/2)，无效的通道号保持-1
+    long path_channel = 0;
+    esp_err_t param_ret = api_router_get_param_int(req, "n", &path_channel);
+    if (param_ret == ESP_OK) {
+        if (path_channel >= 1 && path_channel <= KVM_CHANNEL_MAX) {
+            channel = (int)path_channel;
+        }
+    } else if (param_ret == ESP_ERR_NOT_FOUND) {
         // 从POST数据解析
         char content[100];
         int content_len = httpd_req_recv(req, content, sizeof(content) - 1);
@@ -228,54 +977,163 @@ static esp_err_t api_switch_handler(httpd_req_t *req)
                 if (cJSON_IsNumber(channel_json)) {
                     channel = channel_json->valueint;
                 }
+                async_mode = cJSON_IsTrue(cJSON_GetObjectItem(json_body, "async"));
                 cJSON_Delete(json_body);
             }
         }
+    }
 
-        // 如果POST中没有，则从查询参数解析 (例如 /api/switch?channel=2)
-        if (channel == -1) {
-            char query[64];
-            if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
-                char param[16];
-                if (httpd_query_key_value(query, "channel", param, sizeof(param)) == ESP_OK) {
-                    channel = atoi(param);
-                }
-            }
+    // 查询参数 (例如 /api/switch?channel=2&async=1)
+    char query[64];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK) {
+        char param[16];
+        if (channel == -1 && httpd_query_key_value(query, "channel", param, sizeof(param)) == ESP_OK) {
+            channel = atoi(param);
+        }
+        if (httpd_query_key_value(query, "async", param, sizeof(param)) == ESP_OK) {
+            async_mode = strcmp(param, "1") == 0 || strcmp(param, "true") == 0;
         }
     }
 
-    cJSON *json_resp = cJSON_CreateObject();
+    char resp[160];
+    json_writer_t w;
+    json_writer_init(&w, resp, sizeof(resp));
 
     if (!kvm_controller_is_valid_channel(channel)) {
-        cJSON_AddNumberToObject(json_resp, "code", 1);
-        cJSON_AddStringToObject(json_resp, "message", "Invalid or missing channel number");
+        write_response_begin(&w, 1, "Invalid or missing channel number");
         ESP_LOGE(TAG, "Invalid channel number provided.");
+        json_writer_end_object(&w);
+    } else if (async_mode) {
+        uint32_t job_id = 0;
+        esp_err_t ret = kvm_controller_submit_switch(channel, received_us, NULL, NULL, &job_id);
+        if (ret == ESP_OK) {
+            httpd_resp_set_status(req, "202 Accepted");
+            write_response_begin(&w, 0, "Switch queued");
+            json_writer_add_uint(&w, "job_id", job_id);
+        } else {
+            httpd_resp_set_status(req, "503 Service Unavailable");
+            write_response_begin(&w, 1, "Switch unavailable");
+        }
+        json_writer_add_int(&w, "channel", channel);
+        json_writer_end_object(&w);
     } else {
-        // 调用控制器进行切换 (此函数现在是异步的)
-        esp_err_t switch_result = kvm_controller_switch_channel(channel);
+        // 等待模式: 挂起请求，由切换完成回调回复
+        httpd_req_t *async_req = NULL;
+        esp_err_t ret = http_metrics_async_handler_begin(req, &async_req);
+        if (ret == ESP_OK) {
+            ret = kvm_controller_submit_switch(channel, received_us, switch_http_done, async_req, NULL);
+            if (ret == ESP_OK) {
+                return ESP_OK;
+            }
+            http_metrics_async_handler_complete(async_req);
+        }
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        write_response_begin(&w, 1, "Switch unavailable");
+        json_writer_add_int(&w, "channel", channel);
+        json_writer_end_object(&w);
+    }
 
-        if (switch_result == ESP_OK) {
-            // 立即返回成功响应
-            cJSON_AddNumberToObject(json_resp, "code", 0);
-            cJSON_AddStringToObject(json_resp, "message", "Switch command sent successfully");
-            cJSON_AddNumberToObject(json_resp, "channel", channel);
-            // 删除成功日志，按用户要求简化输出
+    int len = json_writer_finish(&w);
+    if (len < 0) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Response too large");
+    }
+    return send_response(req, resp, len, "application/json");
+}
 
-            // WebSocket功能已禁用，删除通知
-        } else {
-            cJSON_AddNumberToObject(json_resp, "code", 1);
-            cJSON_AddStringToObject(json_resp, "message", "Switch failed");
-            cJSON_AddNumberToObject(json_resp, "channel", channel);
+/**
+ * 切换任务查询API处理器 (GET /api/switch?job=<id>)
+ */
+static esp_err_t api_switch_job_handler(httpd_req_t *req)
+{
+    static const char *const state_names[] = {
+        [KVM_JOB_UNKNOWN] = "unknown",
+        [KVM_JOB_QUEUED]  = "queued",
+        [KVM_JOB_RUNNING] = "running",
+        [KVM_JOB_DONE]    = "done",
+        [KVM_JOB_COALESCED] = "coalesced"
+    };
+
+    char query[32];
+    char param[16];
+    kvm_switch_job_info_t job;
+    esp_err_t ret = ESP_ERR_NOT_FOUND;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "job", param, sizeof(param)) == ESP_OK) {
+        ret = kvm_controller_get_switch_job(strtoul(param, NULL, 10), &job);
+    }
+
+    char resp[160];
+    json_writer_t w;
+    json_writer_init(&w, resp, sizeof(resp));
+    if (ret != ESP_OK) {
+        write_response_begin(&w, 1, "Job not found");
+    } else {
+        write_response_begin(&w, 0, "success");
+        json_writer_begin_object(&w, "data");
+        json_writer_add_uint(&w, "job_id", job.id);
+        json_writer_add_int(&w, "channel", job.channel);
+        json_writer_add_string(&w, "state", state_names[job.state]);
+        if (job.state == KVM_JOB_DONE) {
+            json_writer_add_string(&w, "result", job.result == ESP_OK ? "success" : esp_err_to_name(job.result));
+        } else if (job.state == KVM_JOB_COALESCED) {
+            json_writer_add_uint(&w, "superseded_by", job.superseded_by);
         }
+        json_writer_end_object(&w);
     }
+    json_writer_end_object(&w);
+
+    int len = json_writer_finish(&w);
+    if (len < 0) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Response too large");
+    }
+    return send_response(req, resp, len, "application/json");
+}
+
+/**
+ * 构建/api/switch/trace响应
+ */
+static void build_switch_trace_response(json_writer_t *w, void *ctx)
+{
+    write_response_begin(w, 0, "success");
+    json_writer_begin_object(w, "data");
+    switch_trace_write_json(w);
+    json_writer_end_object(w);
+    json_writer_end_object(w);
+}
 
-    char *json_string = cJSON_Print(json_resp);
-    esp_err_t result = send_response(req, json_string, strlen(json_string), "application/json");
+/**
+ * 切换延迟追踪API处理器 (GET /api/switch/trace)
+ * 返回各阶段耗时直方图和最近的切换记录，数据较大，流式发送
+ */
+static esp_err_t api_switch_trace_handler(httpd_req_t *req)
+{
+    return send_json_stream(req, build_switch_trace_response, NULL);
+}
 
-    free(json_string);
-    cJSON_Delete(json_resp);
+/**
+ * 构建/api/channels响应
+ */
+static void build_channels_response(json_writer_t *w, void *ctx)
+{
+    kvm_status_t kvm_status;
+    kvm_controller_get_status_snapshot(&kvm_status);
 
-    return result;
+    write_response_begin(w, 0, "success");
+    json_writer_begin_array(w, "data");
+    
+    for (int i = 0; i < KVM_CHANNEL_MAX; i++) {
+        const kvm_channel_info_t *channel_info = &kvm_status.channels[i];
+        json_writer_begin_object(w, NULL);
+        json_writer_add_int(w, "channel", channel_info->channel);
+        json_writer_add_bool(w, "active", channel_info->active);
+        json_writer_add_bool(w, "connected", channel_info->connected);
+        json_writer_add_string(w, "name", channel_info->name);
+        json_writer_add_uint(w, "switch_count", channel_info->switch_count);
+        json_writer_end_object(w);
+    }
+    
+    json_writer_end_array(w);
+    json_writer_end_object(w);
 }
 
 /**
@@ -283,33 +1141,45 @@ static esp_err_t api_switch_handler(httpd_req_t *req)
  */
 static esp_err_t api_channels_handler(httpd_req_t *req)
 {
-    cJSON *json = cJSON_CreateObject();
-    cJSON *channels = cJSON_CreateArray();
-    
-    for (int i = 1; i <= KVM_CHANNEL_MAX; i++) {
-        const kvm_channel_info_t *channel_info = kvm_controller_get_channel_info(i);
-        if (channel_info) {
-            cJSON *channel = cJSON_CreateObject();
-            cJSON_AddNumberToObject(channel, "channel", channel_info->channel);
-            cJSON_AddBoolToObject(channel, "active", channel_info->active);
-            cJSON_AddBoolToObject(channel, "connected", channel_info->connected);
-            cJSON_AddStringToObject(channel, "name", channel_info->name);
-            cJSON_AddNumberToObject(channel, "switch_count", channel_info->switch_count);
-            cJSON_AddItemToArray(channels, channel);
-        }
+    uint32_t generation = system_state_get_generation();
+    if (!refresh_response_cache(&s_channels_cache, generation, 0, build_channels_response)) {
+        return send_json_stream(req, build_channels_response, NULL);
     }
+    return send_response(req, s_channels_cache.buf, s_channels_cache.len, "application/json");
+}
+
+/**
+ * 构建/api/wifi响应
+ */
+static void build_wifi_response(json_writer_t *w, void *ctx)
+{
+    wifi_status_t wifi_status;
+    wifi_manager_get_status_snapshot(&wifi_status);
     
-    cJSON_AddNumberToObject(json, "code", 0);
-    cJSON_AddStringToObject(json, "message", "success");
-    cJSON_AddItemToObject(json, "data", channels);
-    
-    char *json_string = cJSON_Print(json);
-    esp_err_t ret = send_response(req, json_string, strlen(json_string), "application/json");
-    
-    free(json_string);
-    cJSON_Delete(json);
-    
-    return ret;
+    write_response_begin(w, 0, "success");
+    json_writer_begin_object(w, "data");
+    json_writer_add_string(w, "sta_state", wifi_manager_sta_state_name(wifi_status.sta_state));
+    json_writer_add_bool(w, "sta_connected", wifi_status.sta_connected);
+    json_writer_add_bool(w, "ap_started", wifi_status.ap_started);
+    json_writer_add_string(w, "sta_ssid", wifi_status.sta_ssid);
+    json_writer_add_string(w, "sta_ip", wifi_status.sta_ip);
+    json_writer_add_string(w, "ap_ip", wifi_status.ap_ip);
+    json_writer_add_int(w, "sta_rssi", wifi_status.sta_rssi);
+    json_writer_add_int(w, "sta_link_quality", wifi_status.sta_link_quality);
+    json_writer_add_uint(w, "sta_tx_rate_kbps", wifi_status.sta_tx_rate_kbps);
+    json_writer_add_int(w, "connected_clients", wifi_status.connected_clients);
+    wifi_known_network_t known[WIFI_KNOWN_MAX];
+    size_t known_count = wifi_manager_get_known_networks(known, WIFI_KNOWN_MAX);
+    json_writer_begin_array(w, "known_networks");
+    for (size_t i = 0; i < known_count; i++) {
+        json_writer_begin_object(w, NULL);
+        json_writer_add_string(w, "ssid", known[i].ssid);
+        json_writer_add_int(w, "priority", known[i].priority);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+    json_writer_end_object(w);
+    json_writer_end_object(w);
 }
 
 /**
@@ -317,31 +1187,394 @@ static esp_err_t api_channels_handler(httpd_req_t *req)
  */
 static esp_err_t api_wifi_handler(httpd_req_t *req)
 {
-    cJSON *json = cJSON_CreateObject();
-    
-    const wifi_status_t *wifi_status = wifi_manager_get_status();
-    
-    cJSON *data = cJSON_CreateObject();
-    cJSON_AddBoolToObject(data, "sta_connected", wifi_status->sta_connected);
-    cJSON_AddBoolToObject(data, "ap_started", wifi_status->ap_started);
-    cJSON_AddStringToObject(data, "sta_ssid", wifi_status->sta_ssid);
-    cJSON_AddStringToObject(data, "sta_ip", wifi_status->sta_ip);
-    cJSON_AddStringToObject(data, "ap_ip", wifi_status->ap_ip);
-    cJSON_AddNumberToObject(data, "sta_rssi", wifi_status->sta_rssi);
-    cJSON_AddNumberToObject(data, "connected_clients", wifi_status->connected_clients);
-    
-    cJSON_AddNumberToObject(json, "code", 0);
-    cJSON_AddStringToObject(json, "message", "success");
-    cJSON_AddItemToObject(json, "data", data);
-    
-    char *json_string = cJSON_Print(json);
-    esp_err_t ret = send_response(req, json_string, strlen(json_string), "application/json");
+    uint32_t generation = system_state_get_generation();
+    if (!refresh_response_cache(&s_wifi_cache, generation, 0, build_wifi_response)) {
+        return send_json_stream(req, build_wifi_response, NULL);
+    }
+    return send_response(req, s_wifi_cache.buf, s_wifi_cache.len, "application/json");
+}
+
+#define WIFI_CONFIG_BODY_MAX    1536    // POST /api/wifi正文上限 (WIFI_KNOWN_MAX个完整条目)
+
+// 编辑中的已知网络列表 (仅httpd任务访问)
+static wifi_known_network_t s_known_edit[WIFI_KNOWN_MAX];
+
+/**
+ * 解析一个已知网络条目
+ * @return NULL 成功，否则为错误信息
+ */
+static const char *parse_known_network(const cJSON *item, wifi_known_network_t *network)
+{
+    const cJSON *ssid = cJSON_GetObjectItem(item, "ssid");
+    const cJSON *password = cJSON_GetObjectItem(item, "password");
+    const cJSON *priority = cJSON_GetObjectItem(item, "priority");
+
+    if (!cJSON_IsString(ssid) || strlen(ssid->valuestring) == 0 || strlen(ssid->valuestring) > WIFI_SSID_MAX_LEN) {
+        return "Invalid ssid";
+    }
+    if (password != NULL && (!cJSON_IsString(password) || strlen(password->valuestring) > WIFI_PASSWORD_MAX_LEN ||
+                             (strlen(password->valuestring) > 0 && strlen(password->valuestring) < 8))) {
+        return "Invalid password";
+    }
+    if (priority != NULL && (!cJSON_IsNumber(priority) || priority->valueint < 0 || priority->valueint > UINT8_MAX)) {
+        return "Invalid priority";
+    }
+
+    memset(network, 0, sizeof(*network));
+    strncpy(network->ssid, ssid->valuestring, sizeof(network->ssid) - 1);
+    if (password != NULL) {
+        strncpy(network->password, password->valuestring, sizeof(network->password) - 1);
+    }
+    network->priority = priority != NULL ? (uint8_t)priority->valueint : 0;
+    return NULL;
+}
+
+/**
+ * 按请求修改s_known_edit
+ *   {"networks":[{"ssid","password","priority"},...]}  替换整个列表
+ *   {"ssid","password","priority"}                     添加或更新一个网络
+ *   {"ssid","remove":true}                             删除一个网络
+ * @param count 输入当前条目数，输出修改后的条目数
+ * @return NULL 成功，否则为错误信息
+ */
+static const char *apply_wifi_config(const cJSON *body, size_t *count)
+{
+    const cJSON *networks = cJSON_GetObjectItem(body, "networks");
+    if (networks != NULL) {
+        if (!cJSON_IsArray(networks) || cJSON_GetArraySize(networks) > WIFI_KNOWN_MAX) {
+            return "Invalid networks list";
+        }
+        size_t n = 0;
+        const cJSON *item;
+        cJSON_ArrayForEach(item, networks) {
+            const char *error = parse_known_network(item, &s_known_edit[n]);
+            if (error != NULL) {
+                return error;
+            }
+            n++;
+        }
+        *count = n;
+        return NULL;
+    }
 
-    free(json_string);
-    cJSON_Delete(json);
+    wifi_known_network_t network;
+    bool remove = cJSON_IsTrue(cJSON_GetObjectItem(body, "remove"));
+    const cJSON *ssid = cJSON_GetObjectItem(body, "ssid");
+    const char *error = remove ? NULL : parse_known_network(body, &network);
+    if (error != NULL) {
+        return error;
+    }
+    if (!cJSON_IsString(ssid)) {
+        return "Invalid ssid";
+    }
 
+    size_t index = 0;
+    while (index < *count && strcmp(s_known_edit[index].ssid, ssid->valuestring) != 0) {
+        index++;
+    }
+    if (remove) {
+        if (index == *count) {
+            return "Unknown ssid";
+        }
+        memmove(&s_known_edit[index], &s_known_edit[index + 1], (*count - index - 1) * sizeof(s_known_edit[0]));
+        (*count)--;
+    } else {
+        if (index == WIFI_KNOWN_MAX) {
+            return "Too many networks";
+        }
+        s_known_edit[index] = network;
+        *count += index == *count ? 1 : 0;
+    }
+    return NULL;
+}
+
+/**
+ * WiFi配置API处理器 (POST /api/wifi)
+ * 修改保存在NVS中的已知网络列表，WiFi管理器随后按新列表选择网络
+ * (当前网络仍在列表中时保持连接)
+ * 只接受application/json正文且响应不带CORS头部: 浏览器必须先预检，
+ * 其他网页无法用简单请求 (text/plain表单等) 改写凭据
+ */
+static esp_err_t api_wifi_config_handler(httpd_req_t *req)
+{
+    const char *error = NULL;
+    const char *status = HTTPD_400;
+    esp_err_t ret = ESP_OK;
+    size_t count = 0;
+    char *content = NULL;
+    cJSON *body = NULL;
+
+    if (!request_is_json(req)) {
+        error = "Content-Type must be application/json";
+        status = "415 Unsupported Media Type";
+    } else if (req->content_len == 0 || req->content_len > WIFI_CONFIG_BODY_MAX) {
+        error = "Invalid request body size";
+    } else if ((content = malloc(req->content_len + 1)) == NULL) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Out of memory");
+    } else {
+        size_t received = 0;
+        while (received < req->content_len) {
+            int n = httpd_req_recv(req, content + received, req->content_len - received);
+            if (n == HTTPD_SOCK_ERR_TIMEOUT) {
+                continue;
+            }
+            if (n <= 0) {
+                free(content);
+                return ESP_FAIL;
+            }
+            received += n;
+        }
+        content[received] = '\0';
+        body = cJSON_Parse(content);
+        // 正文含密码，解析后立即清除
+        memset(content, 0, received);
+        free(content);
+        if (!cJSON_IsObject(body)) {
+            error = "Invalid JSON";
+        }
+    }
+
+    if (error == NULL) {
+        count = wifi_manager_get_known_networks(s_known_edit, WIFI_KNOWN_MAX);
+        error = apply_wifi_config(body, &count);
+    }
+    cJSON_Delete(body);
+    if (error == NULL) {
+        ret = wifi_manager_set_known_networks(s_known_edit, count);
+        if (ret == ESP_ERR_INVALID_ARG) {
+            error = "Invalid networks list";
+        } else if (ret != ESP_OK) {
+            error = "Failed to save networks";
+            status = HTTPD_500;
+        }
+    }
+    memset(s_known_edit, 0, sizeof(s_known_edit));
+
+    char resp[96];
+    json_writer_t w;
+    json_writer_init(&w, resp, sizeof(resp));
+    if (error != NULL) {
+        httpd_resp_set_status(req, status);
+        write_response_begin(&w, 1, error);
+    } else {
+        write_response_begin(&w, 0, "success");
+        json_writer_begin_object(&w, "data");
+        json_writer_add_uint(&w, "count", count);
+        json_writer_end_object(&w);
+    }
+    json_writer_end_object(&w);
+
+    int len = json_writer_finish(&w);
+    if (len < 0) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "Response too large");
+    }
+    set_private_headers(req, "application/json");
+    return httpd_resp_send(req, resp, len);
+}
+
+// 扫描结果副本 (仅httpd任务访问，避免在任务栈上放置记录数组)
+static wifi_ap_record_t s_scan_records[WIFI_SCAN_MAX_RECORDS];
+static wifi_scan_info_t s_scan_info;
+
+/**
+ * 构建/api/scan响应 (来自s_scan_records和s_scan_info)
+ */
+static void build_scan_response(json_writer_t *w, void *ctx)
+{
+    write_response_begin(w, 0, "success");
+    json_writer_begin_object(w, "data");
+    json_writer_add_bool(w, "scanning", s_scan_info.scanning);
+    if (s_scan_info.valid) {
+        json_writer_add_uint(w, "age_ms", s_scan_info.age_ms);
+    } else {
+        json_writer_add_null(w, "age_ms");
+    }
+    json_writer_begin_array(w, "networks");
+    for (int i = 0; i < s_scan_info.count; i++) {
+        const wifi_ap_record_t *record = &s_scan_records[i];
+        char bssid[18];
+        snprintf(bssid, sizeof(bssid), MACSTR, MAC2STR(record->bssid));
+        json_writer_begin_object(w, NULL);
+        json_writer_add_string(w, "ssid", (const char *)record->ssid);
+        json_writer_add_string(w, "bssid", bssid);
+        json_writer_add_int(w, "channel", record->primary);
+        json_writer_add_int(w, "rssi", record->rssi);
+        json_writer_add_int(w, "authmode", record->authmode);
+        json_writer_end_object(w);
+    }
+    json_writer_end_array(w);
+    json_writer_end_object(w);
+    json_writer_end_object(w);
+}
+
+/**
+ * WiFi扫描API处理器 (GET /api/scan[?max_age=<s>])
+ * 立即返回缓存的结果和结果时间，缓存超过max_age (默认WIFI_SCAN_CACHE_TTL_MS) 时在后台重新扫描，
+ * scanning为true时客户端稍后再次请求即可得到新结果
+ */
+static esp_err_t api_scan_handler(httpd_req_t *req)
+{
+    uint32_t max_age_ms = WIFI_SCAN_CACHE_TTL_MS;
+    char query[32];
+    char param[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "max_age", param, sizeof(param)) == ESP_OK) {
+        max_age_ms = (uint32_t)MIN(strtoul(param, NULL, 10), WIFI_SCAN_CACHE_TTL_MS / 1000) * 1000;
+    }
+
+    if (wifi_manager_scan_get_cached(max_age_ms, s_scan_records, WIFI_SCAN_MAX_RECORDS, &s_scan_info) != ESP_OK) {
+        return httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "WiFi not initialized");
+    }
+    return send_json_stream(req, build_scan_response, NULL);
+}
+
+/**
+ * 路由指标API处理器 (Prometheus文本格式)
+ */
+static esp_err_t api_metrics_handler(httpd_req_t *req)
+{
+    return http_metrics_send(req);
+}
+
+// /api/路由表: 由api_router在一个URI处理器中分发，新增接口不再占用处理器槽位
+static const api_route_t s_api_routes[] = {
+    { API_STATUS,           HTTP_GET,       api_status_handler,         NULL },
+    { API_SWITCH,           HTTP_POST,      api_switch_handler,         NULL },     // 通道号在正文或查询参数中
+    { API_SWITCH,           HTTP_GET,       api_switch_job_handler,     NULL },
+    { API_SWITCH "/{n}",    HTTP_POST,      api_switch_handler,         NULL },
+    { API_SWITCH_TRACE,     HTTP_GET,       api_switch_trace_handler,   NULL },
+    { API_CHANNELS,         HTTP_GET,       api_channels_handler,       NULL },
+    { API_WIFI,             HTTP_GET,       api_wifi_handler,           NULL },
+    { API_WIFI,             HTTP_POST,      api_wifi_config_handler,    NULL },     // 已知网络列表
+    { API_SCAN,             HTTP_GET,       api_scan_handler,           NULL },
+    { API_METRICS,          HTTP_GET,       api_metrics_handler,        NULL },
+    { API_ROOT "/*",        HTTP_OPTIONS,   options_handler,            NULL },     // CORS预检
+};
+
+#if WEBSOCKET_SUPPORTED
+/**
+ * WebSocket切换请求上下文 (完成回调中释放)
+ */
+#define WS_SWITCH_RESULT_SIZE   160
+typedef struct {
+    int fd;
+    int id;
+} ws_switch_ctx_t;
+
+/**
+ * 格式化WebSocket切换结果消息
+ */
+static int format_ws_switch_result(char *buf, size_t size, int id, const kvm_switch_job_info_t *job)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_begin_object(&w, NULL);
+    json_writer_add_string(&w, "type", "switch_result");
+    json_writer_add_int(&w, "id", id);
+    json_writer_add_int(&w, "code", job->result == ESP_OK ? 0 : 1);
+    json_writer_add_int(&w, "channel", job->channel);
+    json_writer_add_uint(&w, "job_id", job->id);
+    if (job->state == KVM_JOB_COALESCED) {
+        json_writer_add_uint(&w, "superseded_by", job->superseded_by);
+    }
+    json_writer_add_string(&w, "message", job->state == KVM_JOB_COALESCED ? "coalesced" :
+                           job->result == ESP_OK ? "success" : esp_err_to_name(job->result));
+    json_writer_end_object(&w);
+    return json_writer_finish(&w);
+}
+
+/**
+ * WebSocket切换完成回调，在切换工作任务中执行
+ */
+static void ws_switch_done(const kvm_switch_job_info_t *job, void *arg)
+{
+    ws_switch_ctx_t *ctx = (ws_switch_ctx_t *)arg;
+    char reply[WS_SWITCH_RESULT_SIZE];
+
+    if (format_ws_switch_result(reply, sizeof(reply), ctx->id, job) >= 0) {
+        ws_queue_text(ctx->fd, reply);
+    }
+    free(ctx);
+}
+
+/**
+ * WebSocket处理器
+ * 支持的客户端消息:
+ *   {"type":"switch","channel":N,"id":X}  切换通道，结果以switch_result回复(带回id)
+ *   {"type":"get_status"}                 立即回复一次status_update
+ */
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        // 握手完成，记录客户端
+        ws_add_client(httpd_req_to_sockfd(req));
+        return ESP_OK;
+    }
+
+    int64_t received_us = esp_timer_get_time();
+    uint8_t buf[WS_MAX_FRAME_LEN + 1];
+    httpd_ws_frame_t frame = {0};
+    frame.payload = buf;
+
+    // 先获取帧长度
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (frame.len > WS_MAX_FRAME_LEN) {
+        ESP_LOGW(TAG, "WebSocket消息过长: %d字节", (int)frame.len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+    ret = httpd_ws_recv_frame(req, &frame, WS_MAX_FRAME_LEN);
+    if (ret != ESP_OK || frame.type != HTTPD_WS_TYPE_TEXT) {
+        return ret;
+    }
+    buf[frame.len] = '\0';
+
+    cJSON *msg = cJSON_Parse((const char *)buf);
+    if (msg == NULL) {
+        return ws_send_text(req, "{\"type\":\"error\",\"message\":\"Invalid JSON\"}");
+    }
+
+    const cJSON *type = cJSON_GetObjectItem(msg, "type");
+    if (cJSON_IsString(type) && strcmp(type->valuestring, "switch") == 0) {
+        const cJSON *channel_json = cJSON_GetObjectItem(msg, "channel");
+        const cJSON *id_json = cJSON_GetObjectItem(msg, "id");
+        int channel = cJSON_IsNumber(channel_json) ? channel_json->valueint : -1;
+        int id = cJSON_IsNumber(id_json) ? id_json->valueint : 0;
+
+        ws_switch_ctx_t *ctx = malloc(sizeof(ws_switch_ctx_t));
+        esp_err_t switch_result = ctx == NULL ? ESP_ERR_NO_MEM : ESP_ERR_INVALID_ARG;
+        if (ctx != NULL && kvm_controller_is_valid_channel(channel)) {
+            ctx->fd = httpd_req_to_sockfd(req);
+            ctx->id = id;
+            switch_result = kvm_controller_submit_switch(channel, received_us, ws_switch_done, ctx, NULL);
+        }
+
+        if (switch_result == ESP_OK) {
+            // 结果由完成回调推送
+            ret = ESP_OK;
+        } else {
+            free(ctx);
+            kvm_switch_job_info_t job = {
+                .channel = channel,
+                .state = KVM_JOB_DONE,
+                .result = switch_result
+            };
+            char reply[WS_SWITCH_RESULT_SIZE];
+            ret = format_ws_switch_result(reply, sizeof(reply), id, &job) < 0 ? ESP_ERR_NO_MEM : ws_send_text(req, reply);
+        }
+    } else if (cJSON_IsString(type) && strcmp(type->valuestring, "get_status") == 0) {
+        static char message[WS_STATUS_MSG_SIZE];     // 仅在httpd任务中使用
+        ret = format_status_update(message, sizeof(message), 0) < 0 ? ESP_ERR_NO_MEM : ws_send_text(req, message);
+    } else {
+        ret = ws_send_text(req, "{\"type\":\"error\",\"message\":\"Unknown message type\"}");
+    }
+
+    cJSON_Delete(msg);
     return ret;
 }
+#endif
 
 /**
  * 启动Web服务器
@@ -359,14 +1592,41 @@ esp_err_t web_server_start(void)
     config.stack_size = WEB_SERVER_STACK_SIZE;
     config.task_priority = 5;
     config.lru_purge_enable = true;
-    config.max_uri_handlers = 16;
+    config.uri_match_fn = api_router_uri_match;
+    config.max_uri_handlers = 8;   // 静态文件4个、WebSocket和API分发器各1个
     config.max_resp_headers = 8;
     config.backlog_conn = 5;
     config.recv_wait_timeout = 10;
     config.send_wait_timeout = 10;
+#if WEBSOCKET_SUPPORTED
+    config.close_fn = ws_session_close;
+    s_ws_client_count = 0;
+#endif
+
+    // 长轮询任务只创建一次，服务器重启后继续使用
+    if (s_longpoll_task == NULL) {
+        s_longpoll_mutex = xSemaphoreCreateMutex();
+        if (s_longpoll_mutex == NULL ||
+            xTaskCreate(longpoll_task, "http_longpoll", LONGPOLL_TASK_STACK_SIZE, NULL, 5, &s_longpoll_task) != pdPASS) {
+            ESP_LOGE(TAG, "创建长轮询任务失败");
+            return ESP_ERR_NO_MEM;
+        }
+        system_state_add_listener(longpoll_on_state_changed, NULL);
+    }
+
+    // 事件订阅只注册一次，服务器停止期间收到的事件直接忽略
+    if (!s_events_subscribed) {
+        s_events_subscribed = event_bus_subscribe(ESP_EVENT_ANY_ID, web_server_on_event, NULL, NULL) == ESP_OK;
+        http_metrics_add_collector(event_bus_metrics_collect, NULL);
+    }
+
+    esp_err_t ret = api_router_init(s_api_routes, sizeof(s_api_routes) / sizeof(s_api_routes[0]));
+    if (ret != ESP_OK) {
+        return ret;
+    }
 
     ESP_LOGI(TAG, "正在启动Web服务器，端口: %d", config.server_port);
-    esp_err_t ret = httpd_start(&server, &config);
+    ret = httpd_start(&server, &config);
     if (ret == ESP_OK) {
         ESP_LOGI(TAG, "✓ Web服务器启动成功，监听端口: %d", config.server_port);
 
@@ -374,94 +1634,54 @@ esp_err_t web_server_start(void)
         httpd_uri_t index_uri = {
             .uri       = "/",
             .method    = HTTP_GET,
-            .handler   = index_handler,
-            .user_ctx  = NULL
+            .handler   = static_asset_handler,
+            .user_ctx  = (void *)&s_index_asset
         };
-        httpd_register_uri_handler(server, &index_uri);
+        http_metrics_register_uri_handler(server, &index_uri, NULL);
 
         httpd_uri_t style_uri = {
             .uri       = "/style.css",
             .method    = HTTP_GET,
-            .handler   = style_handler,
-            .user_ctx  = NULL
+            .handler   = static_asset_handler,
+            .user_ctx  = (void *)&s_style_asset
         };
-        httpd_register_uri_handler(server, &style_uri);
+        http_metrics_register_uri_handler(server, &style_uri, NULL);
 
         httpd_uri_t script_uri = {
             .uri       = "/script.js",
             .method    = HTTP_GET,
-            .handler   = script_handler,
-            .user_ctx  = NULL
+            .handler   = static_asset_handler,
+            .user_ctx  = (void *)&s_script_asset
         };
-        httpd_register_uri_handler(server, &script_uri);
+        http_metrics_register_uri_handler(server, &script_uri, NULL);
 
         httpd_uri_t favicon_uri = {
             .uri       = "/favicon.ico",
             .method    = HTTP_GET,
-            .handler   = favicon_handler,
-            .user_ctx  = NULL
-        };
-        httpd_register_uri_handler(server, &favicon_uri);
-
-        // 注册API处理器
-        httpd_uri_t api_status_uri = {
-            .uri       = "/api/status",
-            .method    = HTTP_GET,
-            .handler   = api_status_handler,
-            .user_ctx  = NULL
-        };
-        httpd_register_uri_handler(server, &api_status_uri);
-
-        // 注册通道切换API - 支持具体通道号（使用静态数组避免内存泄漏）
-        static httpd_uri_t switch_uris[8];
-        static char switch_uri_paths[8][32];
-
-        for (int i = 1; i <= 8; i++) {
-            snprintf(switch_uri_paths[i-1], sizeof(switch_uri_paths[i-1]), "/api/switch/%d", i);
-
-            switch_uris[i-1].uri = switch_uri_paths[i-1];
-            switch_uris[i-1].method = HTTP_POST;
-            switch_uris[i-1].handler = api_switch_handler;
-            switch_uris[i-1].user_ctx = NULL;
-
-            httpd_register_uri_handler(server, &switch_uris[i-1]);
-        }
-
-        // 也注册通用的切换API（用于查询参数方式）
-        httpd_uri_t api_switch_general_uri = {
-            .uri       = "/api/switch",
-            .method    = HTTP_POST,
-            .handler   = api_switch_handler,
-            .user_ctx  = NULL
+            .handler   = static_asset_handler,
+            .user_ctx  = (void *)&s_favicon_asset
         };
-        httpd_register_uri_handler(server, &api_switch_general_uri);
+        http_metrics_register_uri_handler(server, &favicon_uri, NULL);
 
-        // 注册OPTIONS处理器（用于CORS预检）
-        httpd_uri_t options_uri = {
-            .uri       = "/api/*",
-            .method    = HTTP_OPTIONS,
-            .handler   = options_handler,
+        // 注册API分发器 (不做统计，路由表中的每条路由分别统计)
+        httpd_uri_t api_uri = {
+            .uri       = API_ROUTER_PREFIX,
+            .method    = HTTP_ANY,
+            .handler   = api_router_dispatch,
             .user_ctx  = NULL
         };
-        httpd_register_uri_handler(server, &options_uri);
+        httpd_register_uri_handler(server, &api_uri);
 
-        httpd_uri_t api_channels_uri = {
-            .uri       = "/api/channels",
-            .method    = HTTP_GET,
-            .handler   = api_channels_handler,
-            .user_ctx  = NULL
+#if WEBSOCKET_SUPPORTED
+        httpd_uri_t ws_uri = {
+            .uri          = WS_PATH,
+            .method       = HTTP_GET,
+            .handler      = ws_handler,
+            .user_ctx     = NULL,
+            .is_websocket = true
         };
-        httpd_register_uri_handler(server, &api_channels_uri);
-
-        httpd_uri_t api_wifi_uri = {
-            .uri       = "/api/wifi",
-            .method    = HTTP_GET,
-            .handler   = api_wifi_handler,
-            .user_ctx  = NULL
-        };
-        httpd_register_uri_handler(server, &api_wifi_uri);
-
-        // WebSocket功能已禁用，跳过注册
+        http_metrics_register_uri_handler(server, &ws_uri, NULL);
+#endif
 
         // URI处理器注册完成
         ESP_LOGI(TAG, "✓ 所有URI处理器注册完成");
@@ -483,6 +1703,20 @@ esp_err_t web_server_stop(void)
     }
 
     ESP_LOGI(TAG, "停止Web服务器");
+
+    // 结束所有挂起的长轮询请求
+    if (s_longpoll_mutex != NULL) {
+        xSemaphoreTake(s_longpoll_mutex, portMAX_DELAY);
+        for (int i = 0; i < LONGPOLL_MAX_WAITERS; i++) {
+            if (s_longpoll_waiters[i].req != NULL) {
+                httpd_resp_send_err(s_longpoll_waiters[i].req, HTTPD_500_INTERNAL_SERVER_ERROR, "Server stopping");
+                http_metrics_async_handler_complete(s_longpoll_waiters[i].req);
+                s_longpoll_waiters[i].req = NULL;
+            }
+        }
+        xSemaphoreGive(s_longpoll_mutex);
+    }
+
     esp_err_t ret = httpd_stop(server);
     server = NULL;
 
@@ -4,35 +4,141 @@
  */
 
 #include <string.h>
+#include <stdlib.h>
+#include <sys/param.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
-#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "nvs.h"
 #include "esp_mac.h"
 #include "lwip/err.h"
 #include "lwip/sys.h"
 
 #include "wifi_manager.h"
+#include "seqlock.h"
+#include "system_state.h"
+#include "event_bus.h"
 
 static const char *TAG = "WIFI_MGR";
 
-// WiFi事件组
-static EventGroupHandle_t s_wifi_event_group;
-#define WIFI_CONNECTED_BIT BIT0
-#define WIFI_FAIL_BIT      BIT1
+// 连接任务通知位 (事件处理器和API只通知，连接任务是唯一调用esp_wifi_connect/set_mode的地方)
+#define WIFI_NOTIFY_STA_START       (1u << 0)
+#define WIFI_NOTIFY_DISCONNECTED    (1u << 1)
+#define WIFI_NOTIFY_GOT_IP          (1u << 2)
+#define WIFI_NOTIFY_RECONFIGURE     (1u << 3)    // s_sta_config已更新
+#define WIFI_NOTIFY_STOP            (1u << 4)    // 停止自动重连
+#define WIFI_NOTIFY_AP_IDLE         (1u << 5)    // AP上最后一个客户端已断开
+#define WIFI_NOTIFY_SCAN            (1u << 6)    // 有扫描请求
+#define WIFI_NOTIFY_SCAN_DONE       (1u << 7)
+#define WIFI_NOTIFY_SELECT          (1u << 8)    // 已知网络列表已更新
 
-// WiFi状态
+// WiFi状态 (写者在s_status_spinlock临界区内修改，读者通过s_status_seq无锁读取快照)
 static wifi_status_t s_wifi_status = {0};
+static portMUX_TYPE s_status_spinlock = portMUX_INITIALIZER_UNLOCKED;
+static seqlock_t s_status_seq = SEQLOCK_INIT;
 static int s_retry_num = 0;
+static bool s_sta_associated = false;   // STA已关联 (用于只在链路变化时发布事件)
+
+// 连接任务
+static TaskHandle_t s_wifi_task = NULL;
+static wifi_config_t s_sta_config;      // 待应用的STA配置 (RECONFIGURE时由连接任务读取)
+static SemaphoreHandle_t s_config_mutex = NULL;
+
+// 上次成功连接的网络参数 (仅连接任务访问，保存在NVS)
+typedef struct {
+    char ssid[WIFI_SSID_MAX_LEN + 1];
+    uint8_t bssid[6];
+    uint8_t channel;
+    esp_netif_ip_info_t ip_info;
+} wifi_link_cache_t;
+
+static wifi_link_cache_t s_link_cache;
+static bool s_link_cache_valid = false;
+
+// 已知网络列表 (受s_config_mutex保护)
+static wifi_known_network_t s_known[WIFI_KNOWN_MAX];
+static size_t s_known_count = 0;
+
+// 网络选择 (仅连接任务访问)
+static wifi_link_cache_t s_selected_ap;         // 扫描选出的AP，下一次连接定向到它 (不使用ip_info)
+static bool s_selected_ap_valid = false;
+static int s_selected_index = -1;               // 当前尝试的已知网络
+static uint32_t s_known_failed = 0;             // 本次断线期间连接失败过的已知网络 (按序号的位)
+static bool s_connect_after_scan = false;       // 扫描期间到期的连接推迟到扫描完成
+static bool s_select_after_scan = false;        // 扫描完成后从已知网络中选择
+
+// 扫描缓存 (受s_scan_mutex保护；只有连接任务发起扫描和写入结果)
+static SemaphoreHandle_t s_scan_mutex = NULL;
+static wifi_ap_record_t s_scan_records[WIFI_SCAN_MAX_RECORDS];
+static uint16_t s_scan_count = 0;
+static int64_t s_scan_time_us = 0;          // 结果完成时间，0表示没有结果
+static bool s_scan_requested = false;
+static bool s_scan_running = false;
+
+// RSSI平滑值 (乘以16的定点数，仅连接任务访问)
+static int s_rssi_ewma_x16 = 0;
+static bool s_rssi_sampled = false;
+
+// PHY速率估算: 达到最低接收灵敏度 (IEEE 802.11 HT20 MCS0~7 / OFDM 6~54Mbps) 时可用的速率
+typedef struct {
+    int8_t min_rssi;
+    uint32_t rate_kbps;
+} wifi_rate_step_t;
+
+static const wifi_rate_step_t HT20_RATES[] = {
+    { -64, 65000 }, { -65, 58500 }, { -66, 52000 }, { -70, 39000 },
+    { -74, 26000 }, { -77, 19500 }, { -79, 13000 }, { -82, 6500 },
+};
+
+static const wifi_rate_step_t OFDM_RATES[] = {
+    { -65, 54000 }, { -66, 48000 }, { -70, 36000 }, { -74, 24000 },
+    { -77, 18000 }, { -79, 12000 }, { -81, 9000 }, { -82, 6000 },
+};
 
 // 网络接口
 static esp_netif_t *s_sta_netif = NULL;
 static esp_netif_t *s_ap_netif = NULL;
 
+static const char *const STA_STATE_NAMES[] = {
+    [WIFI_STA_STATE_IDLE]       = "idle",
+    [WIFI_STA_STATE_CONNECTING] = "connecting",
+    [WIFI_STA_STATE_CONNECTED]  = "connected",
+    [WIFI_STA_STATE_WAIT_RETRY] = "wait_retry",
+    [WIFI_STA_STATE_SELECTING]  = "selecting",
+};
+
+/**
+ * 开始修改s_wifi_status (进入临界区，写区间内只做赋值，不能阻塞或打印日志)
+ */
+static void wifi_status_write_begin(void)
+{
+    portENTER_CRITICAL(&s_status_spinlock);
+    seqlock_write_begin(&s_status_seq);
+}
+
+/**
+ * 结束修改s_wifi_status
+ */
+static void wifi_status_write_end(void)
+{
+    seqlock_write_end(&s_status_seq);
+    portEXIT_CRITICAL(&s_status_spinlock);
+}
+
+static void wifi_notify(uint32_t bits)
+{
+    if (s_wifi_task != NULL) {
+        xTaskNotify(s_wifi_task, bits, eSetBits);
+    }
+}
+
 /**
  * WiFi事件处理函数
  */
@@ -40,51 +146,739 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
                               int32_t event_id, void* event_data)
 {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
-        esp_wifi_connect();
-        // STA模式启动
+        // STA模式启动，由连接任务发起连接
+        wifi_notify(WIFI_NOTIFY_STA_START);
+        
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_CONNECTED) {
+        wifi_event_sta_connected_t* event = (wifi_event_sta_connected_t*) event_data;
+        kvm_event_wifi_link_t link = {0};
+        memcpy(link.ssid, event->ssid, MIN(event->ssid_len, sizeof(link.ssid) - 1));
+        s_sta_associated = true;
+        event_bus_post(KVM_EVENT_WIFI_LINK_UP, &link, sizeof(link));
         
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED) {
-        if (s_retry_num < WIFI_RETRY_MAX) {
-            esp_wifi_connect();
-            s_retry_num++;
-            // 重试连接WiFi
-        } else {
-            xEventGroupSetBits(s_wifi_event_group, WIFI_FAIL_BIT);
-            ESP_LOGE(TAG, "WiFi连接失败，已达到最大重试次数");
+        wifi_event_sta_disconnected_t* event = (wifi_event_sta_disconnected_t*) event_data;
+        if (s_sta_associated) {
+            kvm_event_wifi_link_t link = { .reason = event->reason };
+            memcpy(link.ssid, event->ssid, MIN(event->ssid_len, sizeof(link.ssid) - 1));
+            s_sta_associated = false;
+            event_bus_post(KVM_EVENT_WIFI_LINK_DOWN, &link, sizeof(link));
+        }
+        if (s_wifi_status.sta_connected || s_wifi_status.sta_ip[0] != '\0') {
+            wifi_status_write_begin();
+            s_wifi_status.sta_connected = false;
+            memset(s_wifi_status.sta_ip, 0, sizeof(s_wifi_status.sta_ip));
+            s_wifi_status.sta_rssi = 0;
+            s_wifi_status.sta_link_quality = 0;
+            s_wifi_status.sta_tx_rate_kbps = 0;
+            wifi_status_write_end();
+            system_state_mark_changed();
         }
-        s_wifi_status.sta_connected = false;
-        memset(s_wifi_status.sta_ip, 0, sizeof(s_wifi_status.sta_ip));
+        wifi_notify(WIFI_NOTIFY_DISCONNECTED);
         
     } else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP) {
         ip_event_got_ip_t* event = (ip_event_got_ip_t*) event_data;
-        snprintf(s_wifi_status.sta_ip, sizeof(s_wifi_status.sta_ip), 
-                IPSTR, IP2STR(&event->ip_info.ip));
-        ESP_LOGI(TAG, "获得IP地址: %s", s_wifi_status.sta_ip);
+        kvm_event_wifi_ip_t ip_event;
+        snprintf(ip_event.ip, sizeof(ip_event.ip), IPSTR, IP2STR(&event->ip_info.ip));
+        ESP_LOGI(TAG, "获得IP地址: %s", ip_event.ip);
         
-        s_retry_num = 0;
+        wifi_status_write_begin();
+        memcpy(s_wifi_status.sta_ip, ip_event.ip, sizeof(s_wifi_status.sta_ip));
         s_wifi_status.sta_connected = true;
-        xEventGroupSetBits(s_wifi_event_group, WIFI_CONNECTED_BIT);
+        wifi_status_write_end();
+        system_state_mark_changed();
+        event_bus_post(KVM_EVENT_WIFI_GOT_IP, &ip_event, sizeof(ip_event));
+        wifi_notify(WIFI_NOTIFY_GOT_IP);
+        
+    } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE) {
+        wifi_notify(WIFI_NOTIFY_SCAN_DONE);
         
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STACONNECTED) {
-        wifi_event_ap_staconnected_t* event = (wifi_event_ap_staconnected_t*) event_data;
         // 客户端连接到AP
+        wifi_status_write_begin();
         s_wifi_status.connected_clients++;
+        wifi_status_write_end();
+        system_state_mark_changed();
+        kvm_event_ap_clients_t clients = { .connected_clients = s_wifi_status.connected_clients };
+        event_bus_post(KVM_EVENT_AP_CLIENTS_CHANGED, &clients, sizeof(clients));
         
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STADISCONNECTED) {
-        wifi_event_ap_stadisconnected_t* event = (wifi_event_ap_stadisconnected_t*) event_data;
         // 客户端断开AP连接
+        wifi_status_write_begin();
         if (s_wifi_status.connected_clients > 0) {
             s_wifi_status.connected_clients--;
         }
+        wifi_status_write_end();
+        system_state_mark_changed();
+        kvm_event_ap_clients_t clients = { .connected_clients = s_wifi_status.connected_clients };
+        event_bus_post(KVM_EVENT_AP_CLIENTS_CHANGED, &clients, sizeof(clients));
+        if (s_wifi_status.connected_clients == 0) {
+            wifi_notify(WIFI_NOTIFY_AP_IDLE);
+        }
         
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_START) {
         // AP模式启动成功
+        esp_netif_ip_info_t ip_info;
+        char ap_ip[sizeof(s_wifi_status.ap_ip)] = {0};
+        if (esp_netif_get_ip_info(s_ap_netif, &ip_info) == ESP_OK) {
+            snprintf(ap_ip, sizeof(ap_ip), IPSTR, IP2STR(&ip_info.ip));
+        }
+        wifi_status_write_begin();
+        if (ap_ip[0] != '\0') {
+            memcpy(s_wifi_status.ap_ip, ap_ip, sizeof(s_wifi_status.ap_ip));
+        }
         s_wifi_status.ap_started = true;
+        wifi_status_write_end();
+        system_state_mark_changed();
         
     } else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_AP_STOP) {
         // AP模式已停止
+        wifi_status_write_begin();
         s_wifi_status.ap_started = false;
         s_wifi_status.connected_clients = 0;
+        wifi_status_write_end();
+        system_state_mark_changed();
+    }
+}
+
+static void wifi_set_sta_state(wifi_sta_state_t state)
+{
+    if (s_wifi_status.sta_state != state) {
+        wifi_status_write_begin();
+        s_wifi_status.sta_state = state;
+        wifi_status_write_end();
+        system_state_mark_changed();
+    }
+}
+
+/**
+ * 按RSSI和协商的PHY模式估算发送速率 (取满足最低接收灵敏度的最高速率)
+ */
+static uint32_t wifi_estimate_tx_rate(int rssi, const wifi_ap_record_t *ap_info)
+{
+    const wifi_rate_step_t *steps = NULL;
+    size_t count = 0;
+    uint32_t scale = 1;
+    if (ap_info->phy_11n) {
+        steps = HT20_RATES;
+        count = sizeof(HT20_RATES) / sizeof(HT20_RATES[0]);
+        // HT40的灵敏度要求比HT20高3dB，速率约为两倍
+        if (ap_info->second != WIFI_SECOND_CHAN_NONE) {
+            rssi -= 3;
+            scale = 2;
+        }
+    } else if (ap_info->phy_11g) {
+        steps = OFDM_RATES;
+        count = sizeof(OFDM_RATES) / sizeof(OFDM_RATES[0]);
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (rssi >= steps[i].min_rssi) {
+            return steps[i].rate_kbps * scale;
+        }
+    }
+    // 仅11b或信号低于OFDM最低要求时按DSSS估算
+    return rssi >= -76 ? 11000 : 1000;
+}
+
+/**
+ * 采样链路质量 (仅连接任务调用): 更新RSSI平滑值，
+ * 平滑值变化超过阈值或估算速率变化时才更新状态，避免信号抖动使响应缓存频繁失效
+ */
+static void wifi_link_sample(void)
+{
+    wifi_ap_record_t ap_info;
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK) {
+        return;
+    }
+
+    bool first = !s_rssi_sampled;
+    if (first) {
+        s_rssi_ewma_x16 = ap_info.rssi * 16;
+        s_rssi_sampled = true;
+    } else {
+        s_rssi_ewma_x16 += (ap_info.rssi * 16 - s_rssi_ewma_x16) / (1 << WIFI_RSSI_EWMA_SHIFT);
+    }
+    int rssi = s_rssi_ewma_x16 / 16;
+    uint32_t tx_rate = wifi_estimate_tx_rate(rssi, &ap_info);
+    if (!first && abs(rssi - s_wifi_status.sta_rssi) < WIFI_RSSI_CHANGE_THRESHOLD &&
+        tx_rate == s_wifi_status.sta_tx_rate_kbps) {
+        return;
+    }
+
+    wifi_status_write_begin();
+    s_wifi_status.sta_rssi = rssi;
+    s_wifi_status.sta_link_quality = MIN(MAX(2 * (rssi + 100), 0), 100);
+    s_wifi_status.sta_tx_rate_kbps = tx_rate;
+    wifi_status_write_end();
+    system_state_mark_changed();
+}
+
+/**
+ * 按STA状态开关AP: STA在线且AP上没有客户端时关闭AP，否则保持AP+STA
+ */
+static void wifi_update_ap(void)
+{
+    bool need_ap = s_wifi_status.sta_state != WIFI_STA_STATE_CONNECTED || s_wifi_status.connected_clients > 0;
+    wifi_mode_t want = need_ap ? WIFI_MODE_APSTA : WIFI_MODE_STA;
+    wifi_mode_t mode;
+    if (esp_wifi_get_mode(&mode) != ESP_OK || mode == want) {
+        return;
+    }
+    ESP_LOGI(TAG, need_ap ? "STA未连接，开启AP" : "STA已连接，关闭AP");
+    esp_err_t ret = esp_wifi_set_mode(want);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "切换WiFi模式失败: %s", esp_err_to_name(ret));
+    }
+}
+
+/**
+ * 读取上次成功连接的网络参数
+ */
+static void wifi_link_cache_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t length = sizeof(s_link_cache);
+    s_link_cache_valid = nvs_get_blob(handle, WIFI_NVS_KEY_LINK, &s_link_cache, &length) == ESP_OK &&
+                         length == sizeof(s_link_cache) && s_link_cache.ssid[0] != '\0';
+    nvs_close(handle);
+    if (s_link_cache_valid) {
+        ESP_LOGI(TAG, "上次连接: %s " MACSTR " 信道%d", s_link_cache.ssid,
+                 MAC2STR(s_link_cache.bssid), s_link_cache.channel);
+    }
+}
+
+/**
+ * 获得IP后记录本次连接的网络参数，没有变化时不写入flash
+ */
+static void wifi_link_cache_update(void)
+{
+    wifi_ap_record_t ap_info;
+    wifi_link_cache_t cache = {0};
+    if (esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK ||
+        esp_netif_get_ip_info(s_sta_netif, &cache.ip_info) != ESP_OK) {
+        return;
+    }
+    memcpy(cache.ssid, ap_info.ssid, sizeof(cache.ssid) - 1);
+    memcpy(cache.bssid, ap_info.bssid, sizeof(cache.bssid));
+    cache.channel = ap_info.primary;
+    if (s_link_cache_valid && memcmp(&cache, &s_link_cache, sizeof(cache)) == 0) {
+        return;
+    }
+
+    s_link_cache = cache;
+    s_link_cache_valid = true;
+    nvs_handle_t handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "打开NVS失败，连接参数未保存");
+        return;
+    }
+    nvs_set_blob(handle, WIFI_NVS_KEY_LINK, &cache, sizeof(cache));
+    nvs_commit(handle);
+    nvs_close(handle);
+}
+
+/**
+ * 读取已知网络列表 (初始化时调用)
+ */
+static void wifi_known_load(void)
+{
+    nvs_handle_t handle;
+    if (nvs_open(WIFI_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    size_t length = sizeof(s_known);
+    if (nvs_get_blob(handle, WIFI_NVS_KEY_KNOWN, s_known, &length) == ESP_OK &&
+        length % sizeof(s_known[0]) == 0) {
+        s_known_count = length / sizeof(s_known[0]);
+    }
+    nvs_close(handle);
+    if (s_known_count > 0) {
+        ESP_LOGI(TAG, "已知网络: %u个", (unsigned)s_known_count);
+    }
+}
+
+/**
+ * 保存已知网络列表，列表为空时删除
+ */
+static esp_err_t wifi_known_save(const wifi_known_network_t *networks, size_t count)
+{
+    nvs_handle_t handle;
+    esp_err_t ret = nvs_open(WIFI_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (count > 0) {
+        ret = nvs_set_blob(handle, WIFI_NVS_KEY_KNOWN, networks, count * sizeof(networks[0]));
+    } else {
+        ret = nvs_erase_key(handle, WIFI_NVS_KEY_KNOWN);
+        ret = ret == ESP_ERR_NVS_NOT_FOUND ? ESP_OK : ret;
+    }
+    if (ret == ESP_OK) {
+        ret = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return ret;
+}
+
+/**
+ * 按SSID查找已知网络 (调用者持有s_config_mutex)
+ * @return 序号，没有时返回-1
+ */
+static int wifi_known_find_locked(const char *ssid, size_t len)
+{
+    for (size_t i = 0; i < s_known_count; i++) {
+        if (strnlen(s_known[i].ssid, sizeof(s_known[i].ssid)) == len && strncmp(s_known[i].ssid, ssid, len) == 0) {
+            return (int)i;
+        }
+    }
+    return -1;
+}
+
+/**
+ * 当前STA配置是否为已知网络 (列表为空时为默认网络)
+ */
+static bool wifi_sta_config_is_known(void)
+{
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK) {
+        return false;
+    }
+    const char *ssid = (const char *)config.sta.ssid;
+    size_t len = strnlen(ssid, sizeof(config.sta.ssid));
+    xSemaphoreTake(s_config_mutex, portMAX_DELAY);
+    bool known = s_known_count > 0 ? wifi_known_find_locked(ssid, len) >= 0 :
+                 len == strlen(DEFAULT_STA_SSID) && strncmp(ssid, DEFAULT_STA_SSID, len) == 0;
+    xSemaphoreGive(s_config_mutex);
+    return known;
+}
+
+/**
+ * 从已知网络中选择下一次连接的网络并写入STA配置 (连接任务和启动WiFi之前的初始化调用)
+ * use_scan时在扫描结果中选择可见的网络: 优先选择本次断线期间没有失败过的，其次按优先级、再按RSSI，
+ * 并记录其BSSID和信道使下一次连接不再扫描；没有可见的已知网络或不使用扫描结果时，
+ * 优先选择上次成功连接的网络，其次选择优先级最高的网络；列表为空时使用默认配置
+ */
+static void wifi_sta_select_network(bool use_scan)
+{
+    wifi_known_network_t chosen = {0};
+    int chosen_index = -1;
+    int chosen_rssi = 0;
+    uint8_t chosen_bssid[6] = {0};
+    uint8_t chosen_channel = 0;
+
+    xSemaphoreTake(s_config_mutex, portMAX_DELAY);
+    if (use_scan) {
+        bool chosen_failed = true;
+        xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+        for (uint16_t i = 0; i < s_scan_count; i++) {
+            const wifi_ap_record_t *record = &s_scan_records[i];
+            int index = wifi_known_find_locked((const char *)record->ssid,
+                                               strnlen((const char *)record->ssid, sizeof(record->ssid)));
+            if (index < 0) {
+                continue;
+            }
+            bool failed = (s_known_failed & (1u << index)) != 0;
+            bool better = chosen_index < 0 || (chosen_failed && !failed);
+            if (!better && failed == chosen_failed) {
+                better = s_known[index].priority > s_known[chosen_index].priority ||
+                         (s_known[index].priority == s_known[chosen_index].priority && record->rssi > chosen_rssi);
+            }
+            if (better) {
+                chosen_index = index;
+                chosen_failed = failed;
+                chosen_rssi = record->rssi;
+                memcpy(chosen_bssid, record->bssid, sizeof(chosen_bssid));
+                chosen_channel = record->primary;
+            }
+        }
+        xSemaphoreGive(s_scan_mutex);
+    }
+    bool visible = chosen_index >= 0;
+    if (!visible && s_known_count > 0) {
+        if (s_link_cache_valid) {
+            chosen_index = wifi_known_find_locked(s_link_cache.ssid, strlen(s_link_cache.ssid));
+        }
+        if (chosen_index < 0) {
+            size_t best = 0;
+            for (size_t i = 1; i < s_known_count; i++) {
+                if (s_known[i].priority > s_known[best].priority) {
+                    best = i;
+                }
+            }
+            chosen_index = (int)best;
+        }
+    }
+    if (chosen_index >= 0) {
+        chosen = s_known[chosen_index];
+    } else {
+        strncpy(chosen.ssid, DEFAULT_STA_SSID, sizeof(chosen.ssid) - 1);
+        strncpy(chosen.password, DEFAULT_STA_PASSWORD, sizeof(chosen.password) - 1);
+    }
+    xSemaphoreGive(s_config_mutex);
+
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK) {
+        memset(&config, 0, sizeof(config));
+    }
+    memset(config.sta.ssid, 0, sizeof(config.sta.ssid));
+    memset(config.sta.password, 0, sizeof(config.sta.password));
+    memcpy(config.sta.ssid, chosen.ssid, strnlen(chosen.ssid, sizeof(config.sta.ssid)));
+    memcpy(config.sta.password, chosen.password, strnlen(chosen.password, sizeof(config.sta.password)));
+    esp_err_t ret = esp_wifi_set_config(WIFI_IF_STA, &config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "设置STA配置失败: %s", esp_err_to_name(ret));
+    }
+
+    s_selected_index = chosen_index;
+    s_selected_ap_valid = visible;
+    if (visible) {
+        memcpy(s_selected_ap.ssid, chosen.ssid, sizeof(s_selected_ap.ssid));
+        memcpy(s_selected_ap.bssid, chosen_bssid, sizeof(s_selected_ap.bssid));
+        s_selected_ap.channel = chosen_channel;
+        ESP_LOGI(TAG, "选择网络: %s (优先级%d，RSSI %d)", chosen.ssid, chosen.priority, chosen_rssi);
+    } else if (use_scan) {
+        ESP_LOGW(TAG, "扫描结果中没有已知网络，尝试: %s", chosen.ssid);
+    }
+
+    wifi_status_write_begin();
+    memset(s_wifi_status.sta_ssid, 0, sizeof(s_wifi_status.sta_ssid));
+    memcpy(s_wifi_status.sta_ssid, chosen.ssid, strnlen(chosen.ssid, sizeof(s_wifi_status.sta_ssid) - 1));
+    wifi_status_write_end();
+    system_state_mark_changed();
+}
+
+#ifdef CONFIG_KVM_WIFI_REUSE_IP
+/**
+ * 定向快速连接时使用上次的地址 (停止DHCP)，否则恢复DHCP
+ */
+static void wifi_sta_apply_ip_mode(bool reuse)
+{
+    static bool s_static_ip = false;
+
+    if (reuse && s_link_cache.ip_info.ip.addr != 0) {
+        if (!s_static_ip) {
+            esp_netif_dhcpc_stop(s_sta_netif);
+            s_static_ip = true;
+        }
+        esp_netif_set_ip_info(s_sta_netif, &s_link_cache.ip_info);
+    } else if (s_static_ip) {
+        esp_netif_dhcpc_start(s_sta_netif);
+        s_static_ip = false;
+    }
+}
+#endif
+
+/**
+ * 本次连接能否使用上次成功连接的BSSID和信道
+ */
+static bool wifi_sta_fast_possible(const wifi_config_t *config)
+{
+    return s_link_cache_valid && s_retry_num <= WIFI_FAST_CONNECT_TRIES &&
+           strncmp((const char *)config->sta.ssid, s_link_cache.ssid, sizeof(config->sta.ssid)) == 0;
+}
+
+/**
+ * 按重试次数选择定向快速连接、定向到扫描选出的AP或全信道扫描连接
+ */
+static void wifi_sta_apply_connect_mode(void)
+{
+    wifi_config_t config;
+    if (esp_wifi_get_config(WIFI_IF_STA, &config) != ESP_OK) {
+        return;
+    }
+    bool fast = wifi_sta_fast_possible(&config);
+    bool selected = !fast && s_selected_ap_valid &&
+                    strncmp((const char *)config.sta.ssid, s_selected_ap.ssid, sizeof(config.sta.ssid)) == 0;
+    s_selected_ap_valid = false;
+    if (fast || selected) {
+        const wifi_link_cache_t *target = fast ? &s_link_cache : &s_selected_ap;
+        config.sta.bssid_set = true;
+        memcpy(config.sta.bssid, target->bssid, sizeof(config.sta.bssid));
+        config.sta.channel = target->channel;
+    } else {
+        config.sta.bssid_set = false;
+        memset(config.sta.bssid, 0, sizeof(config.sta.bssid));
+        config.sta.channel = 0;
+    }
+    esp_wifi_set_config(WIFI_IF_STA, &config);
+#ifdef CONFIG_KVM_WIFI_REUSE_IP
+    wifi_sta_apply_ip_mode(fast);
+#endif
+    ESP_LOGD(TAG, "第%d次连接: %s", s_retry_num + 1, fast ? "定向" : selected ? "定向到扫描选出的AP" : "全信道扫描");
+}
+
+/**
+ * 发起一次STA连接
+ * @return 本次连接的截止时间 (微秒)
+ */
+static int64_t wifi_sta_start_connect(void)
+{
+    wifi_set_sta_state(WIFI_STA_STATE_CONNECTING);
+    wifi_sta_apply_connect_mode();
+    esp_err_t ret = esp_wifi_connect();
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "发起STA连接失败: %s", esp_err_to_name(ret));
+    }
+    return esp_timer_get_time() + (int64_t)WIFI_CONNECT_TIMEOUT_MS * 1000;
+}
+
+/**
+ * 连接失败或断开后安排重试
+ * @return 重试时间 (微秒)
+ */
+static int64_t wifi_sta_schedule_retry(void)
+{
+    // 连接失败 (而不是已连接后断开) 时记录，下次选择时优先尝试其他可见的已知网络
+    if (s_wifi_status.sta_state == WIFI_STA_STATE_CONNECTING && s_selected_index >= 0) {
+        s_known_failed |= 1u << s_selected_index;
+    }
+    wifi_set_sta_state(WIFI_STA_STATE_WAIT_RETRY);
+    wifi_update_ap();
+
+    uint32_t delay_ms = 0;
+    if (s_retry_num > 0) {
+        uint32_t backoff = MIN((uint32_t)WIFI_BACKOFF_BASE_MS << MIN(s_retry_num - 1, 16), WIFI_BACKOFF_MAX_MS);
+        delay_ms = backoff / 2 + esp_random() % (backoff / 2 + 1);
+        if (backoff == WIFI_BACKOFF_MAX_MS) {
+            ESP_LOGW(TAG, "WiFi连接已失败%d次，%u毫秒后重试", s_retry_num, (unsigned)delay_ms);
+        }
+    }
+    s_retry_num++;
+    return esp_timer_get_time() + (int64_t)delay_ms * 1000;
+}
+
+/**
+ * 发起已请求的后台扫描 (仅连接任务调用)
+ */
+static void wifi_scan_start_requested(void)
+{
+    xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+    bool start = s_scan_requested && !s_scan_running;
+    if (start) {
+        s_scan_requested = false;
+        s_scan_running = true;
+    }
+    xSemaphoreGive(s_scan_mutex);
+    if (!start) {
+        return;
+    }
+
+    wifi_scan_config_t scan_config = {
+        .ssid = NULL,
+        .bssid = NULL,
+        .channel = 0,
+        .show_hidden = false,
+        .scan_type = WIFI_SCAN_TYPE_ACTIVE,
+        .scan_time.active = { .min = 0, .max = WIFI_SCAN_DWELL_MS },
+        .home_chan_dwell_time = WIFI_SCAN_HOME_DWELL_MS,
+    };
+    esp_err_t ret = esp_wifi_scan_start(&scan_config, false);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "WiFi扫描启动失败: %s", esp_err_to_name(ret));
+        xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+        s_scan_running = false;
+        xSemaphoreGive(s_scan_mutex);
+    }
+}
+
+/**
+ * 读取扫描结果到缓存 (仅连接任务调用)
+ */
+static void wifi_scan_collect(void)
+{
+    xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+    uint16_t number = WIFI_SCAN_MAX_RECORDS;
+    if (esp_wifi_scan_get_ap_records(&number, s_scan_records) == ESP_OK) {
+        s_scan_count = number;
+        s_scan_time_us = esp_timer_get_time();
+    }
+    s_scan_running = false;
+    xSemaphoreGive(s_scan_mutex);
+    ESP_LOGD(TAG, "扫描完成: %u个网络", (unsigned)number);
+}
+
+/**
+ * 发起STA连接 (仅连接任务调用)
+ * 有多个已知网络且不能快速重连时，按扫描结果选择网络 (扫描结果超过WIFI_SCAN_CACHE_TTL_MS时先扫描一次)；
+ * 扫描进行中时推迟到扫描完成 (驱动不允许扫描与连接同时进行)
+ * @param allow_select 是否允许重新选择网络 (指定了网络时为false)
+ * @return 本次连接或扫描的截止时间 (微秒)，推迟时为0
+ */
+static int64_t wifi_sta_try_connect(bool allow_select)
+{
+    bool select = false;
+    wifi_config_t config;
+    if (allow_select && esp_wifi_get_config(WIFI_IF_STA, &config) == ESP_OK && !wifi_sta_fast_possible(&config)) {
+        xSemaphoreTake(s_config_mutex, portMAX_DELAY);
+        select = s_known_count > 1;
+        xSemaphoreGive(s_config_mutex);
+    }
+
+    xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+    bool scanning = s_scan_running;
+    bool fresh = s_scan_time_us != 0 &&
+                 esp_timer_get_time() - s_scan_time_us <= (int64_t)WIFI_SCAN_CACHE_TTL_MS * 1000;
+    if (select && !scanning && !fresh) {
+        s_scan_requested = true;        // 由任务循环开头发起
+    }
+    xSemaphoreGive(s_scan_mutex);
+
+    if (select && fresh && !scanning) {
+        // 重试时使用最近的扫描结果，不再扫描
+        wifi_sta_select_network(true);
+        return wifi_sta_start_connect();
+    }
+    if (select) {
+        wifi_set_sta_state(WIFI_STA_STATE_SELECTING);
+        s_select_after_scan = true;
+        return esp_timer_get_time() + (int64_t)WIFI_CONNECT_TIMEOUT_MS * 1000;
+    }
+    if (scanning) {
+        wifi_set_sta_state(WIFI_STA_STATE_WAIT_RETRY);
+        s_connect_after_scan = true;
+        return 0;
+    }
+    return wifi_sta_start_connect();
+}
+
+/**
+ * 连接任务: 维护STA连接状态，超时和重试通过带超时的通知等待实现
+ */
+static void wifi_conn_task(void *pvParameters)
+{
+    int64_t deadline_us = 0;    // 连接超时或重试时间，0表示没有定时动作
+    int64_t sample_us = 0;      // 下次链路采样时间 (仅CONNECTED状态有效)
+
+    while (1) {
+        // 扫描不能与关联同时进行，正在连接时推迟到连接结束
+        if (s_wifi_status.sta_state != WIFI_STA_STATE_CONNECTING) {
+            wifi_scan_start_requested();
+        }
+
+        TickType_t wait = portMAX_DELAY;
+        int64_t next_us = deadline_us;
+        if (s_wifi_status.sta_state == WIFI_STA_STATE_CONNECTED && (next_us == 0 || sample_us < next_us)) {
+            next_us = sample_us;
+        }
+        if (next_us != 0) {
+            int64_t remain_us = next_us - esp_timer_get_time();
+            wait = remain_us > 0 ? pdMS_TO_TICKS((remain_us + 999) / 1000) : 0;
+        }
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, wait);
+        wifi_sta_state_t state = s_wifi_status.sta_state;
+
+        if (bits & WIFI_NOTIFY_SCAN_DONE) {
+            wifi_scan_collect();
+            if (s_select_after_scan && state == WIFI_STA_STATE_SELECTING) {
+                wifi_sta_select_network(true);
+                deadline_us = wifi_sta_start_connect();
+            } else if (s_connect_after_scan && state == WIFI_STA_STATE_WAIT_RETRY) {
+                deadline_us = wifi_sta_start_connect();
+            }
+            s_select_after_scan = false;
+            s_connect_after_scan = false;
+            state = s_wifi_status.sta_state;
+        }
+
+        if (bits & WIFI_NOTIFY_STOP) {
+            deadline_us = 0;
+            s_select_after_scan = false;
+            s_connect_after_scan = false;
+            wifi_set_sta_state(WIFI_STA_STATE_IDLE);
+            esp_wifi_disconnect();
+            wifi_update_ap();
+            continue;
+        }
+
+        if (bits & WIFI_NOTIFY_RECONFIGURE) {
+            xSemaphoreTake(s_config_mutex, portMAX_DELAY);
+            esp_err_t ret = esp_wifi_set_config(WIFI_IF_STA, &s_sta_config);
+            xSemaphoreGive(s_config_mutex);
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "设置STA配置失败: %s", esp_err_to_name(ret));
+            }
+            s_retry_num = 0;
+            s_selected_index = -1;
+            s_select_after_scan = false;
+            s_connect_after_scan = false;
+            if (s_sta_associated) {
+                // 断开事件到达后立即按新配置重连
+                wifi_set_sta_state(WIFI_STA_STATE_WAIT_RETRY);
+                esp_wifi_disconnect();
+                deadline_us = 0;
+            } else {
+                deadline_us = wifi_sta_try_connect(false);
+            }
+            continue;
+        }
+
+        if (bits & WIFI_NOTIFY_SELECT) {
+            s_retry_num = 0;
+            s_known_failed = 0;
+            s_select_after_scan = false;
+            s_connect_after_scan = false;
+            // 当前网络仍在列表中时保持连接
+            if (state == WIFI_STA_STATE_CONNECTED && wifi_sta_config_is_known()) {
+                continue;
+            }
+            wifi_sta_select_network(false);
+            if (s_sta_associated) {
+                wifi_set_sta_state(WIFI_STA_STATE_WAIT_RETRY);
+                esp_wifi_disconnect();
+                deadline_us = 0;
+            } else {
+                deadline_us = wifi_sta_try_connect(true);
+            }
+            continue;
+        }
+
+        if (state == WIFI_STA_STATE_IDLE) {
+            continue;
+        }
+
+        // 同一次唤醒中先后收到获得IP和断开时，以当前链路状态为准
+        if ((bits & WIFI_NOTIFY_GOT_IP) && s_wifi_status.sta_connected) {
+            s_retry_num = 0;
+            s_known_failed = 0;
+            deadline_us = 0;
+            wifi_set_sta_state(WIFI_STA_STATE_CONNECTED);
+            wifi_update_ap();
+            wifi_link_cache_update();
+            // 新连接重新开始平滑
+            s_rssi_sampled = false;
+            sample_us = esp_timer_get_time();
+        } else if (bits & WIFI_NOTIFY_DISCONNECTED) {
+            deadline_us = wifi_sta_schedule_retry();
+        } else if (bits & WIFI_NOTIFY_STA_START) {
+            deadline_us = wifi_sta_try_connect(true);
+        } else if (bits & WIFI_NOTIFY_AP_IDLE) {
+            wifi_update_ap();
+        } else if (deadline_us != 0 && esp_timer_get_time() >= deadline_us) {
+            if (state == WIFI_STA_STATE_CONNECTING) {
+                ESP_LOGW(TAG, "WiFi连接超时");
+                esp_wifi_disconnect();
+                deadline_us = wifi_sta_schedule_retry();
+            } else if (state == WIFI_STA_STATE_WAIT_RETRY) {
+                deadline_us = wifi_sta_try_connect(true);
+            } else if (state == WIFI_STA_STATE_SELECTING) {
+                // 扫描没有完成，按已有的扫描结果选择
+                ESP_LOGW(TAG, "选择网络的扫描超时");
+                s_select_after_scan = false;
+                wifi_sta_select_network(true);
+                deadline_us = wifi_sta_start_connect();
+            } else {
+                deadline_us = 0;
+            }
+        }
+
+        if (s_wifi_status.sta_state == WIFI_STA_STATE_CONNECTED && esp_timer_get_time() >= sample_us) {
+            wifi_link_sample();
+            sample_us = esp_timer_get_time() + (int64_t)WIFI_SAMPLE_INTERVAL_MS * 1000;
+        }
     }
 }
 
@@ -93,11 +887,10 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base,
  */
 esp_err_t wifi_manager_init(void)
 {
-    
-    // 创建事件组
-    s_wifi_event_group = xEventGroupCreate();
-    if (s_wifi_event_group == NULL) {
-        ESP_LOGE(TAG, "创建WiFi事件组失败");
+    s_config_mutex = xSemaphoreCreateMutex();
+    s_scan_mutex = xSemaphoreCreateMutex();
+    if (s_config_mutex == NULL || s_scan_mutex == NULL) {
+        ESP_LOGE(TAG, "创建WiFi互斥锁失败");
         return ESP_FAIL;
     }
     
@@ -120,26 +913,32 @@ esp_err_t wifi_manager_init(void)
                                                         &wifi_event_handler,
                                                         NULL,
                                                         NULL));
-    
-    // 首先尝试STA模式连接WiFi
-    // 简化连接尝试日志
-    esp_err_t ret = wifi_manager_connect_sta(DEFAULT_STA_SSID, DEFAULT_STA_PASSWORD);
 
+    wifi_link_cache_load();
+    wifi_known_load();
+
+    // 连接任务须在启动WiFi之前创建，以免错过STA启动通知
+    s_wifi_status.sta_state = WIFI_STA_STATE_CONNECTING;
+    if (xTaskCreate(wifi_conn_task, "wifi_conn", WIFI_TASK_STACK_SIZE, NULL,
+                    WIFI_TASK_PRIORITY, &s_wifi_task) != pdPASS) {
+        ESP_LOGE(TAG, "创建WiFi连接任务失败");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // AP+STA模式: AP立即可用，STA在后台连接
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
+
+    // 初始网络: 上次成功连接的已知网络或优先级最高的网络 (没有已知网络时为默认配置)，
+    // 有多个已知网络且快速重连不可用时，STA启动后先扫描再选择
+    wifi_sta_select_network(false);
+
+    esp_err_t ret = wifi_manager_start_ap(DEFAULT_AP_SSID, DEFAULT_AP_PASSWORD);
     if (ret != ESP_OK) {
-        ESP_LOGW(TAG, "STA连接失败，启动AP模式");
-        // STA连接失败，启动AP模式
-        ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
-        ret = wifi_manager_start_ap(DEFAULT_AP_SSID, DEFAULT_AP_PASSWORD);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "启动AP模式失败");
-            return ret;
-        }
-        strcpy(s_wifi_status.ap_ip, "192.168.4.1");
-    } else {
-        // STA模式连接成功
+        ESP_LOGE(TAG, "启动AP模式失败");
+        return ret;
     }
 
-    // WiFi管理器初始化完成
+    // WiFi管理器初始化完成，STA连接结果通过事件通知
     return ESP_OK;
 }
 
@@ -188,47 +987,87 @@ esp_err_t wifi_manager_connect_sta(const char *ssid, const char *password)
         ESP_LOGE(TAG, "WiFi SSID不能为空");
         return ESP_ERR_INVALID_ARG;
     }
+    if (s_wifi_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
 
-    // 首先设置WiFi模式为STA模式
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
+    xSemaphoreTake(s_config_mutex, portMAX_DELAY);
+    memset(&s_sta_config, 0, sizeof(s_sta_config));
+    strncpy((char*)s_sta_config.sta.ssid, ssid, sizeof(s_sta_config.sta.ssid) - 1);
+    if (password != NULL) {
+        strncpy((char*)s_sta_config.sta.password, password, sizeof(s_sta_config.sta.password) - 1);
+    }
+    xSemaphoreGive(s_config_mutex);
 
-    wifi_config_t wifi_config = {0};
+    // 保存SSID到状态
+    wifi_status_write_begin();
+    memset(s_wifi_status.sta_ssid, 0, sizeof(s_wifi_status.sta_ssid));
+    strncpy(s_wifi_status.sta_ssid, ssid, sizeof(s_wifi_status.sta_ssid) - 1);
+    wifi_status_write_end();
+    system_state_mark_changed();
 
-    // 设置SSID
-    strncpy((char*)wifi_config.sta.ssid, ssid, sizeof(wifi_config.sta.ssid) - 1);
+    wifi_notify(WIFI_NOTIFY_RECONFIGURE);
+    return ESP_OK;
+}
 
-    // 设置密码
-    if (password != NULL) {
-        strncpy((char*)wifi_config.sta.password, password, sizeof(wifi_config.sta.password) - 1);
+/**
+ * 替换已知网络列表
+ */
+esp_err_t wifi_manager_set_known_networks(const wifi_known_network_t *networks, size_t count)
+{
+    if (s_wifi_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (count > WIFI_KNOWN_MAX || (count > 0 && networks == NULL)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 0; i < count; i++) {
+        size_t ssid_len = strnlen(networks[i].ssid, sizeof(networks[i].ssid));
+        size_t password_len = strnlen(networks[i].password, sizeof(networks[i].password));
+        if (ssid_len == 0 || ssid_len > WIFI_SSID_MAX_LEN || password_len > WIFI_PASSWORD_MAX_LEN ||
+            (password_len > 0 && password_len < 8)) {
+            return ESP_ERR_INVALID_ARG;
+        }
+        for (size_t j = 0; j < i; j++) {
+            if (strcmp(networks[j].ssid, networks[i].ssid) == 0) {
+                return ESP_ERR_INVALID_ARG;
+            }
+        }
     }
 
-    ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_config));
-
-    // 启动WiFi
-    ESP_ERROR_CHECK(esp_wifi_start());
+    xSemaphoreTake(s_config_mutex, portMAX_DELAY);
+    esp_err_t ret = wifi_known_save(networks, count);
+    if (ret == ESP_OK) {
+        if (count > 0) {
+            memcpy(s_known, networks, count * sizeof(networks[0]));
+        }
+        s_known_count = count;
+    }
+    xSemaphoreGive(s_config_mutex);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "保存已知网络失败: %s", esp_err_to_name(ret));
+        return ret;
+    }
 
-    // 保存SSID到状态
-    strncpy(s_wifi_status.sta_ssid, ssid, sizeof(s_wifi_status.sta_ssid) - 1);
+    ESP_LOGI(TAG, "已知网络已更新: %u个", (unsigned)count);
+    system_state_mark_changed();
+    wifi_notify(WIFI_NOTIFY_SELECT);
+    return ESP_OK;
+}
 
-    // 开始连接WiFi
-    
-    // 等待连接结果（最多等待10秒）
-    EventBits_t bits = xEventGroupWaitBits(s_wifi_event_group,
-                                           WIFI_CONNECTED_BIT | WIFI_FAIL_BIT,
-                                           pdFALSE,
-                                           pdFALSE,
-                                           pdMS_TO_TICKS(10000));
-    
-    if (bits & WIFI_CONNECTED_BIT) {
-        // WiFi连接成功
-        return ESP_OK;
-    } else if (bits & WIFI_FAIL_BIT) {
-        ESP_LOGE(TAG, "WiFi连接失败");
-        return ESP_FAIL;
-    } else {
-        ESP_LOGE(TAG, "WiFi连接超时");
-        return ESP_ERR_TIMEOUT;
+/**
+ * 获取已知网络列表
+ */
+size_t wifi_manager_get_known_networks(wifi_known_network_t *networks, size_t max_count)
+{
+    if (s_config_mutex == NULL || networks == NULL) {
+        return 0;
     }
+    xSemaphoreTake(s_config_mutex, portMAX_DELAY);
+    size_t count = MIN(max_count, s_known_count);
+    memcpy(networks, s_known, count * sizeof(networks[0]));
+    xSemaphoreGive(s_config_mutex);
+    return count;
 }
 
 /**
@@ -236,24 +1075,34 @@ esp_err_t wifi_manager_connect_sta(const char *ssid, const char *password)
  */
 esp_err_t wifi_manager_disconnect(void)
 {
-    // 断开WiFi连接
-    return esp_wifi_disconnect();
+    if (s_wifi_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    wifi_notify(WIFI_NOTIFY_STOP);
+    return ESP_OK;
 }
 
 /**
- * 获取WiFi状态
+ * 获取STA连接状态名称
  */
-const wifi_status_t* wifi_manager_get_status(void)
+const char *wifi_manager_sta_state_name(wifi_sta_state_t state)
 {
-    // 更新RSSI
-    if (s_wifi_status.sta_connected) {
-        wifi_ap_record_t ap_info;
-        if (esp_wifi_sta_get_ap_info(&ap_info) == ESP_OK) {
-            s_wifi_status.sta_rssi = ap_info.rssi;
-        }
+    if ((unsigned)state >= sizeof(STA_STATE_NAMES) / sizeof(STA_STATE_NAMES[0])) {
+        return "unknown";
     }
-    
-    return &s_wifi_status;
+    return STA_STATE_NAMES[state];
+}
+
+/**
+ * 获取WiFi状态的一致快照
+ */
+void wifi_manager_get_status_snapshot(wifi_status_t *out)
+{
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_status_seq);
+        *out = s_wifi_status;
+    } while (seqlock_read_retry(&s_status_seq, seq));
 }
 
 /**
@@ -261,7 +1110,13 @@ const wifi_status_t* wifi_manager_get_status(void)
  */
 bool wifi_manager_is_connected(void)
 {
-    return s_wifi_status.sta_connected;
+    bool connected;
+    uint32_t seq;
+    do {
+        seq = seqlock_read_begin(&s_status_seq);
+        connected = s_wifi_status.sta_connected;
+    } while (seqlock_read_retry(&s_status_seq, seq));
+    return connected;
 }
 
 /**
@@ -273,12 +1128,14 @@ esp_err_t wifi_manager_get_ip(char *ip_str, size_t len)
         return ESP_ERR_INVALID_ARG;
     }
     
-    if (s_wifi_status.sta_connected) {
-        strncpy(ip_str, s_wifi_status.sta_ip, len - 1);
+    wifi_status_t status;
+    wifi_manager_get_status_snapshot(&status);
+    if (status.sta_connected) {
+        strncpy(ip_str, status.sta_ip, len - 1);
         ip_str[len - 1] = '\0';
         return ESP_OK;
-    } else if (s_wifi_status.ap_started) {
-        strncpy(ip_str, s_wifi_status.ap_ip, len - 1);
+    } else if (status.ap_started) {
+        strncpy(ip_str, status.ap_ip, len - 1);
         ip_str[len - 1] = '\0';
         return ESP_OK;
     }
@@ -287,38 +1144,33 @@ esp_err_t wifi_manager_get_ip(char *ip_str, size_t len)
 }
 
 /**
- * 扫描可用WiFi网络
+ * 获取缓存的扫描结果
  */
-uint16_t wifi_manager_scan_networks(wifi_ap_record_t *scan_result, uint16_t max_records)
+esp_err_t wifi_manager_scan_get_cached(uint32_t max_age_ms, wifi_ap_record_t *records,
+                                       uint16_t max_records, wifi_scan_info_t *info)
 {
-    if (scan_result == NULL || max_records == 0) {
-        return 0;
+    if (s_wifi_task == NULL) {
+        return ESP_ERR_INVALID_STATE;
     }
-    
-    // 开始扫描WiFi网络
-    
-    // 启动扫描
-    wifi_scan_config_t scan_config = {
-        .ssid = NULL,
-        .bssid = NULL,
-        .channel = 0,
-        .show_hidden = false
-    };
-    
-    esp_err_t ret = esp_wifi_scan_start(&scan_config, true);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "WiFi扫描启动失败: %s", esp_err_to_name(ret));
-        return 0;
+
+    xSemaphoreTake(s_scan_mutex, portMAX_DELAY);
+    int64_t age_us = esp_timer_get_time() - s_scan_time_us;
+    bool stale = s_scan_time_us == 0 || age_us > (int64_t)max_age_ms * 1000;
+    bool request = stale && !s_scan_running && !s_scan_requested;
+    if (request) {
+        s_scan_requested = true;
     }
-    
-    // 获取扫描结果
-    uint16_t number = max_records;
-    ret = esp_wifi_scan_get_ap_records(&number, scan_result);
-    if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "获取WiFi扫描结果失败: %s", esp_err_to_name(ret));
-        return 0;
+    info->valid = s_scan_time_us != 0;
+    info->age_ms = info->valid ? (uint32_t)(age_us / 1000) : 0;
+    info->scanning = s_scan_running || s_scan_requested;
+    info->count = records != NULL ? MIN(max_records, s_scan_count) : 0;
+    if (info->count > 0) {
+        memcpy(records, s_scan_records, info->count * sizeof(wifi_ap_record_t));
     }
-    
-    // 扫描完成
-    return number;
+    xSemaphoreGive(s_scan_mutex);
+
+    if (request) {
+        wifi_notify(WIFI_NOTIFY_SCAN);
+    }
+    return ESP_OK;
 }
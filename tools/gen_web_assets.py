@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+"""
+网页资源预处理脚本
+功能: 构建时将 main/web 下的静态资源压缩为 .gz 并生成内容哈希(ETag)头文件
+
+用法: gen_web_assets.py --out-dir <目录> <资源文件>...
+输出:
+    <目录>/<文件名>.gz    gzip 压缩后的资源 (mtime固定为0，保证可重复构建)
+    <目录>/web_assets.h   每个资源的 ETag 与大小宏定义
+"""
+
+import argparse
+import gzip
+import hashlib
+import os
+import re
+
+
+def macro_name(file_name):
+    """index.html -> INDEX_HTML"""
+    return re.sub(r'[^0-9A-Za-z]', '_', file_name).upper()
+
+
+def write_file(path, data):
+    with open(path, 'wb') as f:
+        f.write(data)
+
+
+def main():
+    parser = argparse.ArgumentParser(description='压缩网页资源并生成ETag')
+    parser.add_argument('--out-dir', required=True, help='输出目录')
+    parser.add_argument('files', nargs='+', help='需要处理的资源文件')
+    args = parser.parse_args()
+
+    os.makedirs(args.out_dir, exist_ok=True)
+
+    lines = [
+        '/**',
+        ' * 网页资源元数据 (由 tools/gen_web_assets.py 自动生成，请勿手动修改)',
+        ' */',
+        '',
+        '#ifndef WEB_ASSETS_H',
+        '#define WEB_ASSETS_H',
+        '',
+    ]
+
+    for path in args.files:
+        with open(path, 'rb') as f:
+            raw = f.read()
+
+        name = os.path.basename(path)
+        compressed = gzip.compress(raw, compresslevel=9, mtime=0)
+        write_file(os.path.join(args.out_dir, name + '.gz'), compressed)
+
+        # ETag取原始内容SHA-256的前16个十六进制字符，内容不变则ETag不变
+        digest = hashlib.sha256(raw).hexdigest()[:16]
+        macro = macro_name(name)
+        lines += [
+            '// {}: {} -> {} 字节'.format(name, len(raw), len(compressed)),
+            '#define WEB_ASSET_{}_ETAG      "\\"{}\\""'.format(macro, digest),
+            '#define WEB_ASSET_{}_GZ_ETAG   "\\"{}-gz\\""'.format(macro, digest),
+            '#define WEB_ASSET_{}_SIZE      {}'.format(macro, len(raw)),
+            '#define WEB_ASSET_{}_GZ_SIZE   {}'.format(macro, len(compressed)),
+            '',
+        ]
+
+    lines += ['#endif // WEB_ASSETS_H', '']
+    write_file(os.path.join(args.out_dir, 'web_assets.h'),
+               '\n'.join(lines).encode('utf-8'))
+
+
+if __name__ == '__main__':
+    main()